@@ -0,0 +1,69 @@
+;; Exact integer arithmetic past the fixnum range.
+;;
+;;   factorial      10000! as a running product: a bignum times a fixnum,
+;;                  10000 times over
+;;   product-tree   10000! as a balanced tree of products, whose last
+;;                  multiplications are of two large halves and so go
+;;                  through Karatsuba and Toom-3
+;;   fibonacci      fib(100000) by repeated addition
+;;   doubling       fib(100000) by fast doubling, a few dozen large
+;;                  multiplications
+;;
+;; Each prints its time and its result modulo 1000000007, which the two
+;; ways of computing the same number must agree on.
+;;
+;; Run with:  ./rscheme benchmarks/bignum.scm
+
+(define (factorial n)
+  (define (loop i acc)
+    (if (> i n)
+        acc
+        (loop (+ i 1) (* acc i))))
+  (loop 2 1))
+
+;; Product of the integers from lo to hi
+(define (range-product lo hi)
+  (if (= lo hi)
+      lo
+      (let ((mid (quotient (+ lo hi) 2)))
+        (* (range-product lo mid) (range-product (+ mid 1) hi)))))
+
+(define (fibonacci n)
+  (define (loop i a b)
+    (if (= i n)
+        a
+        (loop (+ i 1) b (+ a b))))
+  (loop 0 0 1))
+
+;; fib(2k) = fib(k) (2 fib(k+1) - fib(k)), fib(2k+1) = fib(k)^2 + fib(k+1)^2;
+;; returns fib(n) and fib(n+1) as a pair
+(define (fib-pair n)
+  (if (= n 0)
+      (cons 0 1)
+      (let* ((half (fib-pair (quotient n 2)))
+             (a (car half))
+             (b (cdr half))
+             (even (* a (- (* 2 b) a)))
+             (odd (+ (* a a) (* b b))))
+        (if (= (remainder n 2) 0)
+            (cons even odd)
+            (cons odd (+ even odd))))))
+
+(define (fib-doubling n)
+  (car (fib-pair n)))
+
+(define (bench name thunk)
+  (let* ((start (current-jiffy))
+         (result (thunk))
+         (elapsed (- (current-jiffy) start)))
+    (display name)
+    (display ": ")
+    (display (/ elapsed 1000))
+    (display " ms, result mod 1000000007 = ")
+    (display (modulo result 1000000007))
+    (newline)))
+
+(bench "factorial   " (lambda () (factorial 10000)))
+(bench "product-tree" (lambda () (range-product 1 10000)))
+(bench "fibonacci   " (lambda () (fibonacci 100000)))
+(bench "doubling    " (lambda () (fib-doubling 100000)))
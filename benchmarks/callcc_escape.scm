@@ -0,0 +1,63 @@
+;; Early exit from deep recursion: escaping with a continuation against
+;; returning normally through every frame.
+;;
+;; Each variant computes the product of a list that has a zero near its
+;; end, so the answer is known deep in the recursion:
+;;   return  returns 0 and multiplies by it all the way back up
+;;   flag    returns a marker that every frame tests and passes up
+;;   escape  jumps straight out with the continuation of call/cc
+;;
+;; Run with:  ./rscheme --vm benchmarks/callcc_escape.scm
+;; The tree-walker runs it too, with escape-only continuations.
+
+(define (make-numbers n)
+  (letrec ((build (lambda (i acc)
+                    (if (= i 0)
+                        acc
+                        (build (- i 1) (cons (if (= i (- n 10)) 0 i) acc))))))
+    (build n '())))
+
+;; Stops at the zero, then multiplies by it on the way back up
+(define (product-return lst)
+  (cond ((null? lst) 1)
+        ((= (car lst) 0) 0)
+        (else (* (car lst) (product-return (cdr lst))))))
+
+(define (product-flag lst)
+  (cond ((null? lst) 1)
+        ((= (car lst) 0) 'zero)
+        (else (let ((rest (product-flag (cdr lst))))
+                (if (eq? rest 'zero)
+                    'zero
+                    (* (car lst) rest))))))
+
+(define (walk-escape lst return)
+  (cond ((null? lst) 1)
+        ((= (car lst) 0) (return 0))
+        (else (* (car lst) (walk-escape (cdr lst) return)))))
+
+(define (product-escape lst)
+  (call/cc (lambda (return) (walk-escape lst return))))
+
+(define (repeat n thunk)
+  (if (> n 1)
+      (begin (thunk) (repeat (- n 1) thunk))
+      (thunk)))
+
+(define (bench name runs thunk)
+  (let* ((start (current-jiffy))
+         (result (repeat runs thunk))
+         (elapsed (- (current-jiffy) start)))
+    (display name)
+    (display ": ")
+    (display (/ elapsed 1000))
+    (display " ms, result ")
+    (display result)
+    (newline)))
+
+(define numbers (make-numbers 1000))
+(define runs 2000)
+
+(bench "return" runs (lambda () (product-return numbers)))
+(bench "flag  " runs (lambda () (product-flag numbers)))
+(bench "escape" runs (lambda () (product-escape numbers)))
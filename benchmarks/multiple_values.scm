@@ -0,0 +1,119 @@
+;; Returning two results at once: as multiple values against as a pair or
+;; a list.
+;;
+;; Two workloads, each written four ways:
+;;   digits   sums the base-7 digits of the integers below 20000, with a
+;;            step that returns both quotient and remainder
+;;   min-max  finds the least and greatest elements of a list in one pass,
+;;            the recursion returning both so far
+;;
+;;   pair              returns (cons a b), taken apart with car and cdr
+;;   list              returns (list a b)
+;;   receive           returns (values a b), bound by receive
+;;   call-with-values  returns (values a b) to a consumer procedure
+;;
+;; Run with:  ./rscheme benchmarks/multiple_values.scm
+;; and compare with --vm. --gc-stats shows the collections the pairs and
+;; lists cost.
+
+(define (divide-pair n d) (cons (quotient n d) (remainder n d)))
+(define (divide-list n d) (list (quotient n d) (remainder n d)))
+(define (divide-values n d) (values (quotient n d) (remainder n d)))
+
+(define (digits-pair n sum)
+  (if (= n 0)
+      sum
+      (let ((qr (divide-pair n 7)))
+        (digits-pair (car qr) (+ sum (cdr qr))))))
+
+(define (digits-list n sum)
+  (if (= n 0)
+      sum
+      (let ((qr (divide-list n 7)))
+        (digits-list (car qr) (+ sum (car (cdr qr)))))))
+
+(define (digits-receive n sum)
+  (if (= n 0)
+      sum
+      (receive (q r) (divide-values n 7)
+        (digits-receive q (+ sum r)))))
+
+(define (digits-call-with-values n sum)
+  (if (= n 0)
+      sum
+      (call-with-values (lambda () (divide-values n 7))
+        (lambda (q r) (digits-call-with-values q (+ sum r))))))
+
+(define (all-digits digits)
+  (define (loop n total)
+    (if (= n 20000)
+        total
+        (loop (+ n 1) (+ total (digits n 0)))))
+  (loop 0 0))
+
+(define (min-max-pair lst)
+  (if (null? (cdr lst))
+      (cons (car lst) (car lst))
+      (let ((rest (min-max-pair (cdr lst))))
+        (cons (min (car lst) (car rest)) (max (car lst) (cdr rest))))))
+
+(define (min-max-list lst)
+  (if (null? (cdr lst))
+      (list (car lst) (car lst))
+      (let ((rest (min-max-list (cdr lst))))
+        (list (min (car lst) (car rest)) (max (car lst) (car (cdr rest)))))))
+
+(define (min-max-receive lst)
+  (if (null? (cdr lst))
+      (values (car lst) (car lst))
+      (receive (low high) (min-max-receive (cdr lst))
+        (values (min (car lst) low) (max (car lst) high)))))
+
+(define (min-max-call-with-values lst)
+  (if (null? (cdr lst))
+      (values (car lst) (car lst))
+      (call-with-values (lambda () (min-max-call-with-values (cdr lst)))
+        (lambda (low high)
+          (values (min (car lst) low) (max (car lst) high))))))
+
+;; A list of n pseudo-random integers
+(define (make-numbers n)
+  (define (build i seed acc)
+    (if (= i 0)
+        acc
+        (let ((next (remainder (+ (* seed 1103515245) 12345) 2147483648)))
+          (build (- i 1) next (cons (remainder next 100000) acc)))))
+  (build n 42 '()))
+
+(define numbers (make-numbers 1000))
+
+(define (repeat n thunk)
+  (if (> n 1)
+      (begin (thunk) (repeat (- n 1) thunk))
+      (thunk)))
+
+(define (bench name runs thunk)
+  (let* ((start (current-jiffy))
+         (result (repeat runs thunk))
+         (elapsed (- (current-jiffy) start)))
+    (display name)
+    (display ": ")
+    (display (/ elapsed 1000))
+    (display " ms, result ")
+    (display result)
+    (newline)))
+
+(define (span pair) (- (cdr pair) (car pair)))
+
+(bench "digits  pair            " 5 (lambda () (all-digits digits-pair)))
+(bench "digits  list            " 5 (lambda () (all-digits digits-list)))
+(bench "digits  receive         " 5 (lambda () (all-digits digits-receive)))
+(bench "digits  call-with-values" 5 (lambda () (all-digits digits-call-with-values)))
+(bench "min-max pair            " 500 (lambda () (span (min-max-pair numbers))))
+(bench "min-max list            " 500
+       (lambda () (let ((r (min-max-list numbers))) (- (car (cdr r)) (car r)))))
+(bench "min-max receive         " 500
+       (lambda () (receive (low high) (min-max-receive numbers) (- high low))))
+(bench "min-max call-with-values" 500
+       (lambda () (call-with-values (lambda () (min-max-call-with-values numbers))
+                    (lambda (low high) (- high low)))))
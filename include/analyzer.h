@@ -0,0 +1,155 @@
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include "scheme_objects.h"
+#include "environment.h"
+
+// Pre-analysis. analyze_expression takes a resolved expression (see
+// resolver.h), classifies each of its forms once and returns a code object
+// whose nodes each carry the function that evaluates them, so running the
+// code never re-inspects the s-expression. Every lambda body becomes a code
+// object of its own, analysed together with the form that contains it and
+// shared by all the closures made from it.
+//
+// Forms that do not analyse cleanly (malformed special forms, anything the
+// resolver left alone) run through eval_expression, which reports their
+// errors as before.
+SchemeObject* analyze_expression(SchemeObject* expr);
+
+// Evaluate analysed code in an environment
+SchemeObject* run_code(SchemeObject* code, Environment* env);
+
+// Call a procedure whose body is analysed code
+SchemeObject* run_procedure(SchemeObject* procedure, int argc, SchemeObject** argv);
+
+// Nodes. The JIT (see jit.h) translates them, so their layout is public.
+typedef SchemeObject* (*NodeFn)(Node* node, Environment* env);
+
+// Type feedback. A call of a numeric operator records the types of the
+// operands it meets and rewrites its node into a version specialized for
+// them: one for fixnums only, or one computing in doubles for fixnums and
+// flonums. A specialized node guards its types with a test of tag bits; on
+// a miss it deoptimizes back to the generic version, which records the new
+// types and specializes again for everything seen. A node that meets a
+// bignum or a non-number, or an operator other than the builtin, stays
+// generic. Flonum nodes
+// compute their arithmetic operands unboxed (see analyzer.c).
+typedef struct NumericProfile NumericProfile;
+
+// An analysed form. Which union member is in use depends on eval.
+struct Node {
+    NodeFn eval;
+    union {
+        SchemeObject* constant;
+        SchemeObject* expr;                // Evaluated by eval_expression
+        struct {
+            int depth;
+            int slot;
+            Node* value;                   // For define and set!
+        } local;
+        struct {
+            SchemeObject* ref;             // Global reference, with its cache
+            SchemeObject* symbol;          // For define and set!
+            Node* value;
+        } global;
+        struct {
+            Node* test;
+            Node* consequent;
+            Node* alternative;
+        } branch;
+        struct {
+            Node** items;
+            int count;
+        } sequence;                        // begin, bodies, and, or
+        struct {
+            Node** tests;                  // NULL for else
+            Node** bodies;                 // NULL for a clause with no body
+            int count;
+        } cond;
+        struct {
+            SchemeObject* code;
+            SchemeObject* params;
+            SchemeObject* body;
+            SchemeObject* layout;
+        } lambda;
+        struct {
+            SchemeObject* layout;
+            SchemeObject* kind;            // Resolved let, let* or letrec head
+            int* slots;
+            Node** inits;
+            int count;
+            Node* body;
+        } let;
+        struct {
+            SchemeObject* layout;
+            SchemeObject** targets;        // Each clause's resolved formals
+            Node** inits;
+            int count;
+            Node* body;
+        } let_values;
+        struct {
+            Node* operator;
+            Node** operands;
+            int argc;
+        } call;
+        struct {
+            Node* operator;                // A global reference
+            Node* operands[2];             // One for negation
+            bool tail;                     // The fallback call is a tail call
+            uint8_t kind;                  // The NodeKind of the operation
+            uint8_t unboxed;               // Bit i: operand i is arithmetic
+            uint8_t seen;                  // Operand types met so far
+            SchemeObject* owner;           // The code object holding the node
+            NumericProfile** profile;      // Shared by the owner's numeric nodes
+        } numeric;
+    };
+};
+
+// What a node does, from its evaluation function, for the JIT
+typedef enum {
+    NODE_CONSTANT,
+    NODE_LOCAL0,
+    NODE_LOCAL,
+    NODE_GLOBAL,
+    NODE_IF,
+    NODE_SEQUENCE,
+    NODE_AND,
+    NODE_OR,
+    NODE_COND,
+    NODE_CALL,
+    NODE_TAIL_CALL,
+    NODE_ADD,
+    NODE_SUBTRACT,
+    NODE_MULTIPLY,
+    NODE_DIVIDE,
+    NODE_NEGATE,
+    NODE_NUM_EQ,
+    NODE_LT,
+    NODE_GT,
+    NODE_LE,
+    NODE_GE,
+    NODE_OTHER                      // Anything else: run through node->eval
+} NodeKind;
+
+NodeKind node_kind(const Node* node);
+
+// The steps of node evaluation that native code calls out for. tail_call
+// leaves a call in tail position to run_code: frame holds the procedure,
+// then argc arguments, on the argument stack. call_numeric makes the
+// ordinary call of a numeric node's operator once its fast path fails.
+// unbound_local reads a local slot nothing was stored in yet (see
+// unassigned_variable).
+SchemeObject* tail_call(SchemeObject** frame, int argc);
+SchemeObject* call_numeric(Node* node, SchemeObject* procedure, int argc,
+                           SchemeObject* first, SchemeObject* second, Environment* env);
+SchemeObject* unbound_local(Environment* frame, int slot);
+
+// Prints, for each body whose numeric nodes specialized, how often they
+// specialized and deoptimized (--feedback-stats)
+void print_feedback_stats(FILE* out);
+void cleanup_feedback(void);
+
+// Releases a code object's nodes; returns the bytes freed
+size_t free_code(SchemeCode* code);
+
+#endif // ANALYZER_H
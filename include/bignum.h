@@ -0,0 +1,73 @@
+#ifndef BIGNUM_H
+#define BIGNUM_H
+
+#include "scheme_objects.h"
+
+// Exact integers. An exact integer is a fixnum while it lies in the fixnum
+// range and a bignum beyond it; every operation here returns the fixnum
+// whenever the value fits, so the two never overlap and a bignum is never
+// eqv to a fixnum. Flonums are a separate kind of number: nothing here
+// accepts or returns one, except the conversions at the end.
+//
+// A bignum's magnitude is an array of 32-bit digits, least significant
+// first, with the sign kept apart. Multiplication switches from the
+// schoolbook method to Karatsuba's at BIGNUM_KARATSUBA_THRESHOLD digits and
+// to Toom-3 at BIGNUM_TOOM3_THRESHOLD; operands of very different lengths
+// are multiplied in slices of the shorter one's length. Division is Knuth's
+// algorithm D, with a single pass for one-digit divisors.
+//
+// The digits live outside the collected heap. Each bignum made is charged
+// to the nursery by its size (see gc_note_external), so garbage bignums
+// bring on minor collections as soon as the cells holding them would.
+
+// Thresholds in digits of the shorter operand; both may be set at build
+// time for tuning
+#ifndef BIGNUM_KARATSUBA_THRESHOLD
+#define BIGNUM_KARATSUBA_THRESHOLD 40
+#endif
+#ifndef BIGNUM_TOOM3_THRESHOLD
+#define BIGNUM_TOOM3_THRESHOLD 150
+#endif
+
+static inline bool is_exact_integer(const SchemeObject* obj) {
+    return is_fixnum(obj) || is_bignum(obj);
+}
+
+// Any intptr_t, which may be beyond the fixnum range
+SchemeObject* make_integer(intptr_t value);
+
+// Arithmetic on exact integers
+SchemeObject* integer_add(SchemeObject* a, SchemeObject* b);
+SchemeObject* integer_subtract(SchemeObject* a, SchemeObject* b);
+SchemeObject* integer_multiply(SchemeObject* a, SchemeObject* b);
+SchemeObject* integer_negate(SchemeObject* a);
+
+// base raised to a non-negative exponent, by repeated squaring
+SchemeObject* integer_expt(SchemeObject* base, uint64_t exponent);
+
+// Truncating division, as quotient and remainder do it: the remainder has
+// the sign of the dividend. The divisor must not be zero; either result
+// pointer may be NULL.
+void integer_divide(SchemeObject* a, SchemeObject* b, SchemeObject** quotient,
+                    SchemeObject** remainder);
+
+// -1, 0 or 1 as a is less than, equal to or greater than b; and as a is
+// less than, equal to or greater than x, which must not be a NaN
+int integer_compare(SchemeObject* a, SchemeObject* b);
+int integer_compare_double(SchemeObject* a, double x);
+
+// -1, 0 or 1 with the sign of a
+int integer_sign(SchemeObject* a);
+
+// The exact integer equal to a finite double with no fractional part
+SchemeObject* integer_from_double(double value);
+
+// Decimal text, as the reader reads it and object_to_string prints it.
+// parse_integer takes an optional sign followed by digits only.
+SchemeObject* parse_integer(const char* text);
+char* integer_to_string(SchemeObject* a);
+
+// Frees the digits of a bignum being collected, returning their size
+size_t free_bignum(SchemeBignum* bignum);
+
+#endif // BIGNUM_H
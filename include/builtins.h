@@ -8,96 +8,187 @@
 void init_builtins(Environment* env);
 
 // Arithmetic operations
-SchemeObject* builtin_add(SchemeObject* args, Environment* env);
-SchemeObject* builtin_subtract(SchemeObject* args, Environment* env);
-SchemeObject* builtin_multiply(SchemeObject* args, Environment* env);
-SchemeObject* builtin_divide(SchemeObject* args, Environment* env);
-SchemeObject* builtin_modulo(SchemeObject* args, Environment* env);
-SchemeObject* builtin_quotient(SchemeObject* args, Environment* env);
-SchemeObject* builtin_remainder(SchemeObject* args, Environment* env);
-SchemeObject* builtin_abs(SchemeObject* args, Environment* env);
-SchemeObject* builtin_max(SchemeObject* args, Environment* env);
-SchemeObject* builtin_min(SchemeObject* args, Environment* env);
+SchemeObject* builtin_add(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_subtract(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_multiply(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_divide(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_modulo(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_quotient(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_remainder(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_abs(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_max(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_min(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_expt(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_exact_p(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_inexact_p(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_exact_to_inexact(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_inexact_to_exact(int argc, SchemeObject** argv, Environment* env);
 
 // Comparison operations
-SchemeObject* builtin_num_eq(SchemeObject* args, Environment* env);
-SchemeObject* builtin_eq(SchemeObject* args, Environment* env);
-SchemeObject* builtin_eqv(SchemeObject* args, Environment* env);
-SchemeObject* builtin_equal(SchemeObject* args, Environment* env);
-SchemeObject* builtin_lt(SchemeObject* args, Environment* env);
-SchemeObject* builtin_le(SchemeObject* args, Environment* env);
-SchemeObject* builtin_gt(SchemeObject* args, Environment* env);
-SchemeObject* builtin_ge(SchemeObject* args, Environment* env);
+SchemeObject* builtin_num_eq(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_eq(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_eqv(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_equal(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_lt(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_le(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_gt(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_ge(int argc, SchemeObject** argv, Environment* env);
 
 // List operations
-SchemeObject* builtin_cons(SchemeObject* args, Environment* env);
-SchemeObject* builtin_car(SchemeObject* args, Environment* env);
-SchemeObject* builtin_cdr(SchemeObject* args, Environment* env);
-SchemeObject* builtin_list(SchemeObject* args, Environment* env);
-SchemeObject* builtin_length(SchemeObject* args, Environment* env);
-SchemeObject* builtin_append(SchemeObject* args, Environment* env);
-SchemeObject* builtin_reverse(SchemeObject* args, Environment* env);
-SchemeObject* builtin_list_ref(SchemeObject* args, Environment* env);
+SchemeObject* builtin_cons(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_car(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_cdr(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_list(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_length(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_append(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_reverse(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_list_ref(int argc, SchemeObject** argv, Environment* env);
 
 // Type predicates
-SchemeObject* builtin_null_p(SchemeObject* args, Environment* env);
-SchemeObject* builtin_pair_p(SchemeObject* args, Environment* env);
-SchemeObject* builtin_list_p(SchemeObject* args, Environment* env);
-SchemeObject* builtin_number_p(SchemeObject* args, Environment* env);
-SchemeObject* builtin_string_p(SchemeObject* args, Environment* env);
-SchemeObject* builtin_symbol_p(SchemeObject* args, Environment* env);
-SchemeObject* builtin_boolean_p(SchemeObject* args, Environment* env);
-SchemeObject* builtin_procedure_p(SchemeObject* args, Environment* env);
+SchemeObject* builtin_null_p(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_pair_p(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_list_p(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_number_p(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_string_p(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_symbol_p(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_boolean_p(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_procedure_p(int argc, SchemeObject** argv, Environment* env);
 
 // String operations
-SchemeObject* builtin_string_length(SchemeObject* args, Environment* env);
-SchemeObject* builtin_string_ref(SchemeObject* args, Environment* env);
-SchemeObject* builtin_string_append(SchemeObject* args, Environment* env);
-SchemeObject* builtin_string_to_symbol(SchemeObject* args, Environment* env);
-SchemeObject* builtin_symbol_to_string(SchemeObject* args, Environment* env);
-SchemeObject* builtin_number_to_string(SchemeObject* args, Environment* env);
-SchemeObject* builtin_string_to_number(SchemeObject* args, Environment* env);
+SchemeObject* builtin_string_length(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_string_ref(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_string_append(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_string_to_symbol(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_symbol_to_string(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_number_to_string(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_string_to_number(int argc, SchemeObject** argv, Environment* env);
 
 // Character operations
-SchemeObject* builtin_char_p(SchemeObject* args, Environment* env);
-SchemeObject* builtin_char_eq(SchemeObject* args, Environment* env);
-SchemeObject* builtin_char_lt(SchemeObject* args, Environment* env);
-SchemeObject* builtin_char_gt(SchemeObject* args, Environment* env);
-SchemeObject* builtin_char_le(SchemeObject* args, Environment* env);
-SchemeObject* builtin_char_ge(SchemeObject* args, Environment* env);
-SchemeObject* builtin_char_alphabetic(SchemeObject* args, Environment* env);
-SchemeObject* builtin_char_numeric(SchemeObject* args, Environment* env);
-SchemeObject* builtin_char_whitespace(SchemeObject* args, Environment* env);
-SchemeObject* builtin_char_upcase(SchemeObject* args, Environment* env);
-SchemeObject* builtin_char_downcase(SchemeObject* args, Environment* env);
-SchemeObject* builtin_char_to_integer(SchemeObject* args, Environment* env);
-SchemeObject* builtin_integer_to_char(SchemeObject* args, Environment* env);
+SchemeObject* builtin_char_p(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_char_eq(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_char_lt(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_char_gt(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_char_le(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_char_ge(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_char_alphabetic(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_char_numeric(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_char_whitespace(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_char_upcase(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_char_downcase(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_char_to_integer(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_integer_to_char(int argc, SchemeObject** argv, Environment* env);
 
 // Vector operations
-SchemeObject* builtin_make_vector(SchemeObject* args, Environment* env);
-SchemeObject* builtin_vector(SchemeObject* args, Environment* env);
-SchemeObject* builtin_vector_length(SchemeObject* args, Environment* env);
-SchemeObject* builtin_vector_ref(SchemeObject* args, Environment* env);
-SchemeObject* builtin_vector_set(SchemeObject* args, Environment* env);
+SchemeObject* builtin_make_vector(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_vector(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_vector_length(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_vector_ref(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_vector_set(int argc, SchemeObject** argv, Environment* env);
 
 // I/O operations
-SchemeObject* builtin_display(SchemeObject* args, Environment* env);
-SchemeObject* builtin_newline(SchemeObject* args, Environment* env);
-SchemeObject* builtin_write(SchemeObject* args, Environment* env);
-SchemeObject* builtin_read(SchemeObject* args, Environment* env);
+SchemeObject* builtin_display(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_newline(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_write(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_read(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_load(int argc, SchemeObject** argv, Environment* env);
 
 // Control flow
-SchemeObject* builtin_apply(SchemeObject* args, Environment* env);
-SchemeObject* builtin_map(SchemeObject* args, Environment* env);
-SchemeObject* builtin_for_each(SchemeObject* args, Environment* env);
+SchemeObject* builtin_apply(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_map(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_for_each(int argc, SchemeObject** argv, Environment* env);
 
 // Logical operations
-SchemeObject* builtin_not(SchemeObject* args, Environment* env);
+SchemeObject* builtin_not(int argc, SchemeObject** argv, Environment* env);
 
-// Utility functions
-int count_args(SchemeObject* args);
-SchemeObject* get_arg(SchemeObject* args, int index);
-bool check_arity(SchemeObject* args, int expected);
-bool check_min_arity(SchemeObject* args, int min);
+// Time
+SchemeObject* builtin_current_jiffy(int argc, SchemeObject** argv, Environment* env);
+SchemeObject* builtin_jiffies_per_second(int argc, SchemeObject** argv, Environment* env);
+
+// Inline fast paths of the arithmetic and comparison primitives. The
+// evaluators run them for calls of + - * / = < > <= >= whose operator is
+// still bound to the builtin; each returns the primitive's result for
+// operands it handles, or NULL when the primitive itself must be called.
+
+// True if proc is the primitive implemented by fn
+static inline bool is_builtin(const SchemeObject* proc, PrimitiveFn fn) {
+    return is_heap_object(proc) && proc->type == SCHEME_PRIMITIVE && proc->value.primitive == fn;
+}
+
+static inline bool fixnum_in_range(intptr_t value) {
+    return value >= SCHEME_FIXNUM_MIN && value <= SCHEME_FIXNUM_MAX;
+}
+
+// Fixnums this small multiply without leaving the exact range of a double
+#define SMALL_FACTOR ((intptr_t)1 << (sizeof(intptr_t) >= 8 ? 26 : 15))
+
+static inline SchemeObject* fast_add(SchemeObject* a, SchemeObject* b) {
+    if (is_fixnum(a) && is_fixnum(b)) {
+        intptr_t sum = fixnum_value(a) + fixnum_value(b);
+        if (fixnum_in_range(sum)) {
+            return make_fixnum(sum);
+        }
+    }
+    return NULL;
+}
+
+static inline SchemeObject* fast_subtract(SchemeObject* a, SchemeObject* b) {
+    if (is_fixnum(a) && is_fixnum(b)) {
+        intptr_t difference = fixnum_value(a) - fixnum_value(b);
+        if (fixnum_in_range(difference)) {
+            return make_fixnum(difference);
+        }
+    }
+    return NULL;
+}
+
+static inline SchemeObject* fast_multiply(SchemeObject* a, SchemeObject* b) {
+    if (is_fixnum(a) && is_fixnum(b)) {
+        intptr_t x = fixnum_value(a);
+        intptr_t y = fixnum_value(b);
+        if (x >= -SMALL_FACTOR && x <= SMALL_FACTOR && y >= -SMALL_FACTOR && y <= SMALL_FACTOR) {
+            return make_fixnum(x * y);
+        }
+    }
+    return NULL;
+}
+
+// Exact quotients only; the rest become flonums in builtin_divide
+static inline SchemeObject* fast_divide(SchemeObject* a, SchemeObject* b) {
+    if (is_fixnum(a) && is_fixnum(b)) {
+        intptr_t dividend = fixnum_value(a);
+        intptr_t divisor = fixnum_value(b);
+        if (divisor != 0 && dividend % divisor == 0) {
+            return make_fixnum(dividend / divisor);
+        }
+    }
+    return NULL;
+}
+
+static inline SchemeObject* fast_negate(SchemeObject* a) {
+    // The fixnum range is symmetric
+    return is_fixnum(a) ? make_fixnum(-fixnum_value(a)) : NULL;
+}
+
+// Comparisons need no allocation, so flonums are handled too; bignums are
+// left to the builtins, which compare them exactly. Tagged fixnums order
+// the same way as their values.
+#define FAST_COMPARISON(name, op) \
+    static inline SchemeObject* name(SchemeObject* a, SchemeObject* b) { \
+        if (is_fixnum(a) && is_fixnum(b)) { \
+            return (intptr_t)a op (intptr_t)b ? SCHEME_TRUE_OBJECT : SCHEME_FALSE_OBJECT; \
+        } \
+        if ((is_fixnum(a) || is_flonum(a)) && (is_fixnum(b) || is_flonum(b))) { \
+            return number_value(a) op number_value(b) ? SCHEME_TRUE_OBJECT : SCHEME_FALSE_OBJECT; \
+        } \
+        return NULL; \
+    }
+
+FAST_COMPARISON(fast_num_eq, ==)
+FAST_COMPARISON(fast_lt, <)
+FAST_COMPARISON(fast_gt, >)
+FAST_COMPARISON(fast_le, <=)
+FAST_COMPARISON(fast_ge, >=)
+
+#undef FAST_COMPARISON
 
 #endif // BUILTINS_H
\ No newline at end of file
@@ -0,0 +1,116 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "scheme_objects.h"
+
+// Bytecode for the VM (see vm.h). Instructions are 32-bit words: an opcode
+// followed by its operands. Jump targets are word offsets from the start of
+// the code. Every expression leaves exactly one value on the operand stack.
+//
+// Each entry gives the opcode and its operand count.
+#define BYTECODE_OPCODES(X) \
+    X(OP_CONST, 1)                  /* k          push constants[k] */ \
+    X(OP_LOCAL, 1)                  /* i          push stack slot i */ \
+    X(OP_STORE_LOCAL, 1)            /* i          pop into stack slot i */ \
+    X(OP_ENV, 2)                    /* d i        push slot i of the frame d up */ \
+    X(OP_STORE_ENV, 2)              /* d i        pop into slot i of the frame d up */ \
+    X(OP_GLOBAL, 1)                 /* k          push the global constants[k] refers to */ \
+    X(OP_DEFINE_GLOBAL, 1)          /* k          pop and define symbol constants[k] */ \
+    X(OP_SET_GLOBAL, 1)             /* k          pop and assign symbol constants[k] */ \
+    X(OP_POP, 0) \
+    X(OP_JUMP, 1)                   /* target */ \
+    X(OP_JUMP_IF_FALSE, 1)          /* target     pop; jump if #f */ \
+    X(OP_JUMP_IF_FALSE_OR_POP, 1)   /* target     jump if #f, keeping it; else pop */ \
+    X(OP_JUMP_IF_TRUE_OR_POP, 1)    /* target     jump unless #f, keeping it; else pop */ \
+    X(OP_CLOSURE, 1)                /* k          push a closure over bytecode constants[k] */ \
+    X(OP_ENTER_FRAME, 1)            /* k          new environment frame, layout constants[k] */ \
+    X(OP_LEAVE_FRAME, 0) \
+    X(OP_CALL, 1)                   /* n          call the procedure below n arguments */ \
+    X(OP_RETURN, 0) \
+    X(OP_EVAL, 1)                   /* k          evaluate constants[k] with eval_expression */ \
+    X(OP_SPREAD_VALUES, 2)          /* n r        pop; push its first n values, then if r */ \
+                                    /*            a list of the others */ \
+    /* Superinstructions. g is the constant index of a global reference; */ \
+    /* when its value is not a primitive they make an ordinary call. */ \
+    X(OP_CALL_LOCAL_CONST, 3)       /* g i k      call g on slot i and constants[k] */ \
+    X(OP_CALL_LOCAL_LOCAL, 3)       /* g i j      call g on slots i and j */ \
+    X(OP_CAR, 1)                    /* g          call g, normally car, on the top value */ \
+    X(OP_CDR, 1)                    /* g          likewise cdr */ \
+    X(OP_LOCAL_CAR, 2)              /* i g        OP_LOCAL then OP_CAR */ \
+    X(OP_LOCAL_CDR, 2)              /* i g        OP_LOCAL then OP_CDR */ \
+    X(OP_LOCAL_LOCAL, 2)            /* i j        OP_LOCAL i then OP_LOCAL j */ \
+    X(OP_LOCAL_CONST, 2)            /* i k        OP_LOCAL then OP_CONST */ \
+    /* Arithmetic on the top two values, or the top one for OP_NEGATE. */ \
+    /* While g is bound to the builtin, fixnum operands (and flonums, for */ \
+    /* comparisons) are handled inline; otherwise they make a call. */ \
+    X(OP_ADD, 1)                    /* g          call g, normally +, on the top two values */ \
+    X(OP_SUBTRACT, 1)               /* g          likewise - */ \
+    X(OP_MULTIPLY, 1)               /* g          likewise * */ \
+    X(OP_DIVIDE, 1)                 /* g          likewise / */ \
+    X(OP_NEGATE, 1)                 /* g          call g, normally -, on the top value */ \
+    X(OP_NUM_EQ, 1)                 /* g          likewise = on the top two values */ \
+    X(OP_LT, 1)                     /* g          likewise < */ \
+    X(OP_GT, 1)                     /* g          likewise > */ \
+    X(OP_LE, 1)                     /* g          likewise <= */ \
+    X(OP_GE, 1)                     /* g          likewise >= */ \
+    /* Compare-and-branch: a call fused with the OP_JUMP_IF_FALSE that */ \
+    /* follows it, which stays in place for calls that return through the */ \
+    /* VM and for jumps that land on it */ \
+    X(OP_CALL_JUMP_IF_FALSE, 1)     /* n */ \
+    X(OP_BRANCH_LOCAL_CONST, 3)     /* g i k */ \
+    X(OP_BRANCH_LOCAL_LOCAL, 3)     /* g i j */ \
+    X(OP_BRANCH_NUM_EQ, 1)          /* g          in the order of OP_NUM_EQ to OP_GE */ \
+    X(OP_BRANCH_LT, 1)              /* g */ \
+    X(OP_BRANCH_GT, 1)              /* g */ \
+    X(OP_BRANCH_LE, 1)              /* g */ \
+    X(OP_BRANCH_GE, 1)              /* g */
+
+#define BYTECODE_ENUM(op, operands) op,
+typedef enum {
+    BYTECODE_OPCODES(BYTECODE_ENUM)
+    OPCODE_COUNT
+} Opcode;
+#undef BYTECODE_ENUM
+
+extern const char* const opcode_names[OPCODE_COUNT];
+extern const int opcode_operands[OPCODE_COUNT];
+
+// A word of threaded code: the handler an opcode dispatches to, or an
+// operand. The VM builds the threaded form of each bytecode object when it
+// is compiled (see vm.h).
+typedef union {
+    const void* handler;
+    intptr_t operand;
+} ThreadedWord;
+
+// A compiled top-level form or lambda body. Locals live either in stack
+// slots of the VM frame (when nothing in the body can capture them) or, as
+// in the tree-walker, in environment frames laid out by the resolver.
+struct Bytecode {
+    int32_t* code;
+    ThreadedWord* threaded;
+    int code_length;
+    int code_capacity;
+    SchemeObject** constants;
+    int constant_count;
+    int constant_capacity;
+    SchemeObject* source;          // The form compiled
+    SchemeObject* params;          // Lambda bodies: the parameter list
+    SchemeObject* layout;          // Lambda bodies: the frame layout
+    SchemeObject* body;            // Lambda bodies: the body expressions
+    int param_count;               // Required parameters
+    bool has_rest;
+    bool heap_frames;              // Locals live in environment frames
+    int local_count;               // Stack slots holding locals
+    SchemeObject** local_names;    // Their names, for error messages
+    int max_stack;                 // Deepest the operand stack gets
+};
+
+// Compiles a resolved expression (see resolver.h) into a bytecode object
+SchemeObject* compile_bytecode(SchemeObject* expr);
+
+// Collector support
+void mark_bytecode_children(Bytecode* bc);
+size_t free_bytecode(Bytecode* bc);
+
+#endif // BYTECODE_H
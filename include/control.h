@@ -0,0 +1,112 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <setjmp.h>
+#include "scheme_objects.h"
+#include "environment.h"
+#include "interpreter.h"
+
+// First-class continuations, dynamic-wind, and exceptions.
+//
+// Under the VM call/cc seals the running stack segment into the
+// continuation (see vm.h), so a capture costs O(1) whatever the depth, and
+// invoking it copies back only the frame it resumes. The tree-walker keeps
+// its continuation on the C stack, so there call/cc makes escape-only
+// continuations, usable until the call/cc that made them returns.
+//
+// Errors and escapes leave C code by longjmp to a catch frame, so nothing
+// on the normal path of evaluation tests for them. An escape travels as a
+// pending escape in the error state: each catch frame between the caller
+// and the target passes it on, and the call/cc (or VM entry) the
+// continuation belongs to takes it. dynamic-wind's after thunks run when
+// the target rewinds to the extent it was captured in.
+//
+// with-exception-handler, raise and guard are built on these. Handlers run
+// in the dynamic context of the raise, and an error the evaluator signals
+// reaches them as an error object; guard is call/cc around a handler that
+// escapes to it.
+
+// A point a non-local exit returns to. The frame is pushed, then setjmp
+// called on its jump buffer where it is set up:
+//
+//     CatchFrame catcher;
+//     push_catch(&catcher);
+//     if (setjmp(catcher.jump)) {
+//         // Unwound to here; the frame is already popped
+//     }
+//     ...
+//     pop_catch(&catcher);
+//
+// By the time setjmp returns again the argument stack and the VM's entries
+// are as they were when the frame was pushed. A catch frame that does not
+// handle what reached it calls throw_error to pass it on.
+typedef struct CatchFrame {
+    struct CatchFrame* outer;
+    jmp_buf jump;
+    ArgumentMark arguments;
+    size_t vm_entry;
+} CatchFrame;
+
+void push_catch(CatchFrame* frame);
+void pop_catch(CatchFrame* frame);
+
+// Unwind to the innermost catch frame; returns only if there is none
+void throw_error(void);
+
+// Offer an error the evaluator found to the innermost exception handler, as
+// an error object. Returns if there is no handler.
+void signal_error(const char* message);
+
+// Forget the dynamic state of an evaluation that failed: extents,
+// handlers, and any escape
+void reset_control(void);
+
+// Deep recursion. The tree-walker and the JIT nest C frames for each
+// non-tail call, as the VM does each time a primitive calls back into it,
+// so the C stack bounds how deep they recurse. Past stack_limit a call
+// raises "stack depth exceeded" instead, an error handlers can catch; they
+// run in a reserve of stack beyond the limit, which stays open to them
+// until the next non-local exit.
+extern char* stack_limit;
+
+// Sets the limit for a stack whose outermost frame holds bottom, from the
+// size the system allows it
+void set_stack_limit(void* bottom);
+
+void stack_depth_exceeded(void);
+
+static inline void check_stack_depth(void) {
+    char here;
+    if (&here < stack_limit) {
+        stack_depth_exceeded();
+    }
+}
+
+// Installs call/cc, dynamic-wind, the exception procedures and their
+// support procedures
+void init_control(Environment* env);
+
+SchemeObject* builtin_call_cc(int argc, SchemeObject** argv, Environment* env);
+
+// Invoke a continuation from C: starts the escape to it
+SchemeObject* throw_to_continuation(SchemeObject* k, int argc, SchemeObject** argv);
+
+// The value passed to a continuation: its one argument, or () for none
+SchemeObject* continuation_value(int argc, SchemeObject** argv);
+
+// The continuation a pending escape is headed for, or NULL if there is no
+// escape pending. take_escape ends the escape and returns its value.
+SchemeObject* pending_escape(void);
+SchemeObject* take_escape(void);
+
+// Record the dynamic-wind entries and exception handlers in force in a
+// continuation being captured
+void capture_extent(SchemeObject* k);
+
+// Return to the extent a continuation was captured in: run the after
+// thunks of the dynamic extents being left, innermost first, then the
+// before thunks of those being entered, outermost first, and reinstate its
+// handlers
+void rewind_to(SchemeObject* k);
+
+#endif // CONTROL_H
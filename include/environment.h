@@ -3,26 +3,77 @@
 
 #include "scheme_objects.h"
 
-// Environment binding
+// Environment binding. A binding cell stays at the same address for the
+// life of its environment, so a caller may keep a pointer to it.
 typedef struct Binding {
-    char* name;
+    SchemeObject* symbol;      // Interned
     SchemeObject* value;
     struct Binding* next;
 } Binding;
 
+// Frames with more than this many bindings (the global frame, mostly) are
+// indexed by an open-addressing hash table on the symbol's hash; smaller
+// frames are searched linearly.
+#define ENV_HASH_THRESHOLD 8
+
+// Frames built for resolved code hold their variables in a slot vector
+// laid out by the resolver; small ones use the slots inside the cell.
+#define ENV_INLINE_SLOTS 4
+
 // Environment structure
 typedef struct Environment {
-    Binding* bindings;
+    SchemeObject** slots;      // NULL unless the frame has a layout
+    SchemeObject* layout;      // Vector of slot names
+    SchemeObject* inline_slots[ENV_INLINE_SLOTS];
+    Binding* bindings;         // Variables defined by name
+    Binding** table;           // NULL until the frame outgrows the threshold
+    size_t table_capacity;     // Power of two
+    size_t binding_count;
     struct Environment* parent;
     int ref_count;
+    bool marked;
+    uint8_t generation;
+    bool remembered;
 } Environment;
 
 // Environment creation and destruction
 Environment* make_environment(Environment* parent);
+Environment* make_frame(Environment* parent, SchemeObject* layout);
 void retain_environment(Environment* env);
 void release_environment(Environment* env);
 
-// Variable operations
+// Garbage collection support
+void mark_environment(Environment* env);
+void mark_environment_bindings(Environment* env);
+void mark_environment_children(Environment* env);
+size_t finalize_environment(Environment* env);
+
+// Slot access for resolved references
+static inline Environment* frame_at_depth(Environment* env, int depth) {
+    while (depth-- > 0) {
+        env = env->parent;
+    }
+    return env;
+}
+
+void set_frame_slot(Environment* env, int slot, SchemeObject* value);
+
+// Variable operations keyed by interned symbol. These see slot variables
+// too, by name.
+void define_symbol(Environment* env, SchemeObject* symbol, SchemeObject* value);
+void set_symbol(Environment* env, SchemeObject* symbol, SchemeObject* value);
+bool set_symbol_if_exists(Environment* env, SchemeObject* symbol, SchemeObject* value);
+SchemeObject* lookup_symbol(Environment* env, SchemeObject* symbol);
+
+// Global binding cells for inline caches. lookup_global_binding returns the
+// cell a name resolves to when it is in the outermost frame (which lives as
+// long as the program) and no nearer frame binds it. Creating any binding
+// bumps binding_version, which is the only thing that can change that
+// answer, so a cached cell is good while the version is unchanged.
+extern uint64_t binding_version;
+Binding* lookup_global_binding(Environment* env, SchemeObject* symbol);
+
+// Variable operations by name
 void define_variable(Environment* env, const char* name, SchemeObject* value);
 void set_variable(Environment* env, const char* name, SchemeObject* value);
 bool set_variable_if_exists(Environment* env, const char* name, SchemeObject* value);
@@ -32,6 +83,8 @@ bool is_bound(Environment* env, const char* name);
 // Standard environment creation
 Environment* make_global_environment(void);
 Environment* extend_environment(Environment* base, SchemeObject* vars, SchemeObject* vals);
+Environment* extend_environment_argv(Environment* base, SchemeObject* vars, SchemeObject* layout,
+                                     int argc, SchemeObject** argv);
 
 // Environment utilities
 void print_environment(Environment* env, FILE* out);
@@ -0,0 +1,161 @@
+#ifndef GC_H
+#define GC_H
+
+#include <stdio.h>
+#include "scheme_objects.h"
+#include "environment.h"
+
+// Kinds of cells managed by the collector
+typedef enum {
+    GC_CELL_OBJECT,
+    GC_CELL_ENVIRONMENT,
+    GC_CELL_PAIR,
+    GC_CELL_KIND_COUNT
+} GCCellKind;
+
+// Generations. Fresh cells are zero-filled and therefore young; survivors
+// of a collection are promoted in place.
+typedef enum {
+    GC_YOUNG = 0,
+    GC_OLD = 1
+} GCGeneration;
+
+// Pair cells carry no header. Each pair chunk is a block aligned to its
+// size whose first bytes hold one flag byte per 16-byte slot; the slots
+// those bytes occupy are not used for pairs. A pair's flags are found by
+// masking its address.
+#define GC_PAIR_BLOCK_SIZE 16384
+#define GC_PAIR_HEADER_SLOTS (GC_PAIR_BLOCK_SIZE / sizeof(SchemePair) / sizeof(SchemePair))
+#define GC_PAIRS_PER_CHUNK (GC_PAIR_BLOCK_SIZE / sizeof(SchemePair) - GC_PAIR_HEADER_SLOTS)
+
+#define GC_PAIR_MARKED      0x1
+#define GC_PAIR_OLD         0x2
+#define GC_PAIR_REMEMBERED  0x4
+
+static inline uint8_t* gc_pair_flags(const SchemePair* pair) {
+    uintptr_t block = (uintptr_t)pair & ~(uintptr_t)(GC_PAIR_BLOCK_SIZE - 1);
+    return (uint8_t*)block + ((uintptr_t)pair - block) / sizeof(SchemePair);
+}
+
+// Collector statistics
+typedef struct {
+    size_t collections;
+    size_t minor_collections;
+    size_t major_collections;
+    size_t promoted_cells;
+    size_t live_cells;
+    size_t heap_bytes;
+    size_t cells_allocated;      // Since startup
+    size_t last_reclaimed_bytes;
+    size_t total_reclaimed_bytes;
+    double last_pause_us;
+    double max_pause_us;
+    double total_pause_us;
+    size_t incremental_cycles;
+    size_t incremental_steps;
+    double max_step_us;
+    double total_step_us;
+} GCStats;
+
+// Collector lifecycle
+void gc_init(void);
+void gc_cleanup(void);
+
+// The collector scans the C stack conservatively between the current stack
+// pointer and this address. Until it is set, collections are skipped.
+void gc_set_stack_bottom(void* bottom);
+
+// Cell allocation (zero-filled); may trigger a collection
+SchemeObject* gc_allocate_object(void);
+Environment* gc_allocate_environment(void);
+SchemePair* gc_allocate_pair(void);
+
+// Charges the nursery for storage a cell about to be allocated will own
+// outside the heap, so that garbage holding much of it is collected sooner
+void gc_note_external(size_t bytes);
+
+// Root registration
+void gc_add_root(SchemeObject** root);
+void gc_remove_root(SchemeObject** root);
+void gc_add_environment_root(Environment* env);
+void gc_remove_environment_root(Environment* env);
+
+// Write barrier: an old cell that receives a pointer to a young one is
+// added to the remembered set scanned by minor collections. Immediates are
+// not cells and never need remembering.
+void gc_remember_object(SchemeObject* owner);
+void gc_remember_environment(Environment* owner);
+void gc_remember_pair(SchemePair* owner);
+
+static inline bool gc_is_young_value(const SchemeObject* value) {
+    if (is_pair(value)) {
+        return !(*gc_pair_flags(pair_cell(value)) & GC_PAIR_OLD);
+    }
+    return is_heap_object(value) && value->generation == GC_YOUNG;
+}
+
+static inline void gc_write_barrier(SchemeObject* owner, SchemeObject* value) {
+    if (owner->generation == GC_OLD && !owner->remembered && gc_is_young_value(value)) {
+        gc_remember_object(owner);
+    }
+}
+
+static inline void gc_write_barrier_environment(Environment* owner, SchemeObject* value) {
+    if (owner->generation == GC_OLD && !owner->remembered && gc_is_young_value(value)) {
+        gc_remember_environment(owner);
+    }
+}
+
+static inline void gc_write_barrier_pair(SchemePair* owner, SchemeObject* value) {
+    uint8_t flags = *gc_pair_flags(owner);
+    if ((flags & (GC_PAIR_OLD | GC_PAIR_REMEMBERED)) == GC_PAIR_OLD && gc_is_young_value(value)) {
+        gc_remember_pair(owner);
+    }
+}
+
+// Mark stack. The marking functions mark a cell and push it (it is now
+// gray); the collector pops and traces gray cells until none are left, so
+// marking needs no C stack however deep the heap is.
+void gc_push_gray_object(SchemeObject* obj);
+void gc_push_gray_environment(Environment* env);
+
+// Incremental full collections. A cycle snapshots the roots, then drains
+// the mark stack in bounded steps interleaved with allocation and sweeps
+// the old generation lazily the same way; minor collections carry on
+// meanwhile.
+extern bool gc_incremental_marking;
+
+// Snapshot barrier: a pointer about to be overwritten during marking is
+// shaded first, so every cell reachable when the cycle began gets marked
+static inline void gc_snapshot_barrier(SchemeObject* overwritten) {
+    if (gc_incremental_marking) {
+        mark_object(overwritten);
+    }
+}
+
+// A cell handed out by a weak table (the symbol table) must survive an
+// in-progress cycle even if nothing else referenced it
+void gc_read_weak(SchemeObject* obj);
+
+// Whether cells of a generation are traced by the collection in progress
+bool gc_is_traced(uint8_t generation);
+
+// Collection control
+void gc_run(void);        // Full collection
+void gc_run_minor(void);  // Young generation only
+void gc_enable(void);
+void gc_disable(void);
+bool gc_is_enabled(void);
+void gc_set_threshold(size_t cells);
+size_t gc_get_threshold(void);
+void gc_set_nursery_size(size_t cells);
+size_t gc_get_nursery_size(void);
+void gc_set_pause_budget(double us);     // 0 collects the old generation stop-the-world
+double gc_get_pause_budget(void);
+void gc_set_verbose(bool enabled);
+
+// Statistics
+const GCStats* gc_get_stats(void);
+void gc_print_stats(FILE* out);
+
+#endif // GC_H
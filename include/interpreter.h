@@ -8,6 +8,22 @@
 SchemeObject* eval_expression(SchemeObject* expr, Environment* env);
 SchemeObject* eval_sequence(SchemeObject* exprs, Environment* env);
 
+// Resolves a top-level form (see resolver.h), then either analyses it and
+// runs the tree (analyzer.h) or compiles it for the VM (bytecode.h, vm.h),
+// depending on the execution engine
+SchemeObject* eval_toplevel(SchemeObject* expr, Environment* env);
+
+// The same without a catch frame of its own: an error unwinds past it to
+// the caller's, as from any other evaluation
+SchemeObject* eval_form(SchemeObject* expr, Environment* env);
+
+typedef enum {
+    ENGINE_TREE,
+    ENGINE_VM
+} ExecutionEngine;
+
+void set_execution_engine(ExecutionEngine engine);
+
 // Special forms
 SchemeObject* eval_if(SchemeObject* args, Environment* env);
 SchemeObject* eval_cond(SchemeObject* args, Environment* env);
@@ -24,8 +40,59 @@ SchemeObject* eval_quasiquote(SchemeObject* args, Environment* env);
 SchemeObject* eval_unquote(SchemeObject* args, Environment* env);
 SchemeObject* eval_begin(SchemeObject* args, Environment* env);
 
-// Application
+// Resolved forms; kind is the resolved let, let* or letrec head
+SchemeObject* eval_resolved_lambda(SchemeObject* args, Environment* env);
+SchemeObject* eval_resolved_let(SchemeObject* kind, SchemeObject* args, Environment* env);
+SchemeObject* eval_resolved_let_values(SchemeObject* args, Environment* env);
+
+// Application. apply_procedure takes its arguments as a list;
+// apply_procedure_argv takes them as an array, which is how the evaluator
+// calls.
 SchemeObject* apply_procedure(SchemeObject* proc, SchemeObject* args, Environment* env);
+SchemeObject* apply_procedure_argv(SchemeObject* proc, int argc, SchemeObject** argv, Environment* env);
+
+// Argument stack. Calls evaluate their operands into a frame pushed here
+// instead of consing a list. Frames are popped in reverse order and never
+// move while pushed. The collector treats live frames as roots.
+SchemeObject** push_arguments(int count);
+void pop_arguments(int count);
+void mark_argument_stack(void);
+void cleanup_argument_stack(void);
+
+// Where the argument stack stands, for cutting it back to after a
+// non-local exit (see control.h)
+typedef struct {
+    struct ArgBlock* block;
+    size_t top;
+} ArgumentMark;
+
+ArgumentMark mark_arguments(void);
+void unwind_arguments(ArgumentMark mark);
+
+// Global references (see resolver.h). A hit in the reference's inline
+// cache reads the binding cell directly; lookup_global_ref is the slow path
+// and refills the cache.
+extern size_t global_cache_hits;
+SchemeObject* lookup_global_ref(SchemeObject* ref, Environment* env);
+
+static inline SchemeObject* eval_global_ref(SchemeObject* ref, Environment* env) {
+    Binding* binding = ref->value.global_binding;
+    if (binding && ref->value.global_version == binding_version) {
+        global_cache_hits++;
+        return binding->value;
+    }
+    return lookup_global_ref(ref, env);
+}
+
+// Local references read a slot, which stays empty until its variable is
+// assigned: a letrec variable before its initialiser has run, or an
+// internal define that has not run, perhaps because it sits in a branch
+// not taken. Until then the name means what it would without the define,
+// so unassigned_variable looks it up from the frame's parent, env.
+SchemeObject* unassigned_variable(Environment* env, SchemeObject* name);
+
+// Statistics (global reference cache hit rate)
+void print_interpreter_stats(FILE* out);
 
 // Type checking for special forms
 bool is_special_form(SchemeObject* expr);
@@ -54,10 +121,16 @@ typedef enum {
     EVAL_ERROR_INVALID_SYNTAX,
     EVAL_ERROR_DIVISION_BY_ZERO,
     EVAL_ERROR_FILE_NOT_FOUND,
-    EVAL_ERROR_RUNTIME
+    EVAL_ERROR_RUNTIME,
+    EVAL_ESCAPE                 // Not an error: a continuation being invoked
 } EvalError;
 
+// Errors do not return through the evaluator. While code is being
+// evaluated set_eval_error first offers the error to the exception handlers
+// in force (see control.h), then records it and unwinds to the innermost
+// catch frame; it returns only when there is none, as when compiling.
 void set_eval_error(EvalError error, const char* message);
+EvalError get_eval_error(void);
 void print_eval_error(FILE* out);
 bool has_eval_error(void);
 void clear_eval_error(void);
@@ -0,0 +1,64 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include "scheme_objects.h"
+#include "environment.h"
+
+// Baseline JIT for the tree-walker. A lambda body entered jit_threshold
+// times is translated, node by node, into x86-64 machine code in pages of
+// its own, which then runs in place of the nodes whenever the body is
+// entered. Constants, variable references, if, and, or, cond, sequences,
+// calls, and the numeric nodes (see analyzer.c) are compiled: a numeric
+// node still checks its operator is the builtin and its operands fixnums,
+// and calls the generic path otherwise. Every other node is called through
+// its evaluation function, so the machine code never does less than the
+// interpreter would.
+//
+// Machine code obeys the interpreter's protocols: it returns a tail call
+// to run_code as a node does, and errors leave it by longjmp, which needs
+// no unwinding of its frames. Its values are on the C stack and in
+// registers, where the collector's conservative scan finds them.
+//
+// Only built for x86-64 with the System V calling convention; elsewhere
+// the threshold is 0 and nothing is compiled.
+
+#define JIT_DEFAULT_THRESHOLD 1000
+
+typedef SchemeObject* (*JitFn)(Environment* env);
+
+// Machine code for a body. The record outlives the code, for the
+// statistics.
+struct JitCode {
+    JitFn entry;
+    size_t size;                   // Bytes of machine code
+    size_t mapped;                 // Bytes of the mapping holding it
+    int compiled_nodes;            // Nodes translated
+    int called_nodes;              // Nodes called through their function
+    char* name;
+    SchemeObject* code;            // The code object, until it is freed
+    uint64_t compiled_at;          // Runs of the body when it was compiled
+    uint64_t runs;                 // Runs when the code object was freed
+    JitCode* next;
+};
+
+// Entries of a body at which it is compiled; 0 when the JIT is off
+extern uint64_t jit_threshold;
+
+// Compiles the body of a code object, setting its jit field; false if it
+// cannot be compiled
+bool jit_compile(SchemeObject* code);
+
+// Unmaps machine code whose code object is being freed, recording the
+// body's final run count
+void jit_free(JitCode* jit, uint64_t runs);
+
+// --no-jit, and --jit-threshold
+void jit_set_enabled(bool enabled);
+void jit_set_threshold(uint64_t threshold);
+
+// Prints, for each body compiled, its name, how often it ran as machine
+// code, and how much of it was compiled (--jit-stats)
+void print_jit_stats(FILE* out);
+void cleanup_jit(void);
+
+#endif // JIT_H
@@ -0,0 +1,27 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include "scheme_objects.h"
+
+// Lexical addressing. Before a top-level form is evaluated, the resolver
+// rewrites it so that each reference to a variable bound by an enclosing
+// lambda, let, let* or letrec (or by an internal define) becomes a local
+// reference: a frame depth and a slot index. Every other reference becomes
+// a global reference, which caches the global binding cell it finds (an
+// inline cache per reference site).
+//
+// Each frame-building form the resolver lays out gets a resolved head (see
+// symbols.h) and the vector of its frame's slot names:
+//   (lambda layout params body...)
+//   (let layout ((local init) ...) body...)      likewise let* and letrec
+// Parameters occupy the first slots in order, followed by internal defines.
+// define and set! of a local variable name the local reference instead of
+// the symbol; of a global, the symbol. Quoted data is never touched.
+// guard is expanded here, into procedures both engines already run.
+//
+// The input is not modified. A form the resolver cannot make sense of is
+// left as it is; the evaluator still runs it, looking its variables up by
+// name.
+SchemeObject* resolve_expression(SchemeObject* expr);
+
+#endif // RESOLVER_H
@@ -21,13 +21,24 @@ typedef struct Parser Parser;
 
 // Include all component headers
 #include "scheme_objects.h"
+#include "bignum.h"
 #include "environment.h"
 #include "lexer.h"
 #include "parser.h"
 #include "interpreter.h"
+#include "resolver.h"
+#include "analyzer.h"
+#include "jit.h"
+#include "bytecode.h"
+#include "vm.h"
+#include "control.h"
+#include "values.h"
 #include "compiler.h"
 #include "builtins.h"
 #include "runtime.h"
+#include "gc.h"
+#include "symbols.h"
+#include "slab.h"
 
 // Main application modes
 typedef enum {
@@ -43,6 +54,9 @@ typedef struct {
     const char* output_file;
     bool verbose;
     bool optimize;
+    bool gc_stats;
+    bool jit_stats;
+    bool feedback_stats;
     Environment* global_env;
 } AppContext;
 
@@ -2,6 +2,7 @@
 #define RUNTIME_H
 
 #include "scheme_objects.h"
+#include "gc.h"
 
 // Runtime initialization and cleanup
 void init_runtime(void);
@@ -18,16 +19,6 @@ size_t get_allocated_memory(void);
 size_t get_object_count(void);
 void print_memory_stats(FILE* out);
 
-// Garbage collection
-void gc_init(void);
-void gc_cleanup(void);
-void gc_add_root(SchemeObject** root);
-void gc_remove_root(SchemeObject** root);
-void gc_run(void);
-void gc_enable(void);
-void gc_disable(void);
-bool gc_is_enabled(void);
-
 // Error handling
 void runtime_error(const char* format, ...);
 void runtime_warning(const char* format, ...);
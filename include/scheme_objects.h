@@ -16,26 +16,81 @@ typedef enum {
     SCHEME_PROCEDURE,
     SCHEME_PRIMITIVE,
     SCHEME_VECTOR,
-    SCHEME_PORT
+    SCHEME_PORT,
+    SCHEME_LOCAL,       // Resolved local variable reference; never a user value
+    SCHEME_GLOBAL,      // Resolved global variable reference, with its cache
+    SCHEME_CODE,        // Analysed code; never a user value
+    SCHEME_BYTECODE,    // Compiled code for the VM; never a user value
+    SCHEME_CONTINUATION, // A sealed segment of the VM's control stack
+    SCHEME_ERROR,       // An error object
+    SCHEME_BIGNUM,      // An exact integer beyond the fixnum range (see bignum.h)
+    SCHEME_VALUES       // Other than one value returned at once (see values.h)
 } SchemeType;
 
 // Forward declaration for circular reference
 typedef struct SchemeObject SchemeObject;
 typedef struct Environment Environment;
+typedef struct Binding Binding;
+typedef struct Node Node;
+typedef struct CodeArena CodeArena;
+typedef struct JitCode JitCode;
+typedef struct Bytecode Bytecode;
+typedef struct StackSegment StackSegment;
 
-// Primitive function type
-typedef SchemeObject* (*PrimitiveFn)(SchemeObject* args, Environment* env);
+// Primitive function type. Arguments arrive as an array that is valid only
+// for the duration of the call.
+typedef SchemeObject* (*PrimitiveFn)(int argc, SchemeObject** argv, Environment* env);
+
+// A continuation. The VM's are sealed segments of its control stack (see
+// vm.h); the tree-walker's escape-only ones have no segment and are usable
+// while active, that is until the call/cc that made them returns.
+typedef struct {
+    StackSegment* segment;
+    SchemeObject* winders;       // dynamic-wind entries in force at capture
+    SchemeObject* handlers;      // Exception handlers in force at capture
+    bool active;
+} SchemeContinuation;
+
+// An error object, made by error or by an evaluation that failed
+typedef struct {
+    SchemeObject* message;       // A string
+    SchemeObject* irritants;     // A list
+} SchemeErrorObject;
+
+// Bignum representation: the magnitude in base 2^32, least significant
+// digit first, and the sign
+typedef struct {
+    uint32_t* digits;
+    uint32_t length;             // Digits in use; the last is never zero
+    bool negative;
+} SchemeBignum;
 
 // Procedure representation
 typedef struct {
     SchemeObject* parameters;  // List of parameter symbols (for interpreted)
     SchemeObject* body;        // List of expressions (for interpreted)
     Environment* closure;      // Captured environment (for interpreted)
+    SchemeObject* layout;      // Vector of frame slot names, if the body is resolved
+    SchemeObject* code;        // Analysed or compiled body, if any
     SchemeObject* (*func)(SchemeObject**, int);  // Function pointer (for compiled)
     int arity;                 // Number of parameters
     char* name;                // Function name (for debugging)
 } SchemeProcedure;
 
+// Analysed code (see analyzer.h). The nodes refer to Scheme values only
+// through the source expression, which the code object keeps alive.
+typedef struct {
+    Node* root;
+    SchemeObject* source;
+    SchemeObject** children;   // Code objects of nested lambda bodies
+    uint32_t child_count;
+    uint32_t child_capacity;
+    CodeArena* arena;          // Storage for the nodes
+    SchemeObject* name;        // Lambda bodies: the variable bound to them, if known
+    uint64_t runs;             // Times the code has been entered
+    JitCode* jit;              // Machine code for a hot body (see jit.h)
+} SchemeCode;
+
 // Vector representation
 typedef struct {
     size_t length;
@@ -50,7 +105,8 @@ typedef struct {
     char* filename;
 } SchemePort;
 
-// Pair (cons cell) representation
+// Pair (cons cell) representation. Pairs are not SchemeObjects: they live
+// in their own 16-byte cells and are referenced through tagged pointers.
 typedef struct {
     SchemeObject* car;
     SchemeObject* cdr;
@@ -63,13 +119,30 @@ struct SchemeObject {
         bool boolean_value;
         double number_value;
         char char_value;
-        char* symbol_name;
+        struct {
+            char* symbol_name;
+            SchemeObject* symbol_next;   // Symbol table chain
+            uint32_t symbol_hash;
+        };
+        struct {
+            int local_depth;             // Frames to walk up
+            int local_slot;
+        };
+        struct {
+            SchemeObject* global_symbol;
+            Binding* global_binding;     // Cached binding cell, or NULL
+            uint64_t global_version;     // binding_version when cached
+        };
         char* string_value;
-        SchemePair pair;
         SchemeProcedure procedure;
         PrimitiveFn primitive;
         SchemeVector vector;
         SchemePort port;
+        SchemeCode code;
+        Bytecode* bytecode;              // See bytecode.h
+        SchemeContinuation continuation;
+        SchemeErrorObject error;
+        SchemeBignum bignum;
     } value;
     
     // Reference counting for garbage collection
@@ -77,20 +150,161 @@ struct SchemeObject {
     
     // Mark for mark-and-sweep GC
     bool marked;
+    
+    // Generational GC state
+    uint8_t generation;
+    bool remembered;
 };
 
+// Tagged values. Heap cells are at least 8-byte aligned, so the low bits of
+// a SchemeObject* are free to encode values that never touch the heap:
+//   ....xx1  fixnum: an exact integer, shifted left by one
+//   ....010  pair: pointer to a SchemePair cell
+//   ....110  other immediate: SchemeType in bits 3-5, payload from bit 8
+//   ....000  pointer to a SchemeObject cell
+// The empty list, booleans and characters are always immediates. Fixnums
+// come only from exact integers: literals without a point or exponent, and
+// exact arithmetic on them. A flonum stays an inexact SCHEME_NUMBER cell
+// even when its value is a whole number, as 2.0 is.
+#define SCHEME_FIXNUM_TAG 0x1
+#define SCHEME_PAIR_TAG 0x2
+#define SCHEME_IMMEDIATE_TAG 0x6
+#define SCHEME_TAG_MASK 0x7
+
+#define SCHEME_MAKE_IMMEDIATE(type, payload) \
+    ((SchemeObject*)(((uintptr_t)(payload) << 8) | ((uintptr_t)(type) << 3) | SCHEME_IMMEDIATE_TAG))
+
+#if INTPTR_MAX > (INT64_C(1) << 53)
+#define SCHEME_FIXNUM_MAX ((intptr_t)1 << 53)
+#else
+#define SCHEME_FIXNUM_MAX (INTPTR_MAX >> 1)
+#endif
+#define SCHEME_FIXNUM_MIN (-SCHEME_FIXNUM_MAX)
+
+// Built-in constants
+#define SCHEME_NIL_OBJECT   SCHEME_MAKE_IMMEDIATE(SCHEME_NIL, 0)
+#define SCHEME_FALSE_OBJECT SCHEME_MAKE_IMMEDIATE(SCHEME_BOOLEAN, 0)
+#define SCHEME_TRUE_OBJECT  SCHEME_MAKE_IMMEDIATE(SCHEME_BOOLEAN, 1)
+
+static inline bool is_fixnum(const SchemeObject* obj) {
+    return ((uintptr_t)obj & SCHEME_FIXNUM_TAG) != 0;
+}
+
+// True for fixnums and the other immediates; such values have no cell
+static inline bool is_immediate(const SchemeObject* obj) {
+    return ((uintptr_t)obj & SCHEME_FIXNUM_TAG) != 0 ||
+           ((uintptr_t)obj & SCHEME_TAG_MASK) == SCHEME_IMMEDIATE_TAG;
+}
+
+// True for non-null pointers to a SchemeObject cell
+static inline bool is_heap_object(const SchemeObject* obj) {
+    return obj && ((uintptr_t)obj & SCHEME_TAG_MASK) == 0;
+}
+
+static inline bool is_pair(const SchemeObject* obj) {
+    return ((uintptr_t)obj & SCHEME_TAG_MASK) == SCHEME_PAIR_TAG;
+}
+
+// Convert between a pair value and its cell
+static inline SchemePair* pair_cell(const SchemeObject* obj) {
+    return (SchemePair*)((uintptr_t)obj - SCHEME_PAIR_TAG);
+}
+
+static inline SchemeObject* pair_value(const SchemePair* pair) {
+    return (SchemeObject*)((uintptr_t)pair | SCHEME_PAIR_TAG);
+}
+
+static inline SchemeObject* make_fixnum(intptr_t value) {
+    return (SchemeObject*)(((uintptr_t)value << 1) | SCHEME_FIXNUM_TAG);
+}
+
+static inline intptr_t fixnum_value(const SchemeObject* obj) {
+    return (intptr_t)obj >> 1;
+}
+
+// Type of a non-null value, immediate or not
+static inline SchemeType object_type(const SchemeObject* obj) {
+    if (is_fixnum(obj)) {
+        return SCHEME_NUMBER;
+    }
+    switch ((uintptr_t)obj & SCHEME_TAG_MASK) {
+        case SCHEME_PAIR_TAG:
+            return SCHEME_PAIR;
+        case SCHEME_IMMEDIATE_TAG:
+            return (SchemeType)(((uintptr_t)obj >> 3) & 0x7);
+        default:
+            return obj->type;
+    }
+}
+
+static inline bool is_local_ref(const SchemeObject* obj) {
+    return is_heap_object(obj) && obj->type == SCHEME_LOCAL;
+}
+
+static inline bool is_global_ref(const SchemeObject* obj) {
+    return is_heap_object(obj) && obj->type == SCHEME_GLOBAL;
+}
+
+static inline bool is_bytecode(const SchemeObject* obj) {
+    return is_heap_object(obj) && obj->type == SCHEME_BYTECODE;
+}
+
+static inline bool is_continuation(const SchemeObject* obj) {
+    return is_heap_object(obj) && obj->type == SCHEME_CONTINUATION;
+}
+
+static inline bool is_error_object(const SchemeObject* obj) {
+    return is_heap_object(obj) && obj->type == SCHEME_ERROR;
+}
+
+// An inexact number, a double in a cell of its own
+static inline bool is_flonum(const SchemeObject* obj) {
+    return is_heap_object(obj) && obj->type == SCHEME_NUMBER;
+}
+
+static inline bool is_bignum(const SchemeObject* obj) {
+    return is_heap_object(obj) && obj->type == SCHEME_BIGNUM;
+}
+
+// The nearest double to a bignum (see bignum.c)
+double bignum_to_double(const SchemeObject* obj);
+
+// Value accessors; the argument must already be known to have that type
+static inline double number_value(const SchemeObject* obj) {
+    if (is_fixnum(obj)) {
+        return (double)fixnum_value(obj);
+    }
+    return obj->type == SCHEME_BIGNUM ? bignum_to_double(obj) : obj->value.number_value;
+}
+
+static inline char char_value(const SchemeObject* obj) {
+    return (char)((uintptr_t)obj >> 8);
+}
+
+static inline bool boolean_value(const SchemeObject* obj) {
+    return obj != SCHEME_FALSE_OBJECT;
+}
+
 // Object creation functions
 SchemeObject* make_nil(void);
 SchemeObject* make_boolean(bool value);
 SchemeObject* make_number(double value);
 SchemeObject* make_char(char value);
 SchemeObject* make_symbol(const char* name);
+SchemeObject* make_uninterned_symbol(const char* name);
 SchemeObject* make_string(const char* str);
 SchemeObject* make_pair(SchemeObject* car, SchemeObject* cdr);
 SchemeObject* make_procedure(SchemeObject* params, SchemeObject* body, Environment* env);
 SchemeObject* make_primitive(PrimitiveFn fn);
 SchemeObject* make_vector(size_t length);
 SchemeObject* make_port(FILE* file, bool is_input, bool is_output, const char* filename);
+SchemeObject* make_local_ref(int depth, int slot);
+SchemeObject* make_global_ref(SchemeObject* symbol);
+SchemeObject* make_code(SchemeObject* source);
+SchemeObject* make_bytecode(SchemeObject* source);
+SchemeObject* make_continuation(StackSegment* segment);
+SchemeObject* make_error_object(SchemeObject* message, SchemeObject* irritants);
+SchemeObject* make_bignum(uint32_t* digits, uint32_t length, bool negative);
 
 // Object manipulation functions
 SchemeObject* cons(SchemeObject* car, SchemeObject* cdr);
@@ -106,7 +320,6 @@ bool is_number(SchemeObject* obj);
 bool is_char(SchemeObject* obj);
 bool is_symbol(SchemeObject* obj);
 bool is_string(SchemeObject* obj);
-bool is_pair(SchemeObject* obj);
 bool is_procedure(SchemeObject* obj);
 bool is_primitive(SchemeObject* obj);
 bool is_vector(SchemeObject* obj);
@@ -129,18 +342,17 @@ bool scheme_eq(SchemeObject* a, SchemeObject* b);
 void retain_object(SchemeObject* obj);
 void release_object(SchemeObject* obj);
 void mark_object(SchemeObject* obj);
+void mark_pair(SchemePair* pair);
+void mark_object_children(SchemeObject* obj);
+void mark_pair_children(SchemePair* pair);
 void sweep_objects(void);
+size_t finalize_object(SchemeObject* obj);
 void gc_collect(void);
 
 // String representation
 char* object_to_string(SchemeObject* obj);
 void print_object(SchemeObject* obj, FILE* out);
 
-// Built-in constants
-extern SchemeObject* SCHEME_NIL_OBJECT;
-extern SchemeObject* SCHEME_TRUE_OBJECT;
-extern SchemeObject* SCHEME_FALSE_OBJECT;
-
 // Initialization
 void init_scheme_objects(void);
 void cleanup_scheme_objects(void);
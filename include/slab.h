@@ -0,0 +1,25 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Requests up to this size are served from segregated size classes; larger
+// ones go to the system allocator
+#define SLAB_MAX_SIZE 256
+
+// Allocator lifecycle
+void slab_init(void);
+void slab_cleanup(void);
+
+// Allocation. slab_alloc requires 0 < size <= SLAB_MAX_SIZE.
+void* slab_alloc(size_t size);
+void slab_free(void* ptr);
+bool slab_owns(const void* ptr);
+size_t slab_size_of(const void* ptr);
+
+// Statistics
+void slab_print_stats(FILE* out);
+
+#endif // SLAB_H
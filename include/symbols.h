@@ -0,0 +1,55 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "scheme_objects.h"
+
+// Symbol table lifecycle. Symbols are interned: each distinct name exists as
+// exactly one symbol object, so symbols compare with ==. The table refers to
+// its symbols weakly; unreachable ones are dropped when they are collected.
+void init_symbol_table(void);
+void cleanup_symbol_table(void);
+
+// Table operations used by make_symbol, which is the interning entry point
+SchemeObject* find_symbol(const char* name, uint32_t hash);
+void add_symbol(SchemeObject* symbol);
+
+// Remove a symbol the collector is about to reclaim
+void remove_symbol(SchemeObject* symbol);
+
+// Hash used for symbol names (cached in each symbol)
+uint32_t hash_string(const char* str);
+
+// Statistics
+size_t symbol_table_count(void);
+
+// Symbols the evaluator dispatches on. Interned at startup and kept alive as
+// collector roots.
+extern SchemeObject* SYMBOL_QUOTE;
+extern SchemeObject* SYMBOL_IF;
+extern SchemeObject* SYMBOL_DEFINE;
+extern SchemeObject* SYMBOL_SET;
+extern SchemeObject* SYMBOL_LAMBDA;
+extern SchemeObject* SYMBOL_BEGIN;
+extern SchemeObject* SYMBOL_AND;
+extern SchemeObject* SYMBOL_OR;
+extern SchemeObject* SYMBOL_COND;
+extern SchemeObject* SYMBOL_ELSE;
+extern SchemeObject* SYMBOL_LET;
+extern SchemeObject* SYMBOL_LET_STAR;
+extern SchemeObject* SYMBOL_LETREC;
+extern SchemeObject* SYMBOL_GUARD;
+extern SchemeObject* SYMBOL_LET_VALUES;
+extern SchemeObject* SYMBOL_RECEIVE;
+
+// Heads the resolver gives the frame-building forms it has laid out. They
+// are uninterned and print like the forms they replace, so source code can
+// never contain them.
+extern SchemeObject* SYMBOL_RESOLVED_LAMBDA;
+extern SchemeObject* SYMBOL_RESOLVED_LET;
+extern SchemeObject* SYMBOL_RESOLVED_LET_STAR;
+extern SchemeObject* SYMBOL_RESOLVED_LETREC;
+extern SchemeObject* SYMBOL_RESOLVED_LET_VALUES;
+
+#endif // SYMBOLS_H
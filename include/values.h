@@ -0,0 +1,55 @@
+#ifndef VALUES_H
+#define VALUES_H
+
+#include "scheme_objects.h"
+#include "environment.h"
+
+// Multiple values. (values a b ...) copies its arguments into the values
+// register and returns MULTIPLE_VALUES, a single static cell that stands
+// for "the values in the register"; (values x) is just x. Returning several
+// values therefore allocates nothing. The register is one growable array,
+// since the interpreter runs on one thread; it only ever grows, and only
+// when more values are returned at once than ever before.
+//
+// Whoever receives MULTIPLE_VALUES reads the register straight away:
+// receive and let-values, which the resolver lays out as frames whose slots
+// the values are stored into, and call-with-values. Anything that returns
+// values again before then, such as a dynamic-wind after thunk, replaces
+// them.
+//
+// call-with-values is Scheme, (%apply-values consumer (producer)). Both
+// evaluators call the consumer of %apply-values themselves when they can,
+// the VM without entering itself again, so a consumer in tail position is
+// a proper tail call; otherwise the primitive makes the call.
+extern SchemeObject multiple_values;
+#define MULTIPLE_VALUES (&multiple_values)
+
+static inline bool is_multiple_values(const SchemeObject* obj) {
+    return obj == MULTIPLE_VALUES;
+}
+
+// What returning count values evaluates to
+SchemeObject* return_values(int count, SchemeObject** values);
+
+// The values *result stands for, and in *count how many: the register's,
+// or the one at result itself. Valid until values are next returned.
+SchemeObject** result_values(SchemeObject** result, int* count);
+
+// Writes the values result stands for to out: the first required of them,
+// then, if rest is set, a list of the others. Reports an error and returns
+// false if there are too few, or too many without rest.
+bool spread_values(SchemeObject* result, int required, bool rest, SchemeObject** out);
+
+// Stores the values result stands for into the slots of frame that targets
+// names: a list of local references, improper if its tail takes the rest
+void bind_values(Environment* frame, SchemeObject* targets, SchemeObject* result);
+
+// The register's values are roots until they are replaced
+void mark_values_register(void);
+
+// Installs values, call-with-values and %apply-values
+void init_values(Environment* env);
+
+SchemeObject* builtin_apply_values(int argc, SchemeObject** argv, Environment* env);
+
+#endif // VALUES_H
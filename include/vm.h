@@ -0,0 +1,43 @@
+#ifndef VM_H
+#define VM_H
+
+#include "scheme_objects.h"
+#include "environment.h"
+
+// Bytecode VM. Calls between compiled procedures run inside one dispatch
+// loop on a control stack of their own, with no C recursion; primitives
+// are called with their arguments in place on the operand stack. The
+// control stack is segmented: a full segment is sealed into a continuation
+// object and later copied back from a frame at a time, so the depth of
+// recursion is bounded only by memory.
+
+// Builds the threaded code of a freshly compiled bytecode object. Where the
+// compiler supports labels as values (GCC, Clang) each opcode word becomes
+// the address of its handler and the VM jumps from handler to handler;
+// elsewhere the VM dispatches with a switch on the opcode.
+void thread_bytecode(Bytecode* bc);
+
+// Run a compiled top-level form
+SchemeObject* vm_execute(SchemeObject* bytecode, Environment* env);
+
+// Apply a procedure whose code is bytecode
+SchemeObject* vm_apply(SchemeObject* proc, int argc, SchemeObject** argv);
+
+// The innermost entry to the VM from C, or 0 outside it, and dropping
+// every entry inside a given one, for a non-local exit (see control.h)
+size_t current_vm_entry(void);
+void unwind_vm_entries(size_t entry);
+
+// Collector support: marks the running segments, and the children of a
+// sealed one. Freeing a sealed segment may keep it for reuse.
+void mark_vm_frames(void);
+void mark_stack_segment(StackSegment* segment);
+size_t free_stack_segment(StackSegment* segment);
+void cleanup_vm(void);
+
+// In builds configured with RSCHEME_VM_PROFILE the VM counts how often each
+// opcode follows each other one, for choosing superinstructions, and this
+// prints the most frequent pairs. Otherwise it does nothing.
+void print_vm_profile(FILE* out);
+
+#endif // VM_H
@@ -0,0 +1,1178 @@
+#include "rscheme.h"
+#include <math.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ANALYZER_NOINLINE __attribute__((noinline))
+#elif defined(_MSC_VER)
+#define ANALYZER_NOINLINE __declspec(noinline)
+#else
+#define ANALYZER_NOINLINE
+#endif
+
+// Nodes are bump-allocated from chunks owned by their code object and are
+// freed together with it
+struct CodeArena {
+    CodeArena* next;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+#define CODE_ARENA_FIRST_CHUNK 256
+#define CODE_ARENA_MAX_CHUNK 4096
+
+static void* code_alloc(SchemeObject* code, size_t size) {
+    SchemeCode* c = &code->value.code;
+    size = (size + 7) & ~(size_t)7;
+
+    CodeArena* arena = c->arena;
+    if (!arena || arena->used + size > arena->size) {
+        size_t chunk = arena ? arena->size * 2 : CODE_ARENA_FIRST_CHUNK;
+        if (chunk > CODE_ARENA_MAX_CHUNK) {
+            chunk = CODE_ARENA_MAX_CHUNK;
+        }
+        if (chunk < size) {
+            chunk = size;
+        }
+        CodeArena* fresh = (CodeArena*)scheme_malloc(sizeof(CodeArena) + chunk);
+        fresh->next = arena;
+        fresh->used = 0;
+        fresh->size = chunk;
+        c->arena = arena = fresh;
+    }
+
+    void* ptr = arena->data + arena->used;
+    arena->used += size;
+    return ptr;
+}
+
+static Node* new_node(SchemeObject* code, NodeFn eval) {
+    Node* node = (Node*)code_alloc(code, sizeof(Node));
+    memset(node, 0, sizeof(Node));
+    node->eval = eval;
+    return node;
+}
+
+size_t free_code(SchemeCode* code) {
+    size_t freed = 0;
+    CodeArena* arena = code->arena;
+    while (arena) {
+        CodeArena* next = arena->next;
+        freed += sizeof(CodeArena) + arena->size;
+        scheme_free(arena);
+        arena = next;
+    }
+    code->arena = NULL;
+    code->root = NULL;
+
+    if (code->jit) {
+        jit_free(code->jit, code->runs);
+        code->jit = NULL;
+    }
+
+    if (code->children) {
+        freed += code->child_capacity * sizeof(SchemeObject*);
+        scheme_free(code->children);
+        code->children = NULL;
+    }
+    code->child_count = 0;
+    code->child_capacity = 0;
+    return freed;
+}
+
+static void add_child(SchemeObject* code, SchemeObject* child) {
+    SchemeCode* c = &code->value.code;
+    if (c->child_count == c->child_capacity) {
+        c->child_capacity = c->child_capacity ? c->child_capacity * 2 : 4;
+        c->children = (SchemeObject**)scheme_realloc(c->children, c->child_capacity * sizeof(SchemeObject*));
+    }
+    gc_write_barrier(code, child);
+    c->children[c->child_count++] = child;
+}
+
+static inline SchemeObject* execute(Node* node, Environment* env) {
+    return node->eval(node, env);
+}
+
+// A call in tail position does not apply its procedure. It leaves the
+// procedure and its arguments in a frame on the argument stack and returns
+// TAIL_CALL up through the nodes between it and the body it ends, none of
+// which push anything there, and run_code makes the call.
+static SchemeObject tail_call_marker;
+#define TAIL_CALL (&tail_call_marker)
+
+static SchemeObject** tail_call_frame;     // The procedure, then the arguments
+static int tail_call_argc;
+
+SchemeObject* tail_call(SchemeObject** frame, int argc) {
+    tail_call_frame = frame;
+    tail_call_argc = argc;
+    return TAIL_CALL;
+}
+
+// Runs a code object's nodes, or its machine code once it has been entered
+// often enough to be compiled
+static inline SchemeObject* enter_code(SchemeObject* code, Environment* env) {
+    SchemeCode* c = &code->value.code;
+    c->runs++;
+    if (c->jit) {
+        return c->jit->entry(env);
+    }
+    if (c->runs == jit_threshold && jit_compile(code)) {
+        return c->jit->entry(env);
+    }
+    return execute(c->root, env);
+}
+
+// Runs the tail call code has just left, then each tail call that leaves
+// in turn, in a loop, so chains of tail calls use constant C stack. The
+// code running is kept alive in running[0], first the caller's, then each
+// procedure tail-called: the C stack may hold pointers into its nodes and
+// its machine code but none to the code cell, whose collection would free
+// both. Out of line, so that run_code and run_procedure, whose frames
+// every non-tail call nests, stay small.
+static ANALYZER_NOINLINE SchemeObject* run_tail_calls(SchemeObject** running, Environment* env) {
+    SchemeObject* result = TAIL_CALL;
+
+    while (result == TAIL_CALL) {
+        SchemeObject** frame = tail_call_frame;
+        int argc = tail_call_argc;
+        SchemeObject* procedure = frame[0];
+        SchemeObject* body = is_procedure(procedure) ? procedure->value.procedure.code : NULL;
+
+        if (argc == 2 && is_builtin(procedure, builtin_apply_values)) {
+            // call-with-values calling its consumer (see values.h): the
+            // frame becomes a tail call of the consumer on the values
+            SchemeObject* consumer = frame[1];
+            SchemeObject* produced = frame[2];
+            pop_arguments(argc + 1);
+            int count;
+            SchemeObject** values = result_values(&produced, &count);
+            frame = push_arguments(count + 1);
+            frame[0] = consumer;
+            for (int i = 0; i < count; i++) {
+                frame[i + 1] = values[i];
+            }
+            tail_call(frame, count);
+        } else if (body && body->type == SCHEME_CODE) {
+            Environment* callee_env = extend_environment_argv(
+                procedure->value.procedure.closure,
+                procedure->value.procedure.parameters,
+                procedure->value.procedure.layout,
+                argc, frame + 1
+            );
+            pop_arguments(argc + 1);
+            running[0] = procedure;
+            result = enter_code(body, callee_env);
+            release_environment(callee_env);
+        } else {
+            // Primitives, and procedures run elsewhere
+            result = apply_procedure_argv(procedure, argc, frame + 1, env);
+            pop_arguments(argc + 1);
+        }
+    }
+
+    return result;
+}
+
+SchemeObject* run_code(SchemeObject* code, Environment* env) {
+    check_stack_depth();
+    SchemeObject** running = push_arguments(1);
+    running[0] = code;
+    SchemeObject* result = enter_code(code, env);
+    if (result == TAIL_CALL) {
+        result = run_tail_calls(running, env);
+    }
+    pop_arguments(1);
+    return result;
+}
+
+SchemeObject* run_procedure(SchemeObject* procedure, int argc, SchemeObject** argv) {
+    check_stack_depth();
+    Environment* env = extend_environment_argv(
+        procedure->value.procedure.closure,
+        procedure->value.procedure.parameters,
+        procedure->value.procedure.layout,
+        argc, argv
+    );
+    SchemeObject** running = push_arguments(1);
+    running[0] = procedure;
+    SchemeObject* result = enter_code(procedure->value.procedure.code, env);
+    if (result == TAIL_CALL) {
+        result = run_tail_calls(running, env);
+    }
+    pop_arguments(1);
+    release_environment(env);
+    return result;
+}
+
+// Node evaluators
+
+static SchemeObject* eval_constant_node(Node* node, Environment* env) {
+    (void)env;
+    return node->constant;
+}
+
+static SchemeObject* eval_fallback_node(Node* node, Environment* env) {
+    return eval_expression(node->expr, env);
+}
+
+SchemeObject* unbound_local(Environment* frame, int slot) {
+    SchemeObject* name = frame->layout->value.vector.elements[slot];
+    return unassigned_variable(frame->parent, name);
+}
+
+static SchemeObject* eval_local0_node(Node* node, Environment* env) {
+    SchemeObject* value = env->slots[node->local.slot];
+    return value ? value : unbound_local(env, node->local.slot);
+}
+
+static SchemeObject* eval_local_node(Node* node, Environment* env) {
+    Environment* frame = frame_at_depth(env, node->local.depth);
+    SchemeObject* value = frame->slots[node->local.slot];
+    return value ? value : unbound_local(frame, node->local.slot);
+}
+
+static SchemeObject* eval_global_node(Node* node, Environment* env) {
+    return eval_global_ref(node->global.ref, env);
+}
+
+static SchemeObject* eval_define_local_node(Node* node, Environment* env) {
+    SchemeObject* value = execute(node->local.value, env);
+    set_frame_slot(frame_at_depth(env, node->local.depth), node->local.slot, value);
+    return SCHEME_NIL_OBJECT;
+}
+
+static SchemeObject* eval_define_global_node(Node* node, Environment* env) {
+    SchemeObject* value = execute(node->global.value, env);
+    define_symbol(env, node->global.symbol, value);
+    return SCHEME_NIL_OBJECT;
+}
+
+static SchemeObject* eval_set_local_node(Node* node, Environment* env) {
+    SchemeObject* value = execute(node->local.value, env);
+    set_frame_slot(frame_at_depth(env, node->local.depth), node->local.slot, value);
+    return SCHEME_NIL_OBJECT;
+}
+
+static SchemeObject* eval_set_global_node(Node* node, Environment* env) {
+    SchemeObject* value = execute(node->global.value, env);
+    if (!set_symbol_if_exists(env, node->global.symbol, value)) {
+        set_eval_error(EVAL_ERROR_RUNTIME, "set! variable not defined");
+        return NULL;
+    }
+    return SCHEME_NIL_OBJECT;
+}
+
+static SchemeObject* eval_if_node(Node* node, Environment* env) {
+    SchemeObject* test = execute(node->branch.test, env);
+    // In Scheme, only #f is false
+    Node* next = test != SCHEME_FALSE_OBJECT ? node->branch.consequent : node->branch.alternative;
+    return next ? execute(next, env) : SCHEME_NIL_OBJECT;
+}
+
+static SchemeObject* eval_sequence_node(Node* node, Environment* env) {
+    int last = node->sequence.count - 1;
+    for (int i = 0; i < last; i++) {
+        execute(node->sequence.items[i], env);
+    }
+    return execute(node->sequence.items[last], env);
+}
+
+static SchemeObject* eval_and_node(Node* node, Environment* env) {
+    SchemeObject* result = SCHEME_TRUE_OBJECT;
+    for (int i = 0; i < node->sequence.count; i++) {
+        result = execute(node->sequence.items[i], env);
+        if (result == SCHEME_FALSE_OBJECT) {
+            return SCHEME_FALSE_OBJECT;
+        }
+    }
+    return result;
+}
+
+static SchemeObject* eval_or_node(Node* node, Environment* env) {
+    for (int i = 0; i < node->sequence.count; i++) {
+        SchemeObject* result = execute(node->sequence.items[i], env);
+        if (result != SCHEME_FALSE_OBJECT) {
+            return result;
+        }
+    }
+    return SCHEME_FALSE_OBJECT;
+}
+
+static SchemeObject* eval_cond_node(Node* node, Environment* env) {
+    for (int i = 0; i < node->cond.count; i++) {
+        Node* test = node->cond.tests[i];
+        Node* body = node->cond.bodies[i];
+        if (!test) {
+            return body ? execute(body, env) : SCHEME_NIL_OBJECT;
+        }
+
+        SchemeObject* result = execute(test, env);
+        if (result != SCHEME_FALSE_OBJECT) {
+            return body ? execute(body, env) : result;
+        }
+    }
+    return SCHEME_NIL_OBJECT;
+}
+
+static SchemeObject* eval_lambda_node(Node* node, Environment* env) {
+    SchemeObject* procedure = make_procedure(node->lambda.params, node->lambda.body, env);
+    procedure->value.procedure.layout = node->lambda.layout;
+    procedure->value.procedure.code = node->lambda.code;
+    return procedure;
+}
+
+// let, let* and letrec. Only let evaluates its initialisers outside the new
+// frame; letrec binds every variable, to (), before running them.
+static SchemeObject* eval_let_node(Node* node, Environment* env) {
+    Environment* frame = make_frame(env, node->let.layout);
+
+    if (node->let.kind == SYMBOL_RESOLVED_LETREC) {
+        for (int i = 0; i < node->let.count; i++) {
+            frame->slots[node->let.slots[i]] = SCHEME_NIL_OBJECT;
+        }
+    }
+
+    Environment* init_env = node->let.kind == SYMBOL_RESOLVED_LET ? env : frame;
+    for (int i = 0; i < node->let.count; i++) {
+        SchemeObject* value = execute(node->let.inits[i], init_env);
+        set_frame_slot(frame, node->let.slots[i], value);
+    }
+
+    return execute(node->let.body, frame);
+}
+
+static SchemeObject* eval_let_values_node(Node* node, Environment* env) {
+    Environment* frame = make_frame(env, node->let_values.layout);
+    for (int i = 0; i < node->let_values.count; i++) {
+        bind_values(frame, node->let_values.targets[i], execute(node->let_values.inits[i], env));
+    }
+    return execute(node->let_values.body, frame);
+}
+
+static SchemeObject* eval_call_node(Node* node, Environment* env) {
+    SchemeObject* procedure = execute(node->call.operator, env);
+
+    // Evaluate arguments into a frame on the argument stack
+    int argc = node->call.argc;
+    SchemeObject** argv = push_arguments(argc);
+    for (int i = 0; i < argc; i++) {
+        argv[i] = execute(node->call.operands[i], env);
+    }
+
+    SchemeObject* result = apply_procedure_argv(procedure, argc, argv, env);
+    pop_arguments(argc);
+    return result;
+}
+
+static SchemeObject* eval_tail_call_node(Node* node, Environment* env) {
+    SchemeObject* procedure = execute(node->call.operator, env);
+
+    int argc = node->call.argc;
+    SchemeObject** frame = push_arguments(argc + 1);
+    frame[0] = procedure;
+    for (int i = 0; i < argc; i++) {
+        frame[i + 1] = execute(node->call.operands[i], env);
+    }
+
+    return tail_call(frame, argc);
+}
+
+// Calls of the numeric operators with one or two operands. While the
+// operator is bound to the builtin, the inline fast path in builtins.h
+// gives the result; otherwise the call is made as a call node would.
+
+SchemeObject* call_numeric(Node* node, SchemeObject* procedure, int argc,
+                           SchemeObject* first, SchemeObject* second, Environment* env) {
+    SchemeObject** frame = push_arguments(argc + 1);
+    frame[0] = procedure;
+    frame[1] = first;
+    if (argc == 2) {
+        frame[2] = second;
+    }
+    if (node->numeric.tail) {
+        return tail_call(frame, argc);
+    }
+    SchemeObject* result = apply_procedure_argv(procedure, argc, frame + 1, env);
+    pop_arguments(argc + 1);
+    return result;
+}
+
+// Type feedback (see analyzer.h). seen collects the kinds of evaluation a
+// node has made; each specialization and deoptimization is counted against
+// the body holding the node.
+
+enum {
+    SEEN_FIXNUM = 1,                       // Two fixnums
+    SEEN_FLONUM = 2,                       // Two numbers, not both fixnums
+    SEEN_OTHER = 4                         // Anything the builtin must see
+};
+
+struct NumericProfile {
+    char* name;
+    uint64_t specializations;
+    uint64_t deopts;
+    NumericProfile* next;
+};
+
+static NumericProfile* profiles = NULL;
+static NumericProfile** profiles_tail = &profiles;
+
+// The node's body's record, made when it first specializes; by then a
+// lambda body has usually been named
+static NumericProfile* numeric_profile(Node* node) {
+    NumericProfile** slot = node->numeric.profile;
+    if (!*slot) {
+        NumericProfile* profile = (NumericProfile*)scheme_malloc(sizeof(NumericProfile));
+        SchemeObject* name = node->numeric.owner->value.code.name;
+        profile->name = scheme_strdup(name ? name->value.symbol_name : "(anonymous)");
+        profile->specializations = 0;
+        profile->deopts = 0;
+        profile->next = NULL;
+        *profiles_tail = profile;
+        profiles_tail = &profile->next;
+        *slot = profile;
+    }
+    return *slot;
+}
+
+static inline bool is_numeric(const SchemeObject* obj) {
+    return is_fixnum(obj) || is_flonum(obj);
+}
+
+static void specialize(Node* node, bool builtin, SchemeObject* first, SchemeObject* second,
+                       NodeFn fixnum, NodeFn flonum) {
+    if (!builtin || !is_numeric(first) || !is_numeric(second)) {
+        node->numeric.seen |= SEEN_OTHER;
+        return;
+    }
+    node->numeric.seen |= is_fixnum(first) && is_fixnum(second) ? SEEN_FIXNUM : SEEN_FLONUM;
+    node->eval = node->numeric.seen == SEEN_FIXNUM ? fixnum : flonum;
+    numeric_profile(node)->specializations++;
+}
+
+static void deoptimize(Node* node, NodeFn generic) {
+    node->eval = generic;
+    numeric_profile(node)->deopts++;
+}
+
+// The flonum specializations, one for arithmetic and one for comparisons
+// (see below)
+static SchemeObject* eval_flonum_arithmetic_node(Node* node, Environment* env);
+static SchemeObject* eval_flonum_comparison_node(Node* node, Environment* env);
+
+// For each operator, the generic node and its fixnum specialization. They
+// share the step after the operands are evaluated, so a deoptimizing node
+// finishes the evaluation it started as the generic node would. Fixnum
+// results the fast path cannot give, such as an overflow into a bignum,
+// come from the builtin.
+#define NUMERIC_NODE(op, builtin, fast, flonum_node) \
+    static SchemeObject* eval_##op##_fixnum_node(Node* node, Environment* env); \
+    \
+    static SchemeObject* generic_##op(Node* node, SchemeObject* procedure, \
+                                      SchemeObject* first, SchemeObject* second, Environment* env) { \
+        bool primitive = is_builtin(procedure, builtin); \
+        if (!(node->numeric.seen & SEEN_OTHER)) { \
+            specialize(node, primitive, first, second, eval_##op##_fixnum_node, flonum_node); \
+        } \
+        SchemeObject* result; \
+        if (primitive && (result = fast(first, second))) { \
+            return result; \
+        } \
+        return call_numeric(node, procedure, 2, first, second, env); \
+    } \
+    \
+    static SchemeObject* eval_##op##_node(Node* node, Environment* env) { \
+        SchemeObject* procedure = execute(node->numeric.operator, env); \
+        SchemeObject* first = execute(node->numeric.operands[0], env); \
+        SchemeObject* second = execute(node->numeric.operands[1], env); \
+        return generic_##op(node, procedure, first, second, env); \
+    } \
+    \
+    static SchemeObject* eval_##op##_fixnum_node(Node* node, Environment* env) { \
+        SchemeObject* procedure = execute(node->numeric.operator, env); \
+        SchemeObject* first = execute(node->numeric.operands[0], env); \
+        SchemeObject* second = execute(node->numeric.operands[1], env); \
+        SchemeObject* result; \
+        if (is_builtin(procedure, builtin) && is_fixnum(first) && is_fixnum(second)) { \
+            if ((result = fast(first, second))) { \
+                return result; \
+            } \
+            return call_numeric(node, procedure, 2, first, second, env); \
+        } \
+        deoptimize(node, eval_##op##_node); \
+        return generic_##op(node, procedure, first, second, env); \
+    }
+
+NUMERIC_NODE(add, builtin_add, fast_add, eval_flonum_arithmetic_node)
+NUMERIC_NODE(subtract, builtin_subtract, fast_subtract, eval_flonum_arithmetic_node)
+NUMERIC_NODE(multiply, builtin_multiply, fast_multiply, eval_flonum_arithmetic_node)
+NUMERIC_NODE(divide, builtin_divide, fast_divide, eval_flonum_arithmetic_node)
+NUMERIC_NODE(num_eq, builtin_num_eq, fast_num_eq, eval_flonum_comparison_node)
+NUMERIC_NODE(lt, builtin_lt, fast_lt, eval_flonum_comparison_node)
+NUMERIC_NODE(gt, builtin_gt, fast_gt, eval_flonum_comparison_node)
+NUMERIC_NODE(le, builtin_le, fast_le, eval_flonum_comparison_node)
+NUMERIC_NODE(ge, builtin_ge, fast_ge, eval_flonum_comparison_node)
+
+#undef NUMERIC_NODE
+
+static SchemeObject* eval_negate_fixnum_node(Node* node, Environment* env);
+
+static SchemeObject* generic_negate(Node* node, SchemeObject* procedure, SchemeObject* first,
+                                   SchemeObject* second, Environment* env) {
+    (void)second;
+    bool primitive = is_builtin(procedure, builtin_subtract);
+    if (!(node->numeric.seen & SEEN_OTHER)) {
+        specialize(node, primitive, first, first, eval_negate_fixnum_node,
+                   eval_flonum_arithmetic_node);
+    }
+    SchemeObject* result;
+    if (primitive && (result = fast_negate(first))) {
+        return result;
+    }
+    return call_numeric(node, procedure, 1, first, NULL, env);
+}
+
+static SchemeObject* eval_negate_node(Node* node, Environment* env) {
+    SchemeObject* procedure = execute(node->numeric.operator, env);
+    SchemeObject* first = execute(node->numeric.operands[0], env);
+    return generic_negate(node, procedure, first, NULL, env);
+}
+
+static SchemeObject* eval_negate_fixnum_node(Node* node, Environment* env) {
+    SchemeObject* procedure = execute(node->numeric.operator, env);
+    SchemeObject* first = execute(node->numeric.operands[0], env);
+    if (is_builtin(procedure, builtin_subtract) && is_fixnum(first)) {
+        return fast_negate(first);
+    }
+    deoptimize(node, eval_negate_node);
+    return generic_negate(node, procedure, first, NULL, env);
+}
+
+// Each numeric node's operator, generic node and generic step, in NodeKind
+// order from NODE_ADD
+typedef SchemeObject* (*NumericStep)(Node* node, SchemeObject* procedure, SchemeObject* first,
+                                     SchemeObject* second, Environment* env);
+
+static const struct {
+    PrimitiveFn builtin;
+    NodeFn generic;
+    NumericStep step;
+} numeric_ops[] = {
+    {builtin_add, eval_add_node, generic_add},
+    {builtin_subtract, eval_subtract_node, generic_subtract},
+    {builtin_multiply, eval_multiply_node, generic_multiply},
+    {builtin_divide, eval_divide_node, generic_divide},
+    {builtin_subtract, eval_negate_node, generic_negate},
+    {builtin_num_eq, eval_num_eq_node, generic_num_eq},
+    {builtin_lt, eval_lt_node, generic_lt},
+    {builtin_gt, eval_gt_node, generic_gt},
+    {builtin_le, eval_le_node, generic_le},
+    {builtin_ge, eval_ge_node, generic_ge},
+};
+
+#define NUMERIC_OP(node) (numeric_ops[(node)->numeric.kind - NODE_ADD])
+
+// Unboxed evaluation. A flonum node computes in doubles, and an operand
+// that is itself an arithmetic node (marked in unboxed when the node is
+// analysed) is computed the same way: its value goes nowhere but into the
+// enclosing arithmetic, so it is never boxed. Only the outermost node's
+// value, which escapes to a variable, a call or a return, becomes a number
+// object. Chains of arithmetic on flonums then allocate once, for the
+// result.
+//
+// Only inexact arithmetic is done in doubles. A flonum operand makes the
+// result a flonum, and each step matches what the builtin computes from
+// boxed operands, which are exactly the doubles here: make_number never
+// rounds. Two exact operands give an exact result, which the fixnum fast
+// path or the builtin computes; it is an object like any other operand.
+
+// An inexact result, unless the builtin reports an error instead
+static bool compute_unboxed(int kind, double x, double y, double* result) {
+    switch (kind) {
+        case NODE_ADD:
+            // builtin_add sums from an exact 0, which is 0.0 by the first
+            // flonum, and 0.0 + -0.0 is 0.0; x + y alone would keep -0.0
+            *result = 0.0 + x + y;
+            return true;
+        case NODE_SUBTRACT:
+            *result = x - y;
+            return true;
+        case NODE_MULTIPLY:
+            *result = x * y;
+            return true;
+        case NODE_DIVIDE:
+            if (y == 0.0) {
+                return false;
+            }
+            *result = x / y;
+            return true;
+        case NODE_NEGATE:
+            *result = -x;
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Arithmetic on exact operands, as the generic node does it
+static SchemeObject* compute_exact(Node* node, SchemeObject* procedure, SchemeObject* first,
+                                   SchemeObject* second, Environment* env) {
+    SchemeObject* result;
+    switch (node->numeric.kind) {
+        case NODE_ADD:
+            result = fast_add(first, second);
+            break;
+        case NODE_SUBTRACT:
+            result = fast_subtract(first, second);
+            break;
+        case NODE_MULTIPLY:
+            result = fast_multiply(first, second);
+            break;
+        case NODE_DIVIDE:
+            result = fast_divide(first, second);
+            break;
+        default:
+            return fast_negate(first);
+    }
+    return result ? result : call_numeric(node, procedure, 2, first, second, env);
+}
+
+static bool compare_unboxed(int kind, double x, double y) {
+    switch (kind) {
+        case NODE_NUM_EQ:
+            return x == y;
+        case NODE_LT:
+            return x < y;
+        case NODE_GT:
+            return x > y;
+        case NODE_LE:
+            return x <= y;
+        default:
+            return x >= y;
+    }
+}
+
+static SchemeObject* eval_unboxed(Node* node, Environment* env, double* value);
+
+// Evaluates operand i of a node computing in doubles. For a number, true
+// with its value in *value. *object is the operand as an object, or NULL
+// when it was computed unboxed.
+static bool unboxed_operand(Node* node, int i, Environment* env, double* value,
+                            SchemeObject** object) {
+    if (node->numeric.unboxed & (1 << i)) {
+        *object = eval_unboxed(node->numeric.operands[i], env, value);
+        if (!*object) {
+            return true;
+        }
+    } else {
+        *object = execute(node->numeric.operands[i], env);
+    }
+    if (is_numeric(*object)) {
+        *value = number_value(*object);
+        return true;
+    }
+    return false;
+}
+
+// When the doubles will not do, the generic step takes over with the
+// operands boxed, a flonum node deoptimizing first
+static SchemeObject* unboxed_fallback(Node* node, SchemeObject* procedure, SchemeObject* first,
+                                      double x, SchemeObject* second, double y, Environment* env) {
+    if (!first) {
+        first = make_number(x);
+    }
+    if (!second && node->numeric.kind != NODE_NEGATE) {
+        second = make_number(y);
+    }
+    if (node->eval == eval_flonum_arithmetic_node || node->eval == eval_flonum_comparison_node) {
+        deoptimize(node, NUMERIC_OP(node).generic);
+    }
+    return NUMERIC_OP(node).step(node, procedure, first, second, env);
+}
+
+// Computes an arithmetic node into *value and returns NULL; or returns the
+// node's value as an object: the exact result of exact operands, or, if the
+// operator is not the builtin, an operand is not a number or the builtin
+// would report an error, the value of the generic step
+static SchemeObject* eval_unboxed(Node* node, Environment* env, double* value) {
+    int kind = node->numeric.kind;
+    SchemeObject* procedure = execute(node->numeric.operator, env);
+    SchemeObject* first;
+    SchemeObject* second = NULL;
+    double x;
+    double y = 0.0;
+    bool numbers = unboxed_operand(node, 0, env, &x, &first);
+    if (kind != NODE_NEGATE && !unboxed_operand(node, 1, env, &y, &second)) {
+        numbers = false;
+    }
+    if (numbers && is_builtin(procedure, NUMERIC_OP(node).builtin)) {
+        // An operand computed unboxed is an inexact one
+        if (is_fixnum(first) && (kind == NODE_NEGATE || is_fixnum(second))) {
+            return compute_exact(node, procedure, first, second, env);
+        }
+        if (compute_unboxed(kind, x, y, value)) {
+            return NULL;
+        }
+    }
+    return unboxed_fallback(node, procedure, first, x, second, y, env);
+}
+
+static SchemeObject* eval_flonum_arithmetic_node(Node* node, Environment* env) {
+    double value;
+    SchemeObject* result = eval_unboxed(node, env, &value);
+    return result ? result : make_number(value);
+}
+
+static SchemeObject* eval_flonum_comparison_node(Node* node, Environment* env) {
+    SchemeObject* procedure = execute(node->numeric.operator, env);
+    SchemeObject* first;
+    SchemeObject* second;
+    double x;
+    double y;
+    bool numbers = unboxed_operand(node, 0, env, &x, &first);
+    if (!unboxed_operand(node, 1, env, &y, &second)) {
+        numbers = false;
+    }
+    if (numbers && is_builtin(procedure, NUMERIC_OP(node).builtin)) {
+        return compare_unboxed(node->numeric.kind, x, y) ? SCHEME_TRUE_OBJECT : SCHEME_FALSE_OBJECT;
+    }
+    return unboxed_fallback(node, procedure, first, x, second, y, env);
+}
+
+void print_feedback_stats(FILE* out) {
+    if (!profiles) {
+        fprintf(out, "Type feedback: no numeric calls specialized\n");
+        return;
+    }
+
+    size_t count = 0;
+    uint64_t specializations = 0;
+    uint64_t deopts = 0;
+    for (NumericProfile* profile = profiles; profile; profile = profile->next) {
+        count++;
+        specializations += profile->specializations;
+        deopts += profile->deopts;
+    }
+    fprintf(out, "Type feedback: %llu specializations and %llu deoptimizations in %zu bodies\n",
+            (unsigned long long)specializations, (unsigned long long)deopts, count);
+    fprintf(out, "  %-24s %16s %14s\n", "procedure", "specializations", "deopts");
+    for (NumericProfile* profile = profiles; profile; profile = profile->next) {
+        fprintf(out, "  %-24s %16llu %14llu\n", profile->name,
+                (unsigned long long)profile->specializations,
+                (unsigned long long)profile->deopts);
+    }
+}
+
+void cleanup_feedback(void) {
+    while (profiles) {
+        NumericProfile* next = profiles->next;
+        scheme_free(profiles->name);
+        scheme_free(profiles);
+        profiles = next;
+    }
+    profiles_tail = &profiles;
+}
+
+NodeKind node_kind(const Node* node) {
+    static const struct {
+        NodeFn eval;
+        NodeKind kind;
+    } kinds[] = {
+        {eval_constant_node, NODE_CONSTANT}, {eval_local0_node, NODE_LOCAL0},
+        {eval_local_node, NODE_LOCAL}, {eval_global_node, NODE_GLOBAL},
+        {eval_if_node, NODE_IF}, {eval_sequence_node, NODE_SEQUENCE},
+        {eval_and_node, NODE_AND}, {eval_or_node, NODE_OR}, {eval_cond_node, NODE_COND},
+        {eval_call_node, NODE_CALL}, {eval_tail_call_node, NODE_TAIL_CALL},
+        {eval_add_node, NODE_ADD}, {eval_subtract_node, NODE_SUBTRACT},
+        {eval_multiply_node, NODE_MULTIPLY}, {eval_divide_node, NODE_DIVIDE},
+        {eval_negate_node, NODE_NEGATE}, {eval_num_eq_node, NODE_NUM_EQ},
+        {eval_lt_node, NODE_LT}, {eval_gt_node, NODE_GT},
+        {eval_le_node, NODE_LE}, {eval_ge_node, NODE_GE},
+        // The machine code has fixnum paths of its own; flonum nodes, which
+        // it would send down the generic call, are called as they are
+        {eval_add_fixnum_node, NODE_ADD}, {eval_subtract_fixnum_node, NODE_SUBTRACT},
+        {eval_multiply_fixnum_node, NODE_MULTIPLY}, {eval_divide_fixnum_node, NODE_DIVIDE},
+        {eval_negate_fixnum_node, NODE_NEGATE}, {eval_num_eq_fixnum_node, NODE_NUM_EQ},
+        {eval_lt_fixnum_node, NODE_LT}, {eval_gt_fixnum_node, NODE_GT},
+        {eval_le_fixnum_node, NODE_LE}, {eval_ge_fixnum_node, NODE_GE},
+    };
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        if (node->eval == kinds[i].eval) {
+            return kinds[i].kind;
+        }
+    }
+    return NODE_OTHER;
+}
+
+// Analysis. tail is set for an expression whose value is the value of the
+// whole body or top-level form: its calls become tail calls.
+
+static Node* analyze(SchemeObject* expr, SchemeObject* code, bool tail);
+
+// While a lambda body is analysed, the slot its numeric nodes share for
+// their profile, allocated with the first of them
+static bool analysing_body = false;
+static NumericProfile** body_profile = NULL;
+
+static int proper_length(SchemeObject* list) {
+    int length = 0;
+    for (; is_pair(list); list = cdr(list)) {
+        length++;
+    }
+    return is_nil(list) ? length : -1;
+}
+
+static Node* fallback_node(SchemeObject* expr, SchemeObject* code) {
+    Node* node = new_node(code, eval_fallback_node);
+    node->expr = expr;
+    return node;
+}
+
+static Node* constant_node(SchemeObject* value, SchemeObject* code) {
+    Node* node = new_node(code, eval_constant_node);
+    node->constant = value;
+    return node;
+}
+
+// With tail set, the last expression is in tail position
+static Node** analyze_list(SchemeObject* list, int count, SchemeObject* code, bool tail) {
+    Node** nodes = (Node**)code_alloc(code, (size_t)(count > 0 ? count : 1) * sizeof(Node*));
+    for (int i = 0; i < count; i++, list = cdr(list)) {
+        nodes[i] = analyze(car(list), code, tail && i == count - 1);
+    }
+    return nodes;
+}
+
+// A body or begin: () when empty, the expression itself when alone
+static Node* analyze_sequence(SchemeObject* exprs, SchemeObject* code, bool tail) {
+    int count = 0;
+    for (SchemeObject* e = exprs; is_pair(e); e = cdr(e)) {
+        count++;
+    }
+    if (count == 0) {
+        return constant_node(SCHEME_NIL_OBJECT, code);
+    }
+    if (count == 1) {
+        return analyze(car(exprs), code, tail);
+    }
+
+    Node* node = new_node(code, eval_sequence_node);
+    node->sequence.items = analyze_list(exprs, count, code, tail);
+    node->sequence.count = count;
+    return node;
+}
+
+static Node* analyze_variable(SchemeObject* ref, SchemeObject* code) {
+    if (is_local_ref(ref)) {
+        Node* node = new_node(code, ref->value.local_depth == 0 ? eval_local0_node : eval_local_node);
+        node->local.depth = ref->value.local_depth;
+        node->local.slot = ref->value.local_slot;
+        return node;
+    }
+
+    Node* node = new_node(code, eval_global_node);
+    node->global.ref = ref;
+    return node;
+}
+
+// A lambda bound to a variable takes its name, for the JIT's statistics
+static void name_lambda(Node* value, SchemeObject* name) {
+    if (value->eval == eval_lambda_node && !value->lambda.code->value.code.name) {
+        gc_write_barrier(value->lambda.code, name);
+        value->lambda.code->value.code.name = name;
+    }
+}
+
+// define and set! of a variable: (op target value)
+static Node* analyze_assignment(SchemeObject* expr, SchemeObject* code, bool define) {
+    SchemeObject* args = cdr(expr);
+    if (proper_length(args) != 2) {
+        return fallback_node(expr, code);
+    }
+
+    SchemeObject* target = car(args);
+    SchemeObject* value = car(cdr(args));
+    Node* node;
+    if (is_local_ref(target)) {
+        node = new_node(code, define ? eval_define_local_node : eval_set_local_node);
+        node->local.depth = target->value.local_depth;
+        node->local.slot = target->value.local_slot;
+        node->local.value = analyze(value, code, false);
+    } else if (is_symbol(target)) {
+        node = new_node(code, define ? eval_define_global_node : eval_set_global_node);
+        node->global.symbol = target;
+        node->global.value = analyze(value, code, false);
+        name_lambda(node->global.value, target);
+    } else {
+        return fallback_node(expr, code);
+    }
+    return node;
+}
+
+static Node* analyze_if(SchemeObject* expr, SchemeObject* code, bool tail) {
+    SchemeObject* args = cdr(expr);
+    int length = proper_length(args);
+    if (length != 2 && length != 3) {
+        return fallback_node(expr, code);
+    }
+
+    Node* node = new_node(code, eval_if_node);
+    node->branch.test = analyze(car(args), code, false);
+    node->branch.consequent = analyze(car(cdr(args)), code, tail);
+    node->branch.alternative = length == 3 ? analyze(car(cdr(cdr(args))), code, tail) : NULL;
+    return node;
+}
+
+static Node* analyze_and_or(SchemeObject* expr, SchemeObject* code, NodeFn eval, bool tail) {
+    int count = proper_length(cdr(expr));
+    if (count < 0) {
+        return fallback_node(expr, code);
+    }
+
+    Node* node = new_node(code, eval);
+    node->sequence.items = analyze_list(cdr(expr), count, code, tail);
+    node->sequence.count = count;
+    return node;
+}
+
+static Node* analyze_cond(SchemeObject* expr, SchemeObject* code, bool tail) {
+    SchemeObject* clauses = cdr(expr);
+    int count = proper_length(clauses);
+    if (count < 0) {
+        return fallback_node(expr, code);
+    }
+
+    // Malformed clauses, and an else that is not last, are errors only when
+    // evaluation reaches them; leave those to eval_cond
+    int i = 0;
+    for (SchemeObject* c = clauses; is_pair(c); c = cdr(c), i++) {
+        SchemeObject* clause = car(c);
+        if (!is_pair(clause) || proper_length(clause) < 0 ||
+            (car(clause) == SYMBOL_ELSE && i != count - 1)) {
+            return fallback_node(expr, code);
+        }
+    }
+
+    Node* node = new_node(code, eval_cond_node);
+    node->cond.tests = (Node**)code_alloc(code, (size_t)(count > 0 ? count : 1) * sizeof(Node*));
+    node->cond.bodies = (Node**)code_alloc(code, (size_t)(count > 0 ? count : 1) * sizeof(Node*));
+    node->cond.count = count;
+
+    i = 0;
+    for (SchemeObject* c = clauses; is_pair(c); c = cdr(c), i++) {
+        SchemeObject* clause = car(c);
+        node->cond.tests[i] = car(clause) == SYMBOL_ELSE ? NULL : analyze(car(clause), code, false);
+        node->cond.bodies[i] = is_pair(cdr(clause)) ? analyze_sequence(cdr(clause), code, tail) : NULL;
+    }
+    return node;
+}
+
+// (lambda layout params body...): the body becomes a code object of its own
+static Node* analyze_lambda(SchemeObject* expr, SchemeObject* code) {
+    SchemeObject* args = cdr(expr);
+    SchemeObject* body = cdr(cdr(args));
+
+    SchemeObject* body_code = make_code(expr);
+    add_child(code, body_code);
+    bool outer_in_body = analysing_body;
+    NumericProfile** outer_profile = body_profile;
+    analysing_body = true;
+    body_profile = NULL;
+    body_code->value.code.root = analyze_sequence(body, body_code, true);
+    analysing_body = outer_in_body;
+    body_profile = outer_profile;
+
+    Node* node = new_node(code, eval_lambda_node);
+    node->lambda.code = body_code;
+    node->lambda.layout = car(args);
+    node->lambda.params = car(cdr(args));
+    node->lambda.body = body;
+    return node;
+}
+
+// (let layout ((local init) ...) body...), and likewise let* and letrec
+static Node* analyze_let(SchemeObject* expr, SchemeObject* code, bool tail) {
+    SchemeObject* args = cdr(expr);
+    SchemeObject* bindings = car(cdr(args));
+    int count = proper_length(bindings);
+
+    Node* node = new_node(code, eval_let_node);
+    node->let.layout = car(args);
+    node->let.kind = car(expr);
+    node->let.count = count;
+    node->let.slots = (int*)code_alloc(code, (size_t)(count > 0 ? count : 1) * sizeof(int));
+    node->let.inits = (Node**)code_alloc(code, (size_t)(count > 0 ? count : 1) * sizeof(Node*));
+
+    int i = 0;
+    for (SchemeObject* b = bindings; is_pair(b); b = cdr(b), i++) {
+        SchemeObject* binding = car(b);
+        node->let.slots[i] = car(binding)->value.local_slot;
+        node->let.inits[i] = analyze(car(cdr(binding)), code, false);
+        name_lambda(node->let.inits[i], node->let.layout->value.vector.elements[node->let.slots[i]]);
+    }
+
+    node->let.body = analyze_sequence(cdr(cdr(args)), code, tail);
+    return node;
+}
+
+// (let-values layout ((targets init) ...) body...)
+static Node* analyze_let_values(SchemeObject* expr, SchemeObject* code, bool tail) {
+    SchemeObject* args = cdr(expr);
+    SchemeObject* clauses = car(cdr(args));
+    int count = proper_length(clauses);
+
+    Node* node = new_node(code, eval_let_values_node);
+    node->let_values.layout = car(args);
+    node->let_values.count = count;
+    node->let_values.targets = (SchemeObject**)code_alloc(code, (size_t)(count > 0 ? count : 1) * sizeof(SchemeObject*));
+    node->let_values.inits = (Node**)code_alloc(code, (size_t)(count > 0 ? count : 1) * sizeof(Node*));
+
+    int i = 0;
+    for (SchemeObject* c = clauses; is_pair(c); c = cdr(c), i++) {
+        node->let_values.targets[i] = car(car(c));
+        node->let_values.inits[i] = analyze(car(cdr(car(c))), code, false);
+    }
+
+    node->let_values.body = analyze_sequence(cdr(cdr(args)), code, tail);
+    return node;
+}
+
+// The node function for a call of a numeric operator, or NULL; its kind in
+// *kind
+static NodeFn numeric_node(SchemeObject* operator, int argc, NodeKind* kind) {
+    static const struct {
+        const char* name;
+        NodeFn eval;
+        NodeKind kind;
+    } operators[] = {
+        {"+", eval_add_node, NODE_ADD}, {"-", eval_subtract_node, NODE_SUBTRACT},
+        {"*", eval_multiply_node, NODE_MULTIPLY}, {"/", eval_divide_node, NODE_DIVIDE},
+        {"=", eval_num_eq_node, NODE_NUM_EQ}, {"<", eval_lt_node, NODE_LT},
+        {">", eval_gt_node, NODE_GT}, {"<=", eval_le_node, NODE_LE},
+        {">=", eval_ge_node, NODE_GE},
+    };
+    if (!is_global_ref(operator)) {
+        return NULL;
+    }
+    const char* name = operator->value.global_symbol->value.symbol_name;
+    if (argc == 1) {
+        *kind = NODE_NEGATE;
+        return strcmp(name, "-") == 0 ? eval_negate_node : NULL;
+    }
+    for (size_t i = 0; argc == 2 && i < sizeof(operators) / sizeof(operators[0]); i++) {
+        if (strcmp(name, operators[i].name) == 0) {
+            *kind = operators[i].kind;
+            return operators[i].eval;
+        }
+    }
+    return NULL;
+}
+
+static bool is_arithmetic_node(const Node* node) {
+    NodeKind kind = node_kind(node);
+    return kind >= NODE_ADD && kind <= NODE_NEGATE;
+}
+
+static Node* analyze_application(SchemeObject* expr, SchemeObject* code, bool tail) {
+    int argc = proper_length(cdr(expr));
+    if (argc < 0) {
+        return fallback_node(expr, code);
+    }
+
+    NodeKind kind;
+    NodeFn numeric = numeric_node(car(expr), argc, &kind);
+    if (numeric) {
+        Node* node = new_node(code, numeric);
+        node->numeric.operator = analyze(car(expr), code, false);
+        node->numeric.operands[0] = analyze(car(cdr(expr)), code, false);
+        if (argc == 2) {
+            node->numeric.operands[1] = analyze(car(cdr(cdr(expr))), code, false);
+        }
+        node->numeric.tail = tail;
+        node->numeric.kind = (uint8_t)kind;
+        for (int i = 0; i < argc; i++) {
+            if (is_arithmetic_node(node->numeric.operands[i])) {
+                node->numeric.unboxed |= (uint8_t)(1 << i);
+            }
+        }
+        node->numeric.owner = code;
+        if (analysing_body) {
+            if (!body_profile) {
+                body_profile = (NumericProfile**)code_alloc(code, sizeof(NumericProfile*));
+                *body_profile = NULL;
+            }
+            node->numeric.profile = body_profile;
+        } else {
+            // Run once: not worth specializing
+            node->numeric.seen = SEEN_OTHER;
+        }
+        return node;
+    }
+
+    Node* node = new_node(code, tail ? eval_tail_call_node : eval_call_node);
+    node->call.operator = analyze(car(expr), code, false);
+    node->call.operands = analyze_list(cdr(expr), argc, code, false);
+    node->call.argc = argc;
+    return node;
+}
+
+static Node* analyze(SchemeObject* expr, SchemeObject* code, bool tail) {
+    check_stack_depth();
+    if (is_local_ref(expr) || is_global_ref(expr)) {
+        return analyze_variable(expr, code);
+    }
+    if (is_self_evaluating(expr)) {
+        return constant_node(expr, code);
+    }
+    if (!is_pair(expr)) {
+        return fallback_node(expr, code);
+    }
+
+    SchemeObject* head = car(expr);
+    if (is_symbol(head)) {
+        if (head == SYMBOL_QUOTE) {
+            SchemeObject* args = cdr(expr);
+            return proper_length(args) == 1 ? constant_node(car(args), code) : fallback_node(expr, code);
+        } else if (head == SYMBOL_IF) {
+            return analyze_if(expr, code, tail);
+        } else if (head == SYMBOL_DEFINE) {
+            return analyze_assignment(expr, code, true);
+        } else if (head == SYMBOL_SET) {
+            return analyze_assignment(expr, code, false);
+        } else if (head == SYMBOL_BEGIN) {
+            return proper_length(cdr(expr)) >= 0 ? analyze_sequence(cdr(expr), code, tail) : fallback_node(expr, code);
+        } else if (head == SYMBOL_AND) {
+            return analyze_and_or(expr, code, eval_and_node, tail);
+        } else if (head == SYMBOL_OR) {
+            return analyze_and_or(expr, code, eval_or_node, tail);
+        } else if (head == SYMBOL_COND) {
+            return analyze_cond(expr, code, tail);
+        } else if (head == SYMBOL_RESOLVED_LAMBDA) {
+            return analyze_lambda(expr, code);
+        } else if (head == SYMBOL_RESOLVED_LET || head == SYMBOL_RESOLVED_LET_STAR ||
+                   head == SYMBOL_RESOLVED_LETREC) {
+            return analyze_let(expr, code, tail);
+        } else if (head == SYMBOL_RESOLVED_LET_VALUES) {
+            return analyze_let_values(expr, code, tail);
+        }
+        // Unresolved forms (lambda, let, let* and letrec the resolver could
+        // not lay out) and unresolved variables
+        return fallback_node(expr, code);
+    }
+
+    return analyze_application(expr, code, tail);
+}
+
+SchemeObject* analyze_expression(SchemeObject* expr) {
+    SchemeObject* code = make_code(expr);
+    bool outer_in_body = analysing_body;
+    NumericProfile** outer_profile = body_profile;
+    analysing_body = false;
+    body_profile = NULL;
+    code->value.code.root = analyze(expr, code, true);
+    analysing_body = outer_in_body;
+    body_profile = outer_profile;
+    return code;
+}
@@ -0,0 +1,823 @@
+#include "rscheme.h"
+#include <math.h>
+
+// Magnitudes are arrays of digits, least significant first. The functions
+// on them take explicit lengths, accept leading zero digits, and write into
+// storage the caller has made room for.
+
+typedef uint32_t Digit;
+typedef uint64_t Wide;
+
+#define DIGIT_BITS 32
+
+static Digit* allocate_digits(size_t count) {
+    return (Digit*)scheme_malloc((count > 0 ? count : 1) * sizeof(Digit));
+}
+
+static size_t trimmed_length(const Digit* digits, size_t length) {
+    while (length > 0 && digits[length - 1] == 0) {
+        length--;
+    }
+    return length;
+}
+
+static int leading_zeros(Digit digit) {
+    int count = 0;
+    while (!(digit & 0x80000000u)) {
+        digit <<= 1;
+        count++;
+    }
+    return count;
+}
+
+static int compare_digits(const Digit* a, size_t an, const Digit* b, size_t bn) {
+    an = trimmed_length(a, an);
+    bn = trimmed_length(b, bn);
+    if (an != bn) {
+        return an < bn ? -1 : 1;
+    }
+    for (size_t i = an; i-- > 0;) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+// r[0..an] = a + b, for an >= bn. r may be a or b.
+static void add_digits(Digit* r, const Digit* a, size_t an, const Digit* b, size_t bn) {
+    Wide carry = 0;
+    size_t i = 0;
+    for (; i < bn; i++) {
+        carry += (Wide)a[i] + b[i];
+        r[i] = (Digit)carry;
+        carry >>= DIGIT_BITS;
+    }
+    for (; i < an; i++) {
+        carry += a[i];
+        r[i] = (Digit)carry;
+        carry >>= DIGIT_BITS;
+    }
+    r[an] = (Digit)carry;
+}
+
+// r[0..an) = a - b, for a >= b and an >= bn. r may be a or b.
+static void subtract_digits(Digit* r, const Digit* a, size_t an, const Digit* b, size_t bn) {
+    Wide borrow = 0;
+    size_t i = 0;
+    for (; i < bn; i++) {
+        Wide difference = (Wide)a[i] - b[i] - borrow;
+        r[i] = (Digit)difference;
+        borrow = difference >> 63;
+    }
+    for (; i < an; i++) {
+        Wide difference = (Wide)a[i] - borrow;
+        r[i] = (Digit)difference;
+        borrow = difference >> 63;
+    }
+}
+
+// r[0..rn) += a[0..an), for an <= rn; the sum must fit
+static void add_into(Digit* r, size_t rn, const Digit* a, size_t an) {
+    Wide carry = 0;
+    size_t i = 0;
+    for (; i < an; i++) {
+        carry += (Wide)r[i] + a[i];
+        r[i] = (Digit)carry;
+        carry >>= DIGIT_BITS;
+    }
+    for (; carry && i < rn; i++) {
+        carry += r[i];
+        r[i] = (Digit)carry;
+        carry >>= DIGIT_BITS;
+    }
+}
+
+// r[0..rn) -= a[0..an), for an <= rn and r >= a
+static void subtract_from(Digit* r, size_t rn, const Digit* a, size_t an) {
+    Wide borrow = 0;
+    size_t i = 0;
+    for (; i < an; i++) {
+        Wide difference = (Wide)r[i] - a[i] - borrow;
+        r[i] = (Digit)difference;
+        borrow = difference >> 63;
+    }
+    for (; borrow && i < rn; i++) {
+        Wide difference = (Wide)r[i] - borrow;
+        r[i] = (Digit)difference;
+        borrow = difference >> 63;
+    }
+}
+
+// r[0..n) = a << shift, for shift < DIGIT_BITS, returning the bits shifted
+// out. r may be a.
+static Digit shift_digits_left(Digit* r, const Digit* a, size_t n, int shift) {
+    Digit carry = 0;
+    for (size_t i = 0; i < n; i++) {
+        Digit digit = a[i];
+        r[i] = shift ? (digit << shift) | carry : digit;
+        carry = shift ? digit >> (DIGIT_BITS - shift) : 0;
+    }
+    return carry;
+}
+
+// digits[0..length) = digits * factor + addend, returning the new length;
+// there must be room for one more digit
+static size_t multiply_add_digit(Digit* digits, size_t length, Digit factor, Digit addend) {
+    Wide carry = addend;
+    for (size_t i = 0; i < length; i++) {
+        carry += (Wide)digits[i] * factor;
+        digits[i] = (Digit)carry;
+        carry >>= DIGIT_BITS;
+    }
+    if (carry) {
+        digits[length++] = (Digit)carry;
+    }
+    return length;
+}
+
+// q[0..an) = a / divisor, returning the remainder. q may be a or NULL.
+static Digit divide_by_digit(Digit* q, const Digit* a, size_t an, Digit divisor) {
+    Wide remainder = 0;
+    for (size_t i = an; i-- > 0;) {
+        Wide dividend = (remainder << DIGIT_BITS) | a[i];
+        if (q) {
+            q[i] = (Digit)(dividend / divisor);
+        }
+        remainder = dividend % divisor;
+    }
+    return (Digit)remainder;
+}
+
+// Multiplication. Each method writes r[0..an+bn) = a * b, where r shares no
+// storage with a or b.
+
+static void multiply_digits(Digit* r, const Digit* a, size_t an, const Digit* b, size_t bn);
+
+static void multiply_schoolbook(Digit* r, const Digit* a, size_t an, const Digit* b, size_t bn) {
+    memset(r, 0, (an + bn) * sizeof(Digit));
+    for (size_t i = 0; i < bn; i++) {
+        Digit digit = b[i];
+        if (digit == 0) {
+            continue;
+        }
+        Wide carry = 0;
+        for (size_t j = 0; j < an; j++) {
+            carry += (Wide)a[j] * digit + r[i + j];
+            r[i + j] = (Digit)carry;
+            carry >>= DIGIT_BITS;
+        }
+        r[i + an] = (Digit)carry;
+    }
+}
+
+// a is at least twice as long as b: b times each slice of a its length
+static void multiply_unbalanced(Digit* r, const Digit* a, size_t an, const Digit* b, size_t bn) {
+    Digit* product = allocate_digits(2 * bn);
+    memset(r, 0, (an + bn) * sizeof(Digit));
+    for (size_t i = 0; i < an; i += bn) {
+        size_t n = an - i < bn ? an - i : bn;
+        multiply_digits(product, a + i, n, b, bn);
+        add_into(r + i, an + bn - i, product, n + bn);
+    }
+    scheme_free(product);
+}
+
+// With a = a1 B^m + a0 and b = b1 B^m + b0, three half-size products:
+// a0 b0, a1 b1, and (a0 + a1)(b0 + b1), from which a0 b1 + a1 b0 follows.
+// Needs an >= bn > an / 2, so b has at least m digits.
+static void multiply_karatsuba(Digit* r, const Digit* a, size_t an, const Digit* b, size_t bn) {
+    size_t m = (an + 1) / 2;
+    const Digit* a1 = a + m;
+    const Digit* b1 = b + m;
+    size_t a1n = an - m;
+    size_t b1n = bn - m;
+
+    // a0 b0 and a1 b1 go straight to their places in r
+    multiply_digits(r, a, m, b, m);
+    multiply_digits(r + 2 * m, a1, a1n, b1, b1n);
+
+    Digit* scratch = allocate_digits(4 * m + 4);
+    Digit* sum_a = scratch;
+    Digit* sum_b = scratch + m + 1;
+    Digit* middle = scratch + 2 * m + 2;
+    add_digits(sum_a, a, m, a1, a1n);
+    add_digits(sum_b, b, m, b1, b1n);
+    multiply_digits(middle, sum_a, m + 1, sum_b, m + 1);
+    subtract_from(middle, 2 * m + 2, r, 2 * m);
+    subtract_from(middle, 2 * m + 2, r + 2 * m, a1n + b1n);
+    add_into(r + m, an + bn - m, middle, trimmed_length(middle, 2 * m + 2));
+    scheme_free(scratch);
+}
+
+// Toom-3 works with values of either sign
+typedef struct {
+    Digit* digits;
+    size_t length;
+    bool negative;
+} Signed;
+
+static void normalize_signed(Signed* x) {
+    x->length = trimmed_length(x->digits, x->length);
+    if (x->length == 0) {
+        x->negative = false;
+    }
+}
+
+// r = x + y, or x - y; r may be x or y and has room for one digit more
+// than the longer of them
+static void combine_signed(Signed* r, const Signed* x, const Signed* y, bool subtract) {
+    size_t xn = x->length;
+    size_t yn = y->length;
+    bool x_negative = x->negative;
+    bool y_negative = y->negative != subtract;
+    if (x_negative == y_negative) {
+        if (xn >= yn) {
+            add_digits(r->digits, x->digits, xn, y->digits, yn);
+        } else {
+            add_digits(r->digits, y->digits, yn, x->digits, xn);
+        }
+        r->length = (xn >= yn ? xn : yn) + 1;
+        r->negative = x_negative;
+    } else if (compare_digits(x->digits, xn, y->digits, yn) >= 0) {
+        subtract_digits(r->digits, x->digits, xn, y->digits, yn);
+        r->length = xn;
+        r->negative = x_negative;
+    } else {
+        subtract_digits(r->digits, y->digits, yn, x->digits, xn);
+        r->length = yn;
+        r->negative = y_negative;
+    }
+    normalize_signed(r);
+}
+
+// r = x y; r has room for the digits of both
+static void multiply_signed(Signed* r, const Signed* x, const Signed* y) {
+    multiply_digits(r->digits, x->digits, x->length, y->digits, y->length);
+    r->length = x->length + y->length;
+    r->negative = x->negative != y->negative;
+    normalize_signed(r);
+}
+
+// x = 2x; x has room for one more digit
+static void double_signed(Signed* x) {
+    x->digits[x->length] = shift_digits_left(x->digits, x->digits, x->length, 1);
+    x->length++;
+    normalize_signed(x);
+}
+
+// x = x / divisor, which must divide it
+static void divide_signed(Signed* x, Digit divisor) {
+    divide_by_digit(x->digits, x->digits, x->length, divisor);
+    normalize_signed(x);
+}
+
+// The part of a from digit start, at most count digits long
+static Signed toom_piece(const Digit* a, size_t an, size_t start, size_t count) {
+    Signed piece;
+    piece.digits = (Digit*)(start < an ? a + start : a);
+    piece.length = start >= an ? 0 : (an - start < count ? an - start : count);
+    piece.negative = false;
+    normalize_signed(&piece);
+    return piece;
+}
+
+// The polynomial x0 + x1 t + x2 t^2 at t = 1, -1 and -2
+static void toom_evaluate(const Signed* x0, const Signed* x1, const Signed* x2,
+                          Signed* at_1, Signed* at_minus_1, Signed* at_minus_2) {
+    combine_signed(at_1, x0, x2, false);
+    combine_signed(at_minus_1, at_1, x1, true);
+    combine_signed(at_1, at_1, x1, false);
+    combine_signed(at_minus_2, at_minus_1, x2, false);
+    double_signed(at_minus_2);
+    combine_signed(at_minus_2, at_minus_2, x0, true);
+}
+
+// a and b as polynomials in t = B^k with three coefficients each; their
+// product's five coefficients are found from its values at 0, 1, -1, -2 and
+// infinity, which take five products of a third of the size. The
+// interpolation is Bodrato's. Needs an >= bn > 2 an / 3.
+static void multiply_toom3(Digit* r, const Digit* a, size_t an, const Digit* b, size_t bn) {
+    size_t k = (an + 2) / 3;
+    Signed a0 = toom_piece(a, an, 0, k);
+    Signed a1 = toom_piece(a, an, k, k);
+    Signed a2 = toom_piece(a, an, 2 * k, k);
+    Signed b0 = toom_piece(b, bn, 0, k);
+    Signed b1 = toom_piece(b, bn, k, k);
+    Signed b2 = toom_piece(b, bn, 2 * k, k);
+
+    // Room for a value of a or b, and for a product with a digit to spare
+    size_t value_size = k + 2;
+    size_t product_size = 2 * value_size + 1;
+    Digit* scratch = allocate_digits(6 * value_size + 5 * product_size);
+    Signed values[6];
+    Signed products[5];
+    for (int i = 0; i < 6; i++) {
+        values[i] = (Signed){scratch + i * value_size, 0, false};
+    }
+    for (int i = 0; i < 5; i++) {
+        products[i] = (Signed){scratch + 6 * value_size + i * product_size, 0, false};
+    }
+
+    toom_evaluate(&a0, &a1, &a2, &values[0], &values[1], &values[2]);
+    toom_evaluate(&b0, &b1, &b2, &values[3], &values[4], &values[5]);
+    Signed* r0 = &products[0];
+    Signed* r1 = &products[1];
+    Signed* r_minus_1 = &products[2];
+    Signed* r_minus_2 = &products[3];
+    Signed* r_infinity = &products[4];
+    multiply_signed(r0, &a0, &b0);
+    multiply_signed(r1, &values[0], &values[3]);
+    multiply_signed(r_minus_1, &values[1], &values[4]);
+    multiply_signed(r_minus_2, &values[2], &values[5]);
+    multiply_signed(r_infinity, &a2, &b2);
+
+    // The coefficients of t^3, t and t^2 replace the values at -2, 1 and -1
+    Signed* c3 = r_minus_2;
+    Signed* c1 = r1;
+    Signed* c2 = r_minus_1;
+    combine_signed(c3, r_minus_2, r1, true);
+    divide_signed(c3, 3);
+    combine_signed(c1, r1, r_minus_1, true);
+    divide_signed(c1, 2);
+    combine_signed(c2, r_minus_1, r0, true);
+    combine_signed(c3, c2, c3, true);
+    divide_signed(c3, 2);
+    combine_signed(c3, c3, r_infinity, false);
+    combine_signed(c3, c3, r_infinity, false);
+    combine_signed(c2, c2, c1, false);
+    combine_signed(c2, c2, r_infinity, true);
+    combine_signed(c1, c1, c3, true);
+
+    const Signed* coefficients[5] = {r0, c1, c2, c3, r_infinity};
+    memset(r, 0, (an + bn) * sizeof(Digit));
+    for (size_t i = 0; i < 5; i++) {
+        if (coefficients[i]->length > 0) {
+            add_into(r + i * k, an + bn - i * k, coefficients[i]->digits,
+                     coefficients[i]->length);
+        }
+    }
+    scheme_free(scratch);
+}
+
+static void multiply_digits(Digit* r, const Digit* a, size_t an, const Digit* b, size_t bn) {
+    size_t length = an + bn;
+    an = trimmed_length(a, an);
+    bn = trimmed_length(b, bn);
+    if (an < bn) {
+        const Digit* digits = a;
+        size_t n = an;
+        a = b;
+        an = bn;
+        b = digits;
+        bn = n;
+    }
+    memset(r + an + bn, 0, (length - an - bn) * sizeof(Digit));
+
+    if (bn < BIGNUM_KARATSUBA_THRESHOLD) {
+        multiply_schoolbook(r, a, an, b, bn);
+    } else if (2 * bn <= an) {
+        multiply_unbalanced(r, a, an, b, bn);
+    } else if (bn >= BIGNUM_TOOM3_THRESHOLD && 3 * bn > 2 * an) {
+        multiply_toom3(r, a, an, b, bn);
+    } else {
+        multiply_karatsuba(r, a, an, b, bn);
+    }
+}
+
+// Knuth's algorithm D: q[0..an-bn] = a / b and r[0..bn) = a mod b, for
+// an >= bn >= 2 and b[bn - 1] non-zero. The divisor is shifted so its top
+// bit is set, which makes each estimated quotient digit at most two too
+// large; the estimate is corrected against the top two divisor digits, and
+// the rare remaining error by adding the divisor back. Either output may
+// be NULL.
+static void divide_digits(Digit* q, Digit* r, const Digit* a, size_t an, const Digit* b, size_t bn) {
+    int shift = leading_zeros(b[bn - 1]);
+    Digit* v = allocate_digits(bn);
+    Digit* u = allocate_digits(an + 1);
+    shift_digits_left(v, b, bn, shift);
+    u[an] = shift_digits_left(u, a, an, shift);
+
+    Wide top = v[bn - 1];
+    Wide next = v[bn - 2];
+    for (size_t j = an - bn + 1; j-- > 0;) {
+        Wide dividend = ((Wide)u[j + bn] << DIGIT_BITS) | u[j + bn - 1];
+        Wide estimate = dividend / top;
+        Wide rest = dividend % top;
+        while (estimate >> DIGIT_BITS ||
+               estimate * next > ((rest << DIGIT_BITS) | u[j + bn - 2])) {
+            estimate--;
+            rest += top;
+            if (rest >> DIGIT_BITS) {
+                break;
+            }
+        }
+
+        // u[j..j+bn] -= estimate * v
+        int64_t borrow = 0;
+        int64_t difference;
+        for (size_t i = 0; i < bn; i++) {
+            Wide product = estimate * v[i];
+            difference = (int64_t)u[i + j] - borrow - (int64_t)(product & 0xFFFFFFFFu);
+            u[i + j] = (Digit)difference;
+            borrow = (int64_t)(product >> DIGIT_BITS) - (difference >> DIGIT_BITS);
+        }
+        difference = (int64_t)u[j + bn] - borrow;
+        u[j + bn] = (Digit)difference;
+
+        if (difference < 0) {
+            estimate--;
+            Wide carry = 0;
+            for (size_t i = 0; i < bn; i++) {
+                carry += (Wide)u[i + j] + v[i];
+                u[i + j] = (Digit)carry;
+                carry >>= DIGIT_BITS;
+            }
+            u[j + bn] += (Digit)carry;
+        }
+        if (q) {
+            q[j] = (Digit)estimate;
+        }
+    }
+
+    if (r) {
+        for (size_t i = 0; i < bn; i++) {
+            r[i] = shift ? (u[i] >> shift) | (u[i + 1] << (DIGIT_BITS - shift)) : u[i];
+        }
+    }
+    scheme_free(v);
+    scheme_free(u);
+}
+
+// Exact integers as magnitude and sign, whichever their representation. A
+// fixnum's digits are kept in the view itself.
+typedef struct {
+    const Digit* digits;
+    size_t length;
+    bool negative;
+    Digit small[2];
+} IntegerView;
+
+static void view_integer(SchemeObject* obj, IntegerView* view) {
+    if (is_fixnum(obj)) {
+        intptr_t value = fixnum_value(obj);
+        uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+        view->small[0] = (Digit)magnitude;
+        view->small[1] = (Digit)(magnitude >> DIGIT_BITS);
+        view->digits = view->small;
+        view->length = trimmed_length(view->small, 2);
+        view->negative = value < 0;
+    } else {
+        view->digits = obj->value.bignum.digits;
+        view->length = obj->value.bignum.length;
+        view->negative = obj->value.bignum.negative;
+    }
+}
+
+// The integer with the given magnitude and sign. Takes the digits, which
+// become the bignum's or are freed. Operands' digits must not be read
+// after this, since the bignum's cell may be allocated by a collection
+// that frees them.
+static SchemeObject* make_integer_from_digits(Digit* digits, size_t length, bool negative) {
+    length = trimmed_length(digits, length);
+    if (length <= 2) {
+        uint64_t magnitude = length > 0 ? digits[0] : 0;
+        if (length == 2) {
+            magnitude |= (uint64_t)digits[1] << DIGIT_BITS;
+        }
+        if (magnitude <= (uint64_t)SCHEME_FIXNUM_MAX) {
+            scheme_free(digits);
+            intptr_t value = (intptr_t)magnitude;
+            return make_fixnum(negative ? -value : value);
+        }
+    }
+    return make_bignum(digits, (uint32_t)length, negative);
+}
+
+SchemeObject* make_integer(intptr_t value) {
+    if (value >= SCHEME_FIXNUM_MIN && value <= SCHEME_FIXNUM_MAX) {
+        return make_fixnum(value);
+    }
+    uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    Digit* digits = allocate_digits(2);
+    digits[0] = (Digit)magnitude;
+    digits[1] = (Digit)(magnitude >> DIGIT_BITS);
+    return make_integer_from_digits(digits, 2, value < 0);
+}
+
+static SchemeObject* add_integers(SchemeObject* a, SchemeObject* b, bool subtract) {
+    IntegerView x;
+    IntegerView y;
+    view_integer(a, &x);
+    view_integer(b, &y);
+    bool y_negative = y.negative != subtract;
+
+    if (x.negative == y_negative) {
+        if (x.length < y.length) {
+            IntegerView* longer = &y;
+            IntegerView* shorter = &x;
+            Digit* digits = allocate_digits(longer->length + 1);
+            add_digits(digits, longer->digits, longer->length, shorter->digits, shorter->length);
+            return make_integer_from_digits(digits, longer->length + 1, x.negative);
+        }
+        Digit* digits = allocate_digits(x.length + 1);
+        add_digits(digits, x.digits, x.length, y.digits, y.length);
+        return make_integer_from_digits(digits, x.length + 1, x.negative);
+    }
+
+    if (compare_digits(x.digits, x.length, y.digits, y.length) >= 0) {
+        Digit* digits = allocate_digits(x.length);
+        subtract_digits(digits, x.digits, x.length, y.digits, y.length);
+        return make_integer_from_digits(digits, x.length, x.negative);
+    }
+    Digit* digits = allocate_digits(y.length);
+    subtract_digits(digits, y.digits, y.length, x.digits, x.length);
+    return make_integer_from_digits(digits, y.length, y_negative);
+}
+
+// Fixnum sums and differences never overflow an intptr_t. The builtins
+// start their sums from 0 and products from 1, so those are passed over
+// rather than copying the bignum.
+SchemeObject* integer_add(SchemeObject* a, SchemeObject* b) {
+    if (is_fixnum(a) && is_fixnum(b)) {
+        return make_integer(fixnum_value(a) + fixnum_value(b));
+    }
+    if (a == make_fixnum(0)) {
+        return b;
+    }
+    return add_integers(a, b, false);
+}
+
+SchemeObject* integer_subtract(SchemeObject* a, SchemeObject* b) {
+    if (is_fixnum(a) && is_fixnum(b)) {
+        return make_integer(fixnum_value(a) - fixnum_value(b));
+    }
+    return add_integers(a, b, true);
+}
+
+SchemeObject* integer_multiply(SchemeObject* a, SchemeObject* b) {
+    if (is_fixnum(a) && is_fixnum(b)) {
+        // The double product is within a rounding of the exact one, so a
+        // small one means the integer product cannot overflow
+        intptr_t x = fixnum_value(a);
+        intptr_t y = fixnum_value(b);
+        if (fabs((double)x * (double)y) < (double)(SCHEME_FIXNUM_MAX / 2)) {
+            return make_fixnum(x * y);
+        }
+    }
+    if (a == make_fixnum(1)) {
+        return b;
+    }
+
+    IntegerView x;
+    IntegerView y;
+    view_integer(a, &x);
+    view_integer(b, &y);
+    Digit* digits = allocate_digits(x.length + y.length);
+    multiply_digits(digits, x.digits, x.length, y.digits, y.length);
+    return make_integer_from_digits(digits, x.length + y.length, x.negative != y.negative);
+}
+
+SchemeObject* integer_negate(SchemeObject* a) {
+    if (is_fixnum(a)) {
+        // The fixnum range is symmetric
+        return make_fixnum(-fixnum_value(a));
+    }
+    size_t length = a->value.bignum.length;
+    Digit* digits = allocate_digits(length);
+    memcpy(digits, a->value.bignum.digits, length * sizeof(Digit));
+    return make_integer_from_digits(digits, length, !a->value.bignum.negative);
+}
+
+SchemeObject* integer_expt(SchemeObject* base, uint64_t exponent) {
+    SchemeObject* result = make_fixnum(1);
+    SchemeObject* power = base;
+    while (exponent) {
+        if (exponent & 1) {
+            result = integer_multiply(result, power);
+        }
+        exponent >>= 1;
+        if (exponent) {
+            power = integer_multiply(power, power);
+        }
+    }
+    return result;
+}
+
+void integer_divide(SchemeObject* a, SchemeObject* b, SchemeObject** quotient,
+                    SchemeObject** remainder) {
+    if (is_fixnum(a) && is_fixnum(b)) {
+        intptr_t x = fixnum_value(a);
+        intptr_t y = fixnum_value(b);
+        if (quotient) {
+            *quotient = make_fixnum(x / y);
+        }
+        if (remainder) {
+            *remainder = make_fixnum(x % y);
+        }
+        return;
+    }
+
+    IntegerView x;
+    IntegerView y;
+    view_integer(a, &x);
+    view_integer(b, &y);
+    bool negative = x.negative != y.negative;
+
+    if (compare_digits(x.digits, x.length, y.digits, y.length) < 0) {
+        if (quotient) {
+            *quotient = make_fixnum(0);
+        }
+        if (remainder) {
+            *remainder = a;
+        }
+        return;
+    }
+
+    Digit* q = quotient ? allocate_digits(x.length) : NULL;
+    Digit* r;
+    size_t r_length;
+    if (y.length == 1) {
+        r = allocate_digits(1);
+        r[0] = divide_by_digit(q, x.digits, x.length, y.digits[0]);
+        r_length = 1;
+    } else {
+        r = allocate_digits(y.length);
+        divide_digits(q, r, x.digits, x.length, y.digits, y.length);
+        r_length = y.length;
+    }
+
+    // Both digit arrays are made before either result object
+    SchemeObject* result = q ? make_integer_from_digits(q, x.length - y.length + 1, negative) : NULL;
+    if (remainder) {
+        *remainder = make_integer_from_digits(r, r_length, x.negative);
+    } else {
+        scheme_free(r);
+    }
+    if (quotient) {
+        *quotient = result;
+    }
+}
+
+int integer_compare(SchemeObject* a, SchemeObject* b) {
+    if (is_fixnum(a) && is_fixnum(b)) {
+        intptr_t x = fixnum_value(a);
+        intptr_t y = fixnum_value(b);
+        return (x > y) - (x < y);
+    }
+
+    IntegerView x;
+    IntegerView y;
+    view_integer(a, &x);
+    view_integer(b, &y);
+    if (x.negative != y.negative) {
+        return x.negative ? -1 : 1;
+    }
+    int order = compare_digits(x.digits, x.length, y.digits, y.length);
+    return x.negative ? -order : order;
+}
+
+int integer_compare_double(SchemeObject* a, double x) {
+    if (isinf(x)) {
+        return x > 0 ? -1 : 1;
+    }
+    if (is_fixnum(a)) {
+        // Fixnums convert exactly
+        double value = (double)fixnum_value(a);
+        return (value > x) - (value < x);
+    }
+    double whole = floor(x);
+    int order = integer_compare(a, integer_from_double(whole));
+    if (order != 0) {
+        return order;
+    }
+    return whole < x ? -1 : 0;
+}
+
+int integer_sign(SchemeObject* a) {
+    if (is_fixnum(a)) {
+        intptr_t value = fixnum_value(a);
+        return (value > 0) - (value < 0);
+    }
+    return a->value.bignum.negative ? -1 : 1;
+}
+
+SchemeObject* integer_from_double(double value) {
+    if (value >= (double)SCHEME_FIXNUM_MIN && value <= (double)SCHEME_FIXNUM_MAX) {
+        return make_fixnum((intptr_t)value);
+    }
+
+    // value is mantissa * 2^exponent, with a 53-bit mantissa. The exponent
+    // is negative only where fixnums are narrower than doubles, and then
+    // the bits shifted out are zeros.
+    int exponent;
+    double fraction = frexp(fabs(value), &exponent);
+    uint64_t mantissa = (uint64_t)ldexp(fraction, 53);
+    exponent -= 53;
+    if (exponent < 0) {
+        mantissa >>= -exponent;
+        exponent = 0;
+    }
+
+    size_t offset = (size_t)exponent / DIGIT_BITS;
+    size_t length = offset + 3;
+    Digit* digits = allocate_digits(length);
+    memset(digits, 0, length * sizeof(Digit));
+    digits[offset] = (Digit)mantissa;
+    digits[offset + 1] = (Digit)(mantissa >> DIGIT_BITS);
+    shift_digits_left(digits + offset, digits + offset, 3, exponent % DIGIT_BITS);
+    return make_integer_from_digits(digits, length, value < 0);
+}
+
+// The top 64 bits of the magnitude, with a bit set below them if any bit
+// further down is, convert to the double the whole magnitude rounds to
+double bignum_to_double(const SchemeObject* obj) {
+    const Digit* digits = obj->value.bignum.digits;
+    size_t length = obj->value.bignum.length;
+    Digit d1 = digits[length - 1];
+    Digit d2 = length >= 2 ? digits[length - 2] : 0;
+    Digit d3 = length >= 3 ? digits[length - 3] : 0;
+    int shift = leading_zeros(d1);
+
+    uint64_t bits = (((uint64_t)d1 << DIGIT_BITS) | d2) << shift;
+    bool sticky;
+    if (shift) {
+        bits |= d3 >> (DIGIT_BITS - shift);
+        sticky = (d3 & ((1u << (DIGIT_BITS - shift)) - 1)) != 0;
+    } else {
+        sticky = d3 != 0;
+    }
+    for (size_t i = 0; !sticky && i + 3 < length; i++) {
+        sticky = digits[i] != 0;
+    }
+    if (sticky) {
+        bits |= 1;
+    }
+
+    int scale = DIGIT_BITS * ((int)length - 2) - shift;
+    double value = ldexp((double)bits, scale);
+    return obj->value.bignum.negative ? -value : value;
+}
+
+SchemeObject* parse_integer(const char* text) {
+    bool negative = *text == '-';
+    if (*text == '-' || *text == '+') {
+        text++;
+    }
+
+    // Nine decimal digits at a time, each chunk multiplying in 10^9 or less
+    size_t count = strlen(text);
+    Digit* digits = allocate_digits(count / 9 + 2);
+    size_t length = 0;
+    size_t chunk = count % 9 ? count % 9 : 9;
+    while (*text) {
+        Digit value = 0;
+        Digit scale = 1;
+        for (size_t i = 0; i < chunk; i++) {
+            value = value * 10 + (Digit)(*text++ - '0');
+            scale *= 10;
+        }
+        length = multiply_add_digit(digits, length, scale, value);
+        chunk = 9;
+    }
+    return make_integer_from_digits(digits, length, negative);
+}
+
+// Nine decimal digits at a time, least significant first, by repeated
+// division by 10^9
+char* integer_to_string(SchemeObject* a) {
+    if (is_fixnum(a)) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%lld", (long long)fixnum_value(a));
+        return scheme_strdup(buffer);
+    }
+
+    size_t length = a->value.bignum.length;
+    Digit* work = allocate_digits(length);
+    memcpy(work, a->value.bignum.digits, length * sizeof(Digit));
+    Digit* chunks = allocate_digits(length * 10 / 9 + 2);
+    size_t count = 0;
+    while (length > 0) {
+        chunks[count++] = divide_by_digit(work, work, length, 1000000000u);
+        length = trimmed_length(work, length);
+    }
+
+    char* text = (char*)scheme_malloc(count * 9 + 2);
+    char* end = text;
+    if (a->value.bignum.negative) {
+        *end++ = '-';
+    }
+    end += sprintf(end, "%u", (unsigned)chunks[count - 1]);
+    for (size_t i = count - 1; i-- > 0;) {
+        end += sprintf(end, "%09u", (unsigned)chunks[i]);
+    }
+    scheme_free(work);
+    scheme_free(chunks);
+    return text;
+}
+
+size_t free_bignum(SchemeBignum* bignum) {
+    size_t size = bignum->length * sizeof(Digit);
+    scheme_free(bignum->digits);
+    return size;
+}
@@ -1,5 +1,7 @@
 #include "rscheme.h"
 #include <ctype.h>
+#include <math.h>
+#include <time.h>
 
 void init_builtins(Environment* env) {
     // Arithmetic operations
@@ -13,6 +15,11 @@ void init_builtins(Environment* env) {
     define_variable(env, "abs", make_primitive(builtin_abs));
     define_variable(env, "max", make_primitive(builtin_max));
     define_variable(env, "min", make_primitive(builtin_min));
+    define_variable(env, "expt", make_primitive(builtin_expt));
+    define_variable(env, "exact?", make_primitive(builtin_exact_p));
+    define_variable(env, "inexact?", make_primitive(builtin_inexact_p));
+    define_variable(env, "exact->inexact", make_primitive(builtin_exact_to_inexact));
+    define_variable(env, "inexact->exact", make_primitive(builtin_inexact_to_exact));
     
     // Comparison operations
     define_variable(env, "=", make_primitive(builtin_num_eq));
@@ -48,6 +55,7 @@ void init_builtins(Environment* env) {
     define_variable(env, "display", make_primitive(builtin_display));
     define_variable(env, "newline", make_primitive(builtin_newline));
     define_variable(env, "write", make_primitive(builtin_write));
+    define_variable(env, "load", make_primitive(builtin_load));
     
     // String operations
     define_variable(env, "string-length", make_primitive(builtin_string_length));
@@ -70,123 +78,212 @@ void init_builtins(Environment* env) {
     
     // Logical operations
     define_variable(env, "not", make_primitive(builtin_not));
+    
+    // Time, for benchmarks
+    define_variable(env, "current-jiffy", make_primitive(builtin_current_jiffy));
+    define_variable(env, "jiffies-per-second", make_primitive(builtin_jiffies_per_second));
+    
+    // Multiple values
+    init_values(env);
+    
+    // Continuations and dynamic-wind
+    init_control(env);
 }
 
-int count_args(SchemeObject* args) {
-    int count = 0;
-    while (args && is_pair(args)) {
-        count++;
-        args = cdr(args);
-    }
-    return count;
-}
-
-SchemeObject* get_arg(SchemeObject* args, int index) {
-    for (int i = 0; i < index && args && is_pair(args); i++) {
-        args = cdr(args);
-    }
-    return args && is_pair(args) ? car(args) : NULL;
-}
+// Primitives receive their arguments as an array on the interpreter's
+// argument stack. The array is only valid for the duration of the call.
 
-bool check_arity(SchemeObject* args, int expected) {
-    return count_args(args) == expected;
-}
+// Arithmetic operations. Each operation first runs over leading fixnum
+// operands in integer arithmetic, keeping the running result inside the
+// fixnum range so it never needs boxing. An overflow or a bignum hands the
+// exact operands that follow to the exact arithmetic of bignum.h, and the
+// first flonum hands the rest to the double loop: results are exact until
+// a flonum takes part.
 
-bool check_min_arity(SchemeObject* args, int min) {
-    return count_args(args) >= min;
-}
+// fixnum_in_range and SMALL_FACTOR are in builtins.h, with the inline fast
+// paths the evaluators use for two-operand calls.
 
-// Arithmetic operations
-SchemeObject* builtin_add(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_add(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    double result = 0.0;
+    int i = 0;
+    intptr_t sum = 0;
+    while (i < argc && is_fixnum(argv[i]) && fixnum_in_range(sum)) {
+        sum += fixnum_value(argv[i++]);
+    }
+    if (i == argc && fixnum_in_range(sum)) {
+        return make_fixnum(sum);
+    }
     
-    while (args && is_pair(args)) {
-        SchemeObject* arg = car(args);
-        if (!is_number(arg)) {
+    SchemeObject* exact = make_integer(sum);
+    for (; i < argc && is_exact_integer(argv[i]); i++) {
+        exact = integer_add(exact, argv[i]);
+    }
+    if (i == argc) {
+        return exact;
+    }
+    
+    double result = number_value(exact);
+    
+    for (; i < argc; i++) {
+        if (!is_number(argv[i])) {
             runtime_error("+ expects numbers");
             return SCHEME_FALSE_OBJECT;
         }
-        result += arg->value.number_value;
-        args = cdr(args);
+        result += number_value(argv[i]);
     }
     
     return make_number(result);
 }
 
-SchemeObject* builtin_subtract(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_subtract(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_min_arity(args, 1)) {
+    if (argc < 1) {
         runtime_error("- expects at least 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* first = car(args);
+    SchemeObject* first = argv[0];
     if (!is_number(first)) {
         runtime_error("- expects numbers");
         return SCHEME_FALSE_OBJECT;
     }
     
-    double result = first->value.number_value;
-    args = cdr(args);
+    int i = 1;
+    
+    if (is_fixnum(first)) {
+        intptr_t difference = fixnum_value(first);
+        if (argc == 1) {
+            // Unary minus; the fixnum range is symmetric
+            return make_fixnum(-difference);
+        }
+        while (i < argc && is_fixnum(argv[i]) && fixnum_in_range(difference)) {
+            difference -= fixnum_value(argv[i++]);
+        }
+        if (i == argc && fixnum_in_range(difference)) {
+            return make_fixnum(difference);
+        }
+        first = make_integer(difference);
+    }
+    
+    if (is_exact_integer(first)) {
+        if (argc == 1) {
+            return integer_negate(first);
+        }
+        for (; i < argc && is_exact_integer(argv[i]); i++) {
+            first = integer_subtract(first, argv[i]);
+        }
+        if (i == argc) {
+            return first;
+        }
+    }
+    
+    double result = number_value(first);
     
-    if (!args || is_nil(args)) {
+    if (argc == 1) {
         // Unary minus
         return make_number(-result);
     }
     
-    while (args && is_pair(args)) {
-        SchemeObject* arg = car(args);
-        if (!is_number(arg)) {
+    for (; i < argc; i++) {
+        if (!is_number(argv[i])) {
             runtime_error("- expects numbers");
             return SCHEME_FALSE_OBJECT;
         }
-        result -= arg->value.number_value;
-        args = cdr(args);
+        result -= number_value(argv[i]);
     }
     
     return make_number(result);
 }
 
-SchemeObject* builtin_multiply(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_multiply(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    double result = 1.0;
+    int i = 0;
+    intptr_t product = 1;
+    while (i < argc && is_fixnum(argv[i])) {
+        intptr_t factor = fixnum_value(argv[i]);
+        if (product < -SMALL_FACTOR || product > SMALL_FACTOR ||
+            factor < -SMALL_FACTOR || factor > SMALL_FACTOR) {
+            break;
+        }
+        product *= factor;
+        i++;
+    }
+    if (i == argc) {
+        return make_fixnum(product);
+    }
+    
+    SchemeObject* exact = make_fixnum(product);
+    for (; i < argc && is_exact_integer(argv[i]); i++) {
+        exact = integer_multiply(exact, argv[i]);
+    }
+    if (i == argc) {
+        return exact;
+    }
+    
+    double result = number_value(exact);
     
-    while (args && is_pair(args)) {
-        SchemeObject* arg = car(args);
-        if (!is_number(arg)) {
+    for (; i < argc; i++) {
+        if (!is_number(argv[i])) {
             runtime_error("* expects numbers");
             return SCHEME_FALSE_OBJECT;
         }
-        result *= arg->value.number_value;
-        args = cdr(args);
+        result *= number_value(argv[i]);
     }
     
     return make_number(result);
 }
 
-SchemeObject* builtin_divide(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_divide(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_min_arity(args, 1)) {
+    if (argc < 1) {
         runtime_error("/ expects at least 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* first = car(args);
+    SchemeObject* first = argv[0];
     if (!is_number(first)) {
         runtime_error("/ expects numbers");
         return SCHEME_FALSE_OBJECT;
     }
     
-    double result = first->value.number_value;
-    args = cdr(args);
+    // Exact fixnum quotients stay fixnums
+    if (argc == 2 && is_fixnum(first) && is_fixnum(argv[1])) {
+        intptr_t dividend = fixnum_value(first);
+        intptr_t divisor = fixnum_value(argv[1]);
+        if (divisor != 0 && dividend % divisor == 0) {
+            return make_fixnum(dividend / divisor);
+        }
+    }
     
-    if (!args || is_nil(args)) {
-        // Reciprocal
+    // So do exact quotients of bignums. With no rationals, a quotient that
+    // is not an integer becomes a flonum.
+    int i = 1;
+    if (is_exact_integer(first)) {
+        for (; i < argc && is_exact_integer(argv[i]) && argv[i] != make_fixnum(0); i++) {
+            SchemeObject* quotient;
+            SchemeObject* remainder;
+            integer_divide(first, argv[i], &quotient, &remainder);
+            if (remainder != make_fixnum(0)) {
+                break;
+            }
+            first = quotient;
+        }
+        if (i == argc && argc > 1) {
+            return first;
+        }
+    }
+    
+    double result = number_value(first);
+    
+    if (argc == 1) {
+        // Reciprocal, exact only for 1 and -1
+        if (first == make_fixnum(1) || first == make_fixnum(-1)) {
+            return first;
+        }
         if (result == 0.0) {
             runtime_error("Division by zero");
             return SCHEME_FALSE_OBJECT;
@@ -194,137 +291,161 @@ SchemeObject* builtin_divide(SchemeObject* args, Environment* env) {
         return make_number(1.0 / result);
     }
     
-    while (args && is_pair(args)) {
-        SchemeObject* arg = car(args);
-        if (!is_number(arg)) {
+    for (; i < argc; i++) {
+        if (!is_number(argv[i])) {
             runtime_error("/ expects numbers");
             return SCHEME_FALSE_OBJECT;
         }
-        if (arg->value.number_value == 0.0) {
+        if (number_value(argv[i]) == 0.0) {
             runtime_error("Division by zero");
             return SCHEME_FALSE_OBJECT;
         }
-        result /= arg->value.number_value;
-        args = cdr(args);
+        result /= number_value(argv[i]);
     }
     
     return make_number(result);
 }
 
 // Comparison operations
-SchemeObject* builtin_num_eq(SchemeObject* args, Environment* env) {
+
+// The order of two numbers: -1, 0 or 1 as a is less than, equal to or
+// greater than b, or UNORDERED when either is a NaN. Exact integers are
+// compared exactly, with each other and with flonums.
+#define UNORDERED 2
+
+static int compare_numbers(SchemeObject* a, SchemeObject* b) {
+    if (is_fixnum(a) && is_fixnum(b)) {
+        return ((intptr_t)a > (intptr_t)b) - ((intptr_t)a < (intptr_t)b);
+    }
+    if (is_exact_integer(a)) {
+        if (is_exact_integer(b)) {
+            return integer_compare(a, b);
+        }
+        double y = number_value(b);
+        return isnan(y) ? UNORDERED : integer_compare_double(a, y);
+    }
+    double x = number_value(a);
+    if (is_exact_integer(b)) {
+        return isnan(x) ? UNORDERED : -integer_compare_double(b, x);
+    }
+    double y = number_value(b);
+    if (x < y) {
+        return -1;
+    }
+    if (x > y) {
+        return 1;
+    }
+    return x == y ? 0 : UNORDERED;
+}
+
+SchemeObject* builtin_num_eq(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (list_length(args) < 2) {
+    if (argc < 2) {
         runtime_error("= expects at least 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
     // Get first argument for comparison
-    SchemeObject* first = get_arg(args, 0);
+    SchemeObject* first = argv[0];
     if (!is_number(first)) {
         runtime_error("= expects numbers");
         return SCHEME_FALSE_OBJECT;
     }
     
     // Compare all arguments to the first
-    SchemeObject* current = cdr(args);
-    while (!is_null(current)) {
-        SchemeObject* arg = car(current);
+    for (int i = 1; i < argc; i++) {
+        SchemeObject* arg = argv[i];
         if (!is_number(arg)) {
             runtime_error("= expects numbers");
             return SCHEME_FALSE_OBJECT;
         }
-        if (first->value.number_value != arg->value.number_value) {
+        if (compare_numbers(first, arg) != 0) {
             return SCHEME_FALSE_OBJECT;
         }
-        current = cdr(current);
     }
     
     return SCHEME_TRUE_OBJECT;
 }
 
-SchemeObject* builtin_eq(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_eq(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 2)) {
+    if (argc != 2) {
         runtime_error("eq? expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* a = get_arg(args, 0);
-    SchemeObject* b = get_arg(args, 1);
+    SchemeObject* a = argv[0];
+    SchemeObject* b = argv[1];
     
     return make_boolean(scheme_eq(a, b));
 }
 
-SchemeObject* builtin_equal(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_equal(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 2)) {
+    if (argc != 2) {
         runtime_error("equal? expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* a = get_arg(args, 0);
-    SchemeObject* b = get_arg(args, 1);
+    SchemeObject* a = argv[0];
+    SchemeObject* b = argv[1];
     
     return make_boolean(scheme_equal(a, b));
 }
 
-SchemeObject* builtin_lt(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_lt(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (list_length(args) < 2) {
+    if (argc < 2) {
         runtime_error("< expects at least 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
     // Check that arguments are in ascending order
-    SchemeObject* current = args;
-    while (!is_null(cdr(current))) {
-        SchemeObject* a = car(current);
-        SchemeObject* b = car(cdr(current));
+    for (int i = 0; i + 1 < argc; i++) {
+        SchemeObject* a = argv[i];
+        SchemeObject* b = argv[i + 1];
         
         if (!is_number(a) || !is_number(b)) {
             runtime_error("< expects numbers");
             return SCHEME_FALSE_OBJECT;
         }
         
-        if (a->value.number_value >= b->value.number_value) {
+        if (compare_numbers(a, b) != -1) {
             return SCHEME_FALSE_OBJECT;
         }
-        
-        current = cdr(current);
     }
     
     return SCHEME_TRUE_OBJECT;
 }
 
 // List operations
-SchemeObject* builtin_cons(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_cons(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 2)) {
+    if (argc != 2) {
         runtime_error("cons expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* car_val = get_arg(args, 0);
-    SchemeObject* cdr_val = get_arg(args, 1);
+    SchemeObject* car_val = argv[0];
+    SchemeObject* cdr_val = argv[1];
     
     return cons(car_val, cdr_val);
 }
 
-SchemeObject* builtin_car(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_car(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("car expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* pair = get_arg(args, 0);
+    SchemeObject* pair = argv[0];
     if (!is_pair(pair)) {
         runtime_error("car expects a pair");
         return SCHEME_FALSE_OBJECT;
@@ -333,15 +454,15 @@ SchemeObject* builtin_car(SchemeObject* args, Environment* env) {
     return car(pair);
 }
 
-SchemeObject* builtin_cdr(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_cdr(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("cdr expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* pair = get_arg(args, 0);
+    SchemeObject* pair = argv[0];
     if (!is_pair(pair)) {
         runtime_error("cdr expects a pair");
         return SCHEME_FALSE_OBJECT;
@@ -350,58 +471,63 @@ SchemeObject* builtin_cdr(SchemeObject* args, Environment* env) {
     return cdr(pair);
 }
 
-SchemeObject* builtin_list(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_list(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
-    return args; // args is already a proper list
+    
+    SchemeObject* list = SCHEME_NIL_OBJECT;
+    for (int i = argc - 1; i >= 0; i--) {
+        list = cons(argv[i], list);
+    }
+    return list;
 }
 
 // Type predicates
-SchemeObject* builtin_null_p(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_null_p(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("null? expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
+    SchemeObject* obj = argv[0];
     return make_boolean(is_null(obj));
 }
 
-SchemeObject* builtin_pair_p(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_pair_p(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("pair? expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
+    SchemeObject* obj = argv[0];
     return make_boolean(is_pair(obj));
 }
 
-SchemeObject* builtin_number_p(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_number_p(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("number? expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
+    SchemeObject* obj = argv[0];
     return make_boolean(is_number(obj));
 }
 
 // I/O operations
-SchemeObject* builtin_display(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_display(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("display expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
+    SchemeObject* obj = argv[0];
     
     if (is_string(obj)) {
         printf("%s", obj->value.string_value);
@@ -412,302 +538,494 @@ SchemeObject* builtin_display(SchemeObject* args, Environment* env) {
     return SCHEME_NIL_OBJECT;
 }
 
-SchemeObject* builtin_newline(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_newline(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
-    (void)args; // Unused
+    (void)argc; (void)argv; // Unused
     
     printf("\n");
     return SCHEME_NIL_OBJECT;
 }
 
-SchemeObject* builtin_write(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_write(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("write expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
+    SchemeObject* obj = argv[0];
     print_object(obj, stdout);
     
     return SCHEME_NIL_OBJECT;
 }
 
-SchemeObject* builtin_not(SchemeObject* args, Environment* env) {
+// Evaluates the forms of a file in turn, at top level whatever the
+// environment of the call. A relative name is taken from the current
+// directory.
+SchemeObject* builtin_load(int argc, SchemeObject** argv, Environment* env) {
+    if (argc != 1 || !is_string(argv[0])) {
+        runtime_error("load expects a file name");
+        return SCHEME_FALSE_OBJECT;
+    }
+    
+    const char* name = argv[0]->value.string_value;
+    FILE* file = fopen(name, "rb");
+    if (!file) {
+        char message[256];
+        snprintf(message, sizeof(message), "load: cannot open file: %s", name);
+        set_eval_error(EVAL_ERROR_RUNTIME, message);
+        return NULL;
+    }
+    
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    
+    char* content = (char*)scheme_malloc(length + 1);
+    size_t bytes_read = fread(content, 1, length, file);
+    content[bytes_read] = '\0';
+    fclose(file);
+    
+    Environment* global = env;
+    while (global->parent) {
+        global = global->parent;
+    }
+    
+    // An error in a form unwinds through here, to free the text and parser
+    Parser* parser = create_parser(content);
+    CatchFrame catcher;
+    push_catch(&catcher);
+    if (setjmp(catcher.jump)) {
+        destroy_parser(parser);
+        scheme_free(content);
+        throw_error();
+        return NULL;
+    }
+    
+    SchemeObject* expr;
+    while ((expr = parse_expression(parser)) != NULL) {
+        eval_form(expr, global);
+    }
+    pop_catch(&catcher);
+    
+    bool failed = has_parse_error(parser);
+    destroy_parser(parser);
+    scheme_free(content);
+    if (failed) {
+        char message[256];
+        snprintf(message, sizeof(message), "load: cannot parse file: %s", name);
+        set_eval_error(EVAL_ERROR_RUNTIME, message);
+        return NULL;
+    }
+    return SCHEME_NIL_OBJECT;
+}
+
+SchemeObject* builtin_not(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("not expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
+    SchemeObject* obj = argv[0];
     
     // In Scheme, only #f is false
-    bool is_false = (obj == SCHEME_FALSE_OBJECT) || 
-                   (is_boolean(obj) && !obj->value.boolean_value);
+    return make_boolean(obj == SCHEME_FALSE_OBJECT);
+}
+
+// Time. A jiffy is a microsecond of wall-clock time.
+SchemeObject* builtin_current_jiffy(int argc, SchemeObject** argv, Environment* env) {
+    (void)argv; (void)env; // Unused
+    
+    if (argc != 0) {
+        runtime_error("current-jiffy expects no arguments");
+        return SCHEME_FALSE_OBJECT;
+    }
+    
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return integer_from_double((double)now.tv_sec * 1e6 + (double)(now.tv_nsec / 1000));
+}
+
+SchemeObject* builtin_jiffies_per_second(int argc, SchemeObject** argv, Environment* env) {
+    (void)argv; (void)env; // Unused
+    
+    if (argc != 0) {
+        runtime_error("jiffies-per-second expects no arguments");
+        return SCHEME_FALSE_OBJECT;
+    }
     
-    return make_boolean(is_false);
+    return make_fixnum(1000000);
 }
 
 // Stub implementations for missing functions
-SchemeObject* builtin_modulo(SchemeObject* args, Environment* env) {
+
+// Integer operand of quotient, remainder and modulo: flonums are truncated.
+// NULL for an infinity or a NaN.
+static SchemeObject* integer_operand(SchemeObject* obj) {
+    if (is_exact_integer(obj)) {
+        return obj;
+    }
+    double value = number_value(obj);
+    return isfinite(value) ? integer_from_double(trunc(value)) : NULL;
+}
+
+// Their result is inexact if either operand is
+static SchemeObject* integer_result(SchemeObject* result, SchemeObject* first, SchemeObject* second) {
+    return is_flonum(first) || is_flonum(second) ? make_number(number_value(result)) : result;
+}
+
+SchemeObject* builtin_modulo(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
-    if (count_args(args) != 2) {
+    if (argc != 2) {
         runtime_error("modulo expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* first = car(args);
-    SchemeObject* second = car(cdr(args));
+    SchemeObject* first = argv[0];
+    SchemeObject* second = argv[1];
     
     if (!is_number(first) || !is_number(second)) {
         runtime_error("modulo expects numbers");
         return SCHEME_FALSE_OBJECT;
     }
     
-    int a = (int)first->value.number_value;
-    int b = (int)second->value.number_value;
+    SchemeObject* a = integer_operand(first);
+    SchemeObject* b = integer_operand(second);
     
-    if (b == 0) {
+    if (!a || !b) {
+        runtime_error("modulo expects finite numbers");
+        return SCHEME_FALSE_OBJECT;
+    }
+    if (b == make_fixnum(0)) {
         runtime_error("modulo: division by zero");
         return SCHEME_FALSE_OBJECT;
     }
     
-    int result = a % b;
+    SchemeObject* result;
+    integer_divide(a, b, NULL, &result);
     // Ensure result has same sign as divisor (b)
-    if ((result > 0 && b < 0) || (result < 0 && b > 0)) {
-        result += b;
+    if (integer_sign(result) * integer_sign(b) < 0) {
+        result = integer_add(result, b);
     }
     
-    return make_number((double)result);
+    return integer_result(result, first, second);
 }
 
-SchemeObject* builtin_quotient(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_quotient(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
-    if (count_args(args) != 2) {
+    if (argc != 2) {
         runtime_error("quotient expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* first = car(args);
-    SchemeObject* second = car(cdr(args));
+    SchemeObject* first = argv[0];
+    SchemeObject* second = argv[1];
     
     if (!is_number(first) || !is_number(second)) {
         runtime_error("quotient expects numbers");
         return SCHEME_FALSE_OBJECT;
     }
     
-    int a = (int)first->value.number_value;
-    int b = (int)second->value.number_value;
+    SchemeObject* a = integer_operand(first);
+    SchemeObject* b = integer_operand(second);
     
-    if (b == 0) {
+    if (!a || !b) {
+        runtime_error("quotient expects finite numbers");
+        return SCHEME_FALSE_OBJECT;
+    }
+    if (b == make_fixnum(0)) {
         runtime_error("quotient: division by zero");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_number((double)(a / b));
+    SchemeObject* result;
+    integer_divide(a, b, &result, NULL);
+    return integer_result(result, first, second);
 }
 
-SchemeObject* builtin_remainder(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_remainder(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
-    if (count_args(args) != 2) {
+    if (argc != 2) {
         runtime_error("remainder expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* first = car(args);
-    SchemeObject* second = car(cdr(args));
+    SchemeObject* first = argv[0];
+    SchemeObject* second = argv[1];
     
     if (!is_number(first) || !is_number(second)) {
         runtime_error("remainder expects numbers");
         return SCHEME_FALSE_OBJECT;
     }
     
-    int a = (int)first->value.number_value;
-    int b = (int)second->value.number_value;
+    SchemeObject* a = integer_operand(first);
+    SchemeObject* b = integer_operand(second);
     
-    if (b == 0) {
+    if (!a || !b) {
+        runtime_error("remainder expects finite numbers");
+        return SCHEME_FALSE_OBJECT;
+    }
+    if (b == make_fixnum(0)) {
         runtime_error("remainder: division by zero");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_number((double)(a % b));
+    SchemeObject* result;
+    integer_divide(a, b, NULL, &result);
+    return integer_result(result, first, second);
 }
 
-SchemeObject* builtin_abs(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_abs(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
-    if (count_args(args) != 1) {
+    if (argc != 1) {
         runtime_error("abs expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* arg = car(args);
+    SchemeObject* arg = argv[0];
     if (!is_number(arg)) {
         runtime_error("abs expects a number");
         return SCHEME_FALSE_OBJECT;
     }
     
-    double value = arg->value.number_value;
+    if (is_exact_integer(arg)) {
+        return integer_sign(arg) < 0 ? integer_negate(arg) : arg;
+    }
+    
+    double value = number_value(arg);
     return make_number(value < 0 ? -value : value);
 }
 
-SchemeObject* builtin_max(SchemeObject* args, Environment* env) {
+// The result of max and min is inexact if any argument is
+SchemeObject* builtin_max(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
-    if (is_nil(args)) {
+    if (argc < 1) {
         runtime_error("max expects at least 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    double max_val = car(args)->value.number_value;
-    args = cdr(args);
+    if (!is_number(argv[0])) {
+        runtime_error("max expects numbers");
+        return SCHEME_FALSE_OBJECT;
+    }
+    
+    SchemeObject* max_val = argv[0];
+    bool inexact = is_flonum(max_val);
     
-    while (!is_nil(args)) {
-        if (!is_number(car(args))) {
+    for (int i = 1; i < argc; i++) {
+        if (!is_number(argv[i])) {
             runtime_error("max expects numbers");
             return SCHEME_FALSE_OBJECT;
         }
-        double val = car(args)->value.number_value;
-        if (val > max_val) {
-            max_val = val;
+        inexact = inexact || is_flonum(argv[i]);
+        if (compare_numbers(argv[i], max_val) == 1) {
+            max_val = argv[i];
         }
-        args = cdr(args);
     }
     
-    return make_number(max_val);
+    return inexact ? make_number(number_value(max_val)) : max_val;
 }
 
-SchemeObject* builtin_min(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_min(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
-    if (is_nil(args)) {
+    if (argc < 1) {
         runtime_error("min expects at least 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    double min_val = car(args)->value.number_value;
-    args = cdr(args);
+    if (!is_number(argv[0])) {
+        runtime_error("min expects numbers");
+        return SCHEME_FALSE_OBJECT;
+    }
+    
+    SchemeObject* min_val = argv[0];
+    bool inexact = is_flonum(min_val);
     
-    while (!is_nil(args)) {
-        if (!is_number(car(args))) {
+    for (int i = 1; i < argc; i++) {
+        if (!is_number(argv[i])) {
             runtime_error("min expects numbers");
             return SCHEME_FALSE_OBJECT;
         }
-        double val = car(args)->value.number_value;
-        if (val < min_val) {
-            min_val = val;
+        inexact = inexact || is_flonum(argv[i]);
+        if (compare_numbers(argv[i], min_val) == -1) {
+            min_val = argv[i];
         }
-        args = cdr(args);
     }
     
-    return make_number(min_val);
+    return inexact ? make_number(number_value(min_val)) : min_val;
 }
 
-SchemeObject* builtin_eqv(SchemeObject* args, Environment* env) {
-    (void)args; (void)env;
+// Exact integers raised to exact non-negative powers stay exact; the rest
+// are computed in doubles
+SchemeObject* builtin_expt(int argc, SchemeObject** argv, Environment* env) {
+    (void)env;
+    if (argc != 2) {
+        runtime_error("expt expects 2 arguments");
+        return SCHEME_FALSE_OBJECT;
+    }
+    
+    SchemeObject* base = argv[0];
+    SchemeObject* exponent = argv[1];
+    
+    if (!is_number(base) || !is_number(exponent)) {
+        runtime_error("expt expects numbers");
+        return SCHEME_FALSE_OBJECT;
+    }
+    
+    if (is_exact_integer(base) && is_fixnum(exponent) && fixnum_value(exponent) >= 0) {
+        return integer_expt(base, (uint64_t)fixnum_value(exponent));
+    }
+    
+    return make_number(pow(number_value(base), number_value(exponent)));
+}
+
+SchemeObject* builtin_exact_p(int argc, SchemeObject** argv, Environment* env) {
+    (void)env;
+    if (argc != 1 || !is_number(argv[0])) {
+        runtime_error("exact? expects a number");
+        return SCHEME_FALSE_OBJECT;
+    }
+    return make_boolean(is_exact_integer(argv[0]));
+}
+
+SchemeObject* builtin_inexact_p(int argc, SchemeObject** argv, Environment* env) {
+    (void)env;
+    if (argc != 1 || !is_number(argv[0])) {
+        runtime_error("inexact? expects a number");
+        return SCHEME_FALSE_OBJECT;
+    }
+    return make_boolean(is_flonum(argv[0]));
+}
+
+SchemeObject* builtin_exact_to_inexact(int argc, SchemeObject** argv, Environment* env) {
+    (void)env;
+    if (argc != 1 || !is_number(argv[0])) {
+        runtime_error("exact->inexact expects a number");
+        return SCHEME_FALSE_OBJECT;
+    }
+    return is_flonum(argv[0]) ? argv[0] : make_number(number_value(argv[0]));
+}
+
+// Exact integers are the only exact numbers, so a flonum with a fraction
+// has no exact equivalent
+SchemeObject* builtin_inexact_to_exact(int argc, SchemeObject** argv, Environment* env) {
+    (void)env;
+    if (argc != 1 || !is_number(argv[0])) {
+        runtime_error("inexact->exact expects a number");
+        return SCHEME_FALSE_OBJECT;
+    }
+    if (!is_flonum(argv[0])) {
+        return argv[0];
+    }
+    double value = number_value(argv[0]);
+    if (!isfinite(value) || trunc(value) != value) {
+        runtime_error("inexact->exact: no exact integer equals the number");
+        return SCHEME_FALSE_OBJECT;
+    }
+    return integer_from_double(value);
+}
+
+SchemeObject* builtin_eqv(int argc, SchemeObject** argv, Environment* env) {
+    (void)argc; (void)argv; (void)env;
     runtime_error("eqv? not implemented yet");
     return SCHEME_FALSE_OBJECT;
 }
 
-SchemeObject* builtin_gt(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_gt(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (list_length(args) < 2) {
+    if (argc < 2) {
         runtime_error("> expects at least 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
     // Check that arguments are in descending order
-    SchemeObject* current = args;
-    while (!is_null(cdr(current))) {
-        SchemeObject* a = car(current);
-        SchemeObject* b = car(cdr(current));
+    for (int i = 0; i + 1 < argc; i++) {
+        SchemeObject* a = argv[i];
+        SchemeObject* b = argv[i + 1];
         
         if (!is_number(a) || !is_number(b)) {
             runtime_error("> expects numbers");
             return SCHEME_FALSE_OBJECT;
         }
         
-        if (a->value.number_value <= b->value.number_value) {
+        if (compare_numbers(a, b) != 1) {
             return SCHEME_FALSE_OBJECT;
         }
-        
-        current = cdr(current);
     }
     
     return SCHEME_TRUE_OBJECT;
 }
 
-SchemeObject* builtin_le(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_le(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (list_length(args) < 2) {
+    if (argc < 2) {
         runtime_error("<= expects at least 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
     // Check that arguments are in non-descending order
-    SchemeObject* current = args;
-    while (!is_null(cdr(current))) {
-        SchemeObject* a = car(current);
-        SchemeObject* b = car(cdr(current));
+    for (int i = 0; i + 1 < argc; i++) {
+        SchemeObject* a = argv[i];
+        SchemeObject* b = argv[i + 1];
         
         if (!is_number(a) || !is_number(b)) {
             runtime_error("<= expects numbers");
             return SCHEME_FALSE_OBJECT;
         }
         
-        if (a->value.number_value > b->value.number_value) {
+        int order = compare_numbers(a, b);
+        if (order != -1 && order != 0) {
             return SCHEME_FALSE_OBJECT;
         }
-        
-        current = cdr(current);
     }
     
     return SCHEME_TRUE_OBJECT;
 }
 
-SchemeObject* builtin_ge(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_ge(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (list_length(args) < 2) {
+    if (argc < 2) {
         runtime_error(">= expects at least 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
     // Check that arguments are in non-ascending order
-    SchemeObject* current = args;
-    while (!is_null(cdr(current))) {
-        SchemeObject* a = car(current);
-        SchemeObject* b = car(cdr(current));
+    for (int i = 0; i + 1 < argc; i++) {
+        SchemeObject* a = argv[i];
+        SchemeObject* b = argv[i + 1];
         
         if (!is_number(a) || !is_number(b)) {
             runtime_error(">= expects numbers");
             return SCHEME_FALSE_OBJECT;
         }
         
-        if (a->value.number_value < b->value.number_value) {
+        int order = compare_numbers(a, b);
+        if (order != 1 && order != 0) {
             return SCHEME_FALSE_OBJECT;
         }
-        
-        current = cdr(current);
     }
     
     return SCHEME_TRUE_OBJECT;
 }
 
-SchemeObject* builtin_length(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_length(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("length expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
+    SchemeObject* obj = argv[0];
     
     if (is_null(obj)) {
-        return make_number(0);
+        return make_fixnum(0);
     }
     
     if (!is_pair(obj)) {
@@ -716,45 +1034,57 @@ SchemeObject* builtin_length(SchemeObject* args, Environment* env) {
     }
     
     int length = list_length(obj);
-    return make_number((double)length);
+    return make_fixnum(length);
 }
 
-SchemeObject* builtin_append(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_append(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (is_null(args)) {
+    if (argc == 0) {
         return SCHEME_NIL_OBJECT;
     }
     
-    if (is_null(cdr(args))) {
-        return car(args);
-    }
-    
-    // Recursive implementation: append first list to result of appending rest
-    SchemeObject* first = car(args);
-    SchemeObject* rest = builtin_append(cdr(args), env);
-    
-    if (is_null(first)) {
-        return rest;
+    // Copy every list but the last onto a growing tail; the last argument is
+    // shared, as R5RS requires
+    SchemeObject* result = SCHEME_NIL_OBJECT;
+    SchemeObject* tail = NULL;
+    
+    for (int i = 0; i < argc - 1; i++) {
+        SchemeObject* list = argv[i];
+        while (!is_null(list)) {
+            if (!is_pair(list)) {
+                runtime_error("append expects lists");
+                return SCHEME_FALSE_OBJECT;
+            }
+            
+            SchemePair* cell = pair_cell(list);
+            SchemeObject* copy = make_pair(cell->car, SCHEME_NIL_OBJECT);
+            if (tail) {
+                set_cdr(tail, copy);
+            } else {
+                result = copy;
+            }
+            tail = copy;
+            list = cell->cdr;
+        }
     }
     
-    if (!is_pair(first)) {
-        runtime_error("append expects lists");
-        return SCHEME_FALSE_OBJECT;
+    if (tail) {
+        set_cdr(tail, argv[argc - 1]);
+        return result;
     }
-    
-    return make_pair(car(first), builtin_append(make_pair(cdr(first), make_pair(rest, SCHEME_NIL_OBJECT)), env));
+    return argv[argc - 1];
 }
 
-SchemeObject* builtin_reverse(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_reverse(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("reverse expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* list = get_arg(args, 0);
+    SchemeObject* list = argv[0];
     
     if (is_null(list)) {
         return SCHEME_NIL_OBJECT;
@@ -773,30 +1103,31 @@ SchemeObject* builtin_reverse(SchemeObject* args, Environment* env) {
             runtime_error("reverse expects a proper list");
             return SCHEME_FALSE_OBJECT;
         }
-        result = make_pair(car(current), result);
-        current = cdr(current);
+        SchemePair* cell = pair_cell(current);
+        result = make_pair(cell->car, result);
+        current = cell->cdr;
     }
     
     return result;
 }
 
-SchemeObject* builtin_list_ref(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_list_ref(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 2)) {
+    if (argc != 2) {
         runtime_error("list-ref expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* list = get_arg(args, 0);
-    SchemeObject* index_obj = get_arg(args, 1);
+    SchemeObject* list = argv[0];
+    SchemeObject* index_obj = argv[1];
     
     if (!is_number(index_obj)) {
         runtime_error("list-ref expects a number as second argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    int index = (int)index_obj->value.number_value;
+    int index = (int)number_value(index_obj);
     if (index < 0) {
         runtime_error("list-ref index must be non-negative");
         return SCHEME_FALSE_OBJECT;
@@ -819,88 +1150,88 @@ SchemeObject* builtin_list_ref(SchemeObject* args, Environment* env) {
     return car(current);
 }
 
-SchemeObject* builtin_list_p(SchemeObject* args, Environment* env) {
-    (void)args; (void)env;
+SchemeObject* builtin_list_p(int argc, SchemeObject** argv, Environment* env) {
+    (void)argc; (void)argv; (void)env;
     runtime_error("list? not implemented yet");
     return SCHEME_FALSE_OBJECT;
 }
 
-SchemeObject* builtin_string_p(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_string_p(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("string? expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
+    SchemeObject* obj = argv[0];
     return make_boolean(is_string(obj));
 }
 
-SchemeObject* builtin_symbol_p(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_symbol_p(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("symbol? expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
+    SchemeObject* obj = argv[0];
     return make_boolean(is_symbol(obj));
 }
 
-SchemeObject* builtin_boolean_p(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_boolean_p(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("boolean? expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
+    SchemeObject* obj = argv[0];
     return make_boolean(is_boolean(obj));
 }
 
-SchemeObject* builtin_procedure_p(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_procedure_p(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("procedure? expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
-    return make_boolean(is_procedure(obj) || is_primitive(obj));
+    SchemeObject* obj = argv[0];
+    return make_boolean(is_procedure(obj) || is_primitive(obj) || is_continuation(obj));
 }
 
 // String operations
-SchemeObject* builtin_string_length(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_string_length(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("string-length expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* obj = get_arg(args, 0);
+    SchemeObject* obj = argv[0];
     if (!is_string(obj)) {
         runtime_error("string-length expects a string");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_number((double)strlen(obj->value.string_value));
+    return make_integer((intptr_t)strlen(obj->value.string_value));
 }
 
-SchemeObject* builtin_string_ref(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_string_ref(int argc, SchemeObject** argv, Environment* env) {
     (void)env; // Unused
     
-    if (!check_arity(args, 2)) {
+    if (argc != 2) {
         runtime_error("string-ref expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* str = get_arg(args, 0);
-    SchemeObject* index_obj = get_arg(args, 1);
+    SchemeObject* str = argv[0];
+    SchemeObject* index_obj = argv[1];
     
     if (!is_string(str)) {
         runtime_error("string-ref expects a string as first argument");
@@ -912,7 +1243,7 @@ SchemeObject* builtin_string_ref(SchemeObject* args, Environment* env) {
         return SCHEME_FALSE_OBJECT;
     }
     
-    int index = (int)index_obj->value.number_value;
+    int index = (int)number_value(index_obj);
     int len = strlen(str->value.string_value);
     
     if (index < 0 || index >= len) {
@@ -924,229 +1255,229 @@ SchemeObject* builtin_string_ref(SchemeObject* args, Environment* env) {
 }
 
 // Character predicates and operations
-SchemeObject* builtin_char_p(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_p(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("char? expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_boolean(is_char(get_arg(args, 0)));
+    return make_boolean(is_char(argv[0]));
 }
 
-SchemeObject* builtin_char_eq(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_eq(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 2)) {
+    if (argc != 2) {
         runtime_error("char=? expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* c1 = get_arg(args, 0);
-    SchemeObject* c2 = get_arg(args, 1);
+    SchemeObject* c1 = argv[0];
+    SchemeObject* c2 = argv[1];
     
     if (!is_char(c1) || !is_char(c2)) {
         runtime_error("char=? expects character arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_boolean(c1->value.char_value == c2->value.char_value);
+    return make_boolean(char_value(c1) == char_value(c2));
 }
 
-SchemeObject* builtin_char_lt(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_lt(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 2)) {
+    if (argc != 2) {
         runtime_error("char<? expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* c1 = get_arg(args, 0);
-    SchemeObject* c2 = get_arg(args, 1);
+    SchemeObject* c1 = argv[0];
+    SchemeObject* c2 = argv[1];
     
     if (!is_char(c1) || !is_char(c2)) {
         runtime_error("char<? expects character arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_boolean(c1->value.char_value < c2->value.char_value);
+    return make_boolean(char_value(c1) < char_value(c2));
 }
 
-SchemeObject* builtin_char_gt(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_gt(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 2)) {
+    if (argc != 2) {
         runtime_error("char>? expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* c1 = get_arg(args, 0);
-    SchemeObject* c2 = get_arg(args, 1);
+    SchemeObject* c1 = argv[0];
+    SchemeObject* c2 = argv[1];
     
     if (!is_char(c1) || !is_char(c2)) {
         runtime_error("char>? expects character arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_boolean(c1->value.char_value > c2->value.char_value);
+    return make_boolean(char_value(c1) > char_value(c2));
 }
 
-SchemeObject* builtin_char_le(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_le(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 2)) {
+    if (argc != 2) {
         runtime_error("char<=? expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* c1 = get_arg(args, 0);
-    SchemeObject* c2 = get_arg(args, 1);
+    SchemeObject* c1 = argv[0];
+    SchemeObject* c2 = argv[1];
     
     if (!is_char(c1) || !is_char(c2)) {
         runtime_error("char<=? expects character arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_boolean(c1->value.char_value <= c2->value.char_value);
+    return make_boolean(char_value(c1) <= char_value(c2));
 }
 
-SchemeObject* builtin_char_ge(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_ge(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 2)) {
+    if (argc != 2) {
         runtime_error("char>=? expects 2 arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* c1 = get_arg(args, 0);
-    SchemeObject* c2 = get_arg(args, 1);
+    SchemeObject* c1 = argv[0];
+    SchemeObject* c2 = argv[1];
     
     if (!is_char(c1) || !is_char(c2)) {
         runtime_error("char>=? expects character arguments");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_boolean(c1->value.char_value >= c2->value.char_value);
+    return make_boolean(char_value(c1) >= char_value(c2));
 }
 
-SchemeObject* builtin_char_alphabetic(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_alphabetic(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("char-alphabetic? expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* c = get_arg(args, 0);
+    SchemeObject* c = argv[0];
     if (!is_char(c)) {
         runtime_error("char-alphabetic? expects a character");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_boolean(isalpha(c->value.char_value));
+    return make_boolean(isalpha(char_value(c)));
 }
 
-SchemeObject* builtin_char_numeric(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_numeric(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("char-numeric? expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* c = get_arg(args, 0);
+    SchemeObject* c = argv[0];
     if (!is_char(c)) {
         runtime_error("char-numeric? expects a character");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_boolean(isdigit(c->value.char_value));
+    return make_boolean(isdigit(char_value(c)));
 }
 
-SchemeObject* builtin_char_whitespace(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_whitespace(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("char-whitespace? expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* c = get_arg(args, 0);
+    SchemeObject* c = argv[0];
     if (!is_char(c)) {
         runtime_error("char-whitespace? expects a character");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_boolean(isspace(c->value.char_value));
+    return make_boolean(isspace(char_value(c)));
 }
 
-SchemeObject* builtin_char_upcase(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_upcase(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("char-upcase expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* c = get_arg(args, 0);
+    SchemeObject* c = argv[0];
     if (!is_char(c)) {
         runtime_error("char-upcase expects a character");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_char(toupper(c->value.char_value));
+    return make_char(toupper(char_value(c)));
 }
 
-SchemeObject* builtin_char_downcase(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_downcase(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("char-downcase expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* c = get_arg(args, 0);
+    SchemeObject* c = argv[0];
     if (!is_char(c)) {
         runtime_error("char-downcase expects a character");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_char(tolower(c->value.char_value));
+    return make_char(tolower(char_value(c)));
 }
 
-SchemeObject* builtin_char_to_integer(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_char_to_integer(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("char->integer expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* c = get_arg(args, 0);
+    SchemeObject* c = argv[0];
     if (!is_char(c)) {
         runtime_error("char->integer expects a character");
         return SCHEME_FALSE_OBJECT;
     }
     
-    return make_number((double)(unsigned char)c->value.char_value);
+    return make_fixnum((unsigned char)char_value(c));
 }
 
-SchemeObject* builtin_integer_to_char(SchemeObject* args, Environment* env) {
+SchemeObject* builtin_integer_to_char(int argc, SchemeObject** argv, Environment* env) {
     (void)env;
     
-    if (!check_arity(args, 1)) {
+    if (argc != 1) {
         runtime_error("integer->char expects 1 argument");
         return SCHEME_FALSE_OBJECT;
     }
     
-    SchemeObject* n = get_arg(args, 0);
+    SchemeObject* n = argv[0];
     if (!is_number(n)) {
         runtime_error("integer->char expects a number");
         return SCHEME_FALSE_OBJECT;
     }
     
-    int val = (int)n->value.number_value;
+    int val = (int)number_value(n);
     if (val < 0 || val > 255) {
         runtime_error("integer->char: value out of character range");
         return SCHEME_FALSE_OBJECT;
@@ -0,0 +1,793 @@
+#include "rscheme.h"
+
+// Compiles resolved expressions into bytecode. A procedure body is first
+// compiled with its locals, and those of every let inside it, in stack
+// slots of the VM frame. Anything that could capture or name those locals
+// (a lambda, or a form left to eval_expression) makes that impossible, and
+// so does assigning one: a continuation may resume copies of a frame more
+// than once, and each variable must stay one location. The body is then
+// compiled again keeping its locals in environment frames laid out exactly
+// as the tree-walker lays them out.
+
+typedef struct {
+    SchemeObject* object;          // The bytecode object being filled
+    Bytecode* bc;
+    bool heap_frames;
+    bool needs_heap;               // A flat compile met a capturing form
+    int* scope_bases;              // Flat: first stack slot of each scope
+    int scope_count;
+    int scope_capacity;
+    int depth;                     // Operand stack depth at this point
+    int last_op;                   // Where the last instruction starts
+    int last_label;                // Where the last jump target is
+} Compiler;
+
+#define OPCODE_NAME(op, operands) #op,
+const char* const opcode_names[OPCODE_COUNT] = {
+    BYTECODE_OPCODES(OPCODE_NAME)
+};
+#undef OPCODE_NAME
+
+#define OPCODE_OPERANDS(op, operands) operands,
+const int opcode_operands[OPCODE_COUNT] = {
+    BYTECODE_OPCODES(OPCODE_OPERANDS)
+};
+#undef OPCODE_OPERANDS
+
+// Storage
+
+void mark_bytecode_children(Bytecode* bc) {
+    mark_object(bc->source);
+    mark_object(bc->params);
+    mark_object(bc->layout);
+    mark_object(bc->body);
+    for (int i = 0; i < bc->constant_count; i++) {
+        mark_object(bc->constants[i]);
+    }
+    for (int i = 0; i < bc->local_count; i++) {
+        mark_object(bc->local_names[i]);
+    }
+}
+
+size_t free_bytecode(Bytecode* bc) {
+    size_t freed = sizeof(Bytecode);
+    freed += (size_t)bc->code_capacity * sizeof(int32_t);
+    freed += (size_t)bc->constant_capacity * sizeof(SchemeObject*);
+    freed += (size_t)bc->local_count * sizeof(SchemeObject*);
+    freed += bc->threaded ? (size_t)bc->code_length * sizeof(ThreadedWord) : 0;
+    scheme_free(bc->code);
+    scheme_free(bc->threaded);
+    scheme_free(bc->constants);
+    scheme_free(bc->local_names);
+    scheme_free(bc);
+    return freed;
+}
+
+// Forget everything a failed flat compile produced
+static void reset_bytecode(Bytecode* bc) {
+    bc->code_length = 0;
+    bc->constant_count = 0;
+    bc->local_count = 0;
+    bc->max_stack = 0;
+}
+
+// Emission
+
+static void emit(Compiler* c, int32_t word) {
+    Bytecode* bc = c->bc;
+    if (bc->code_length == bc->code_capacity) {
+        bc->code_capacity = bc->code_capacity ? bc->code_capacity * 2 : 32;
+        bc->code = (int32_t*)scheme_realloc(bc->code, (size_t)bc->code_capacity * sizeof(int32_t));
+    }
+    bc->code[bc->code_length++] = word;
+}
+
+static void emit_op(Compiler* c, Opcode op) {
+    c->last_op = c->bc->code_length;
+    emit(c, op);
+}
+
+static void emit1(Compiler* c, Opcode op, int32_t operand) {
+    emit_op(c, op);
+    emit(c, operand);
+}
+
+static void emit2(Compiler* c, Opcode op, int32_t first, int32_t second) {
+    emit_op(c, op);
+    emit(c, first);
+    emit(c, second);
+}
+
+static void emit3(Compiler* c, Opcode op, int32_t first, int32_t second, int32_t third) {
+    emit_op(c, op);
+    emit(c, first);
+    emit(c, second);
+    emit(c, third);
+}
+
+static int add_constant(Compiler* c, SchemeObject* value) {
+    Bytecode* bc = c->bc;
+    for (int i = 0; i < bc->constant_count; i++) {
+        if (bc->constants[i] == value) {
+            return i;
+        }
+    }
+    if (bc->constant_count == bc->constant_capacity) {
+        bc->constant_capacity = bc->constant_capacity ? bc->constant_capacity * 2 : 8;
+        bc->constants = (SchemeObject**)scheme_realloc(bc->constants,
+                                                       (size_t)bc->constant_capacity * sizeof(SchemeObject*));
+    }
+    gc_write_barrier(c->object, value);
+    bc->constants[bc->constant_count] = value;
+    return bc->constant_count++;
+}
+
+static void adjust_depth(Compiler* c, int delta) {
+    c->depth += delta;
+    if (c->depth > c->bc->max_stack) {
+        c->bc->max_stack = c->depth;
+    }
+}
+
+static void emit_constant(Compiler* c, SchemeObject* value) {
+    emit1(c, OP_CONST, add_constant(c, value));
+    adjust_depth(c, 1);
+}
+
+// A call directly followed by OP_JUMP_IF_FALSE becomes compare-and-branch
+static void fuse_branch(Compiler* c) {
+    int32_t* op = &c->bc->code[c->last_op];
+    if (*op == OP_CALL) {
+        *op = OP_CALL_JUMP_IF_FALSE;
+    } else if (*op == OP_CALL_LOCAL_CONST) {
+        *op = OP_BRANCH_LOCAL_CONST;
+    } else if (*op == OP_CALL_LOCAL_LOCAL) {
+        *op = OP_BRANCH_LOCAL_LOCAL;
+    } else if (*op >= OP_NUM_EQ && *op <= OP_GE) {
+        *op += OP_BRANCH_NUM_EQ - OP_NUM_EQ;
+    }
+}
+
+// Forward jumps to the same place are chained through their operands until
+// the target is known
+static void emit_jump(Compiler* c, Opcode op, int* chain) {
+    if (op == OP_JUMP_IF_FALSE && c->last_op >= 0) {
+        fuse_branch(c);
+    }
+    emit1(c, op, *chain);
+    *chain = c->bc->code_length - 1;
+}
+
+static void patch_jumps(Compiler* c, int chain) {
+    if (chain >= 0) {
+        c->last_label = c->bc->code_length;
+    }
+    while (chain >= 0) {
+        int next = c->bc->code[chain];
+        c->bc->code[chain] = c->bc->code_length;
+        chain = next;
+    }
+}
+
+// Flat scopes
+
+static int reserve_locals(Compiler* c, SchemeObject* layout) {
+    Bytecode* bc = c->bc;
+    int base = bc->local_count;
+    int count = (int)layout->value.vector.length;
+    if (count > 0) {
+        bc->local_names = (SchemeObject**)scheme_realloc(bc->local_names,
+                                                         (size_t)(base + count) * sizeof(SchemeObject*));
+        for (int i = 0; i < count; i++) {
+            bc->local_names[base + i] = layout->value.vector.elements[i];
+        }
+        bc->local_count = base + count;
+    }
+    return base;
+}
+
+static void push_scope(Compiler* c, int base) {
+    if (c->scope_count == c->scope_capacity) {
+        c->scope_capacity = c->scope_capacity ? c->scope_capacity * 2 : 4;
+        c->scope_bases = (int*)scheme_realloc(c->scope_bases, (size_t)c->scope_capacity * sizeof(int));
+    }
+    c->scope_bases[c->scope_count++] = base;
+}
+
+// Compilation
+
+// Code generated with tail set is followed by OP_RETURN, which is how the
+// VM recognises a tail call
+static void gen(Compiler* c, SchemeObject* expr, bool tail);
+
+static int proper_length(SchemeObject* list) {
+    int length = 0;
+    for (; is_pair(list); list = cdr(list)) {
+        length++;
+    }
+    return is_nil(list) ? length : -1;
+}
+
+static void gen_fallback(Compiler* c, SchemeObject* expr) {
+    if (!c->heap_frames) {
+        c->needs_heap = true;
+        return;
+    }
+    emit1(c, OP_EVAL, add_constant(c, expr));
+    adjust_depth(c, 1);
+}
+
+// Loads a local reference, or with store set pops into it
+static void gen_local(Compiler* c, SchemeObject* ref, bool store) {
+    int depth = ref->value.local_depth;
+    int slot = ref->value.local_slot;
+    if (!c->heap_frames && depth < c->scope_count) {
+        emit1(c, store ? OP_STORE_LOCAL : OP_LOCAL, c->scope_bases[c->scope_count - 1 - depth] + slot);
+    } else {
+        // Flat scopes are not environment frames; skip over them
+        if (!c->heap_frames) {
+            depth -= c->scope_count;
+        }
+        emit2(c, store ? OP_STORE_ENV : OP_ENV, depth, slot);
+    }
+    adjust_depth(c, store ? -1 : 1);
+}
+
+// The stack slot of a local reference, or -1 if it is not in one
+static int stack_slot(Compiler* c, SchemeObject* expr) {
+    if (c->heap_frames || !is_local_ref(expr) || expr->value.local_depth >= c->scope_count) {
+        return -1;
+    }
+    return c->scope_bases[c->scope_count - 1 - expr->value.local_depth] + expr->value.local_slot;
+}
+
+static bool is_global_named(SchemeObject* expr, const char* name) {
+    return is_global_ref(expr) && strcmp(expr->value.global_symbol->value.symbol_name, name) == 0;
+}
+
+// The opcode for two-operand calls of a global, or OPCODE_COUNT if it is
+// not one of the numeric operators
+static Opcode numeric_opcode(SchemeObject* operator) {
+    static const struct {
+        const char* name;
+        Opcode op;
+    } operators[] = {
+        {"+", OP_ADD}, {"-", OP_SUBTRACT}, {"*", OP_MULTIPLY}, {"/", OP_DIVIDE},
+        {"=", OP_NUM_EQ}, {"<", OP_LT}, {">", OP_GT}, {"<=", OP_LE}, {">=", OP_GE},
+    };
+    for (size_t i = 0; i < sizeof(operators) / sizeof(operators[0]); i++) {
+        if (is_global_named(operator, operators[i].name)) {
+            return operators[i].op;
+        }
+    }
+    return OPCODE_COUNT;
+}
+
+static void gen_sequence(Compiler* c, SchemeObject* exprs, bool tail) {
+    if (!is_pair(exprs)) {
+        emit_constant(c, SCHEME_NIL_OBJECT);
+        return;
+    }
+    for (; is_pair(exprs); exprs = cdr(exprs)) {
+        gen(c, car(exprs), tail && !is_pair(cdr(exprs)));
+        if (is_pair(cdr(exprs))) {
+            emit_op(c, OP_POP);
+            adjust_depth(c, -1);
+        }
+    }
+}
+
+// define and set! of a variable: (op target value)
+static void gen_assignment(Compiler* c, SchemeObject* expr, bool define) {
+    SchemeObject* args = cdr(expr);
+    if (proper_length(args) != 2) {
+        gen_fallback(c, expr);
+        return;
+    }
+
+    SchemeObject* target = car(args);
+    if (is_local_ref(target)) {
+        if (!define && stack_slot(c, target) >= 0) {
+            c->needs_heap = true;
+            return;
+        }
+        gen(c, car(cdr(args)), false);
+        gen_local(c, target, true);
+    } else if (is_symbol(target)) {
+        // A define by name inside a body adds to the procedure's own frame
+        if (define && !c->heap_frames && c->scope_count > 0) {
+            c->needs_heap = true;
+            return;
+        }
+        gen(c, car(cdr(args)), false);
+        emit1(c, define ? OP_DEFINE_GLOBAL : OP_SET_GLOBAL, add_constant(c, target));
+        adjust_depth(c, -1);
+    } else {
+        gen_fallback(c, expr);
+        return;
+    }
+    emit_constant(c, SCHEME_NIL_OBJECT);
+}
+
+// The end of a branch: in tail position it returns instead of jumping
+static void gen_branch_end(Compiler* c, int* end, bool tail) {
+    if (tail) {
+        emit_op(c, OP_RETURN);
+    } else {
+        emit_jump(c, OP_JUMP, end);
+    }
+    adjust_depth(c, -1);
+}
+
+static void gen_if(Compiler* c, SchemeObject* expr, bool tail) {
+    SchemeObject* args = cdr(expr);
+    int length = proper_length(args);
+    if (length != 2 && length != 3) {
+        gen_fallback(c, expr);
+        return;
+    }
+
+    int alternative = -1;
+    int end = -1;
+    gen(c, car(args), false);
+    emit_jump(c, OP_JUMP_IF_FALSE, &alternative);
+    adjust_depth(c, -1);
+
+    gen(c, car(cdr(args)), tail);
+    gen_branch_end(c, &end, tail);
+
+    patch_jumps(c, alternative);
+    if (length == 3) {
+        gen(c, car(cdr(cdr(args))), tail);
+    } else {
+        emit_constant(c, SCHEME_NIL_OBJECT);
+    }
+    patch_jumps(c, end);
+}
+
+// and stops at the first #f, or at the first true value; the value
+// stopped at is the result
+static void gen_and_or(Compiler* c, SchemeObject* expr, bool is_and, bool tail) {
+    SchemeObject* items = cdr(expr);
+    int count = proper_length(items);
+    if (count < 0) {
+        gen_fallback(c, expr);
+        return;
+    }
+    if (count == 0) {
+        emit_constant(c, is_and ? SCHEME_TRUE_OBJECT : SCHEME_FALSE_OBJECT);
+        return;
+    }
+
+    int end = -1;
+    for (; is_pair(cdr(items)); items = cdr(items)) {
+        gen(c, car(items), false);
+        emit_jump(c, is_and ? OP_JUMP_IF_FALSE_OR_POP : OP_JUMP_IF_TRUE_OR_POP, &end);
+        adjust_depth(c, -1);
+    }
+    gen(c, car(items), tail);
+    patch_jumps(c, end);
+}
+
+static void gen_cond(Compiler* c, SchemeObject* expr, bool tail) {
+    SchemeObject* clauses = cdr(expr);
+    int count = proper_length(clauses);
+    if (count < 0) {
+        gen_fallback(c, expr);
+        return;
+    }
+
+    // Malformed clauses, and an else that is not last, are errors only when
+    // evaluation reaches them; leave those to eval_cond
+    int i = 0;
+    for (SchemeObject* cl = clauses; is_pair(cl); cl = cdr(cl), i++) {
+        SchemeObject* clause = car(cl);
+        if (!is_pair(clause) || proper_length(clause) < 0 ||
+            (car(clause) == SYMBOL_ELSE && i != count - 1)) {
+            gen_fallback(c, expr);
+            return;
+        }
+    }
+
+    int end = -1;
+    bool has_else = false;
+    for (SchemeObject* cl = clauses; is_pair(cl); cl = cdr(cl)) {
+        SchemeObject* clause = car(cl);
+        SchemeObject* body = cdr(clause);
+        if (car(clause) == SYMBOL_ELSE) {
+            gen_sequence(c, body, tail);
+            has_else = true;
+        } else if (is_pair(body)) {
+            int next = -1;
+            gen(c, car(clause), false);
+            emit_jump(c, OP_JUMP_IF_FALSE, &next);
+            adjust_depth(c, -1);
+            gen_sequence(c, body, tail);
+            gen_branch_end(c, &end, tail);
+            patch_jumps(c, next);
+        } else {
+            // A clause with no body yields its test
+            gen(c, car(clause), false);
+            emit_jump(c, OP_JUMP_IF_TRUE_OR_POP, &end);
+            adjust_depth(c, -1);
+        }
+    }
+    if (!has_else) {
+        emit_constant(c, SCHEME_NIL_OBJECT);
+    }
+    patch_jumps(c, end);
+}
+
+static SchemeObject* compile_procedure(SchemeObject* expr);
+
+static void gen_lambda(Compiler* c, SchemeObject* expr) {
+    if (!c->heap_frames) {
+        c->needs_heap = true;
+        return;
+    }
+    SchemeObject* body = compile_procedure(expr);
+    emit1(c, OP_CLOSURE, add_constant(c, body));
+    adjust_depth(c, 1);
+}
+
+// (let layout ((local init) ...) body...), and likewise let* and letrec.
+// Only let runs its initialisers outside the new scope; letrec binds every
+// variable, to (), before running them.
+static void gen_let(Compiler* c, SchemeObject* expr, bool tail) {
+    SchemeObject* kind = car(expr);
+    SchemeObject* args = cdr(expr);
+    SchemeObject* layout = car(args);
+    SchemeObject* bindings = car(cdr(args));
+    SchemeObject* body = cdr(cdr(args));
+
+    if (c->heap_frames) {
+        int layout_index = add_constant(c, layout);
+        if (kind == SYMBOL_RESOLVED_LET) {
+            int count = 0;
+            for (SchemeObject* b = bindings; is_pair(b); b = cdr(b), count++) {
+                gen(c, car(cdr(car(b))), false);
+            }
+            emit1(c, OP_ENTER_FRAME, layout_index);
+            // The values are on the stack in order; store the last first
+            for (int i = count - 1; i >= 0; i--) {
+                SchemeObject* b = bindings;
+                for (int j = 0; j < i; j++) {
+                    b = cdr(b);
+                }
+                emit2(c, OP_STORE_ENV, 0, car(car(b))->value.local_slot);
+                adjust_depth(c, -1);
+            }
+        } else {
+            emit1(c, OP_ENTER_FRAME, layout_index);
+            if (kind == SYMBOL_RESOLVED_LETREC) {
+                for (SchemeObject* b = bindings; is_pair(b); b = cdr(b)) {
+                    emit_constant(c, SCHEME_NIL_OBJECT);
+                    emit2(c, OP_STORE_ENV, 0, car(car(b))->value.local_slot);
+                    adjust_depth(c, -1);
+                }
+            }
+            for (SchemeObject* b = bindings; is_pair(b); b = cdr(b)) {
+                gen(c, car(cdr(car(b))), false);
+                emit2(c, OP_STORE_ENV, 0, car(car(b))->value.local_slot);
+                adjust_depth(c, -1);
+            }
+        }
+        gen_sequence(c, body, tail);
+        // Returning discards the frame anyway
+        if (!tail) {
+            emit_op(c, OP_LEAVE_FRAME);
+        }
+        return;
+    }
+
+    // Flat: every scope gets slots of its own, so a let's values can be
+    // stored as they are computed without disturbing its initialisers
+    int base = reserve_locals(c, layout);
+    if (kind == SYMBOL_RESOLVED_LET) {
+        for (SchemeObject* b = bindings; is_pair(b); b = cdr(b)) {
+            gen(c, car(cdr(car(b))), false);
+            emit1(c, OP_STORE_LOCAL, base + car(car(b))->value.local_slot);
+            adjust_depth(c, -1);
+        }
+        push_scope(c, base);
+    } else {
+        push_scope(c, base);
+        if (kind == SYMBOL_RESOLVED_LETREC) {
+            for (SchemeObject* b = bindings; is_pair(b); b = cdr(b)) {
+                emit_constant(c, SCHEME_NIL_OBJECT);
+                emit1(c, OP_STORE_LOCAL, base + car(car(b))->value.local_slot);
+                adjust_depth(c, -1);
+            }
+        }
+        for (SchemeObject* b = bindings; is_pair(b); b = cdr(b)) {
+            gen(c, car(cdr(car(b))), false);
+            emit1(c, OP_STORE_LOCAL, base + car(car(b))->value.local_slot);
+            adjust_depth(c, -1);
+        }
+    }
+    gen_sequence(c, body, tail);
+    c->scope_count--;
+}
+
+// Pops the values OP_SPREAD_VALUES left for targets into their slots, the
+// rest list first and the first value last
+static void gen_store_targets(Compiler* c, SchemeObject* targets, int base) {
+    if (is_pair(targets)) {
+        gen_store_targets(c, cdr(targets), base);
+        targets = car(targets);
+    } else if (!is_local_ref(targets)) {
+        return;
+    }
+    if (c->heap_frames) {
+        emit2(c, OP_STORE_ENV, 0, targets->value.local_slot);
+    } else {
+        emit1(c, OP_STORE_LOCAL, base + targets->value.local_slot);
+    }
+    adjust_depth(c, -1);
+}
+
+// Stores the clauses' values, last clause first
+static void gen_store_clauses(Compiler* c, SchemeObject* clauses, int base) {
+    if (is_pair(clauses)) {
+        gen_store_clauses(c, cdr(clauses), base);
+        gen_store_targets(c, car(car(clauses)), base);
+    }
+}
+
+// (let-values layout ((targets init) ...) body...). Each initialiser's
+// values are spread onto the stack, then stored as let stores its values.
+static void gen_let_values(Compiler* c, SchemeObject* expr, bool tail) {
+    SchemeObject* args = cdr(expr);
+    SchemeObject* layout = car(args);
+    SchemeObject* clauses = car(cdr(args));
+    SchemeObject* body = cdr(cdr(args));
+
+    int base = c->heap_frames ? 0 : reserve_locals(c, layout);
+    for (SchemeObject* cl = clauses; is_pair(cl); cl = cdr(cl)) {
+        SchemeObject* clause = car(cl);
+        int required = 0;
+        SchemeObject* t = car(clause);
+        for (; is_pair(t); t = cdr(t)) {
+            required++;
+        }
+        bool rest = is_local_ref(t);
+
+        gen(c, car(cdr(clause)), false);
+        emit2(c, OP_SPREAD_VALUES, required, rest);
+        adjust_depth(c, required + (rest ? 1 : 0) - 1);
+        if (!c->heap_frames) {
+            gen_store_targets(c, car(clause), base);
+        }
+    }
+
+    if (c->heap_frames) {
+        emit1(c, OP_ENTER_FRAME, add_constant(c, layout));
+        gen_store_clauses(c, clauses, base);
+        gen_sequence(c, body, tail);
+        // Returning discards the frame anyway
+        if (!tail) {
+            emit_op(c, OP_LEAVE_FRAME);
+        }
+        return;
+    }
+
+    push_scope(c, base);
+    gen_sequence(c, body, tail);
+    c->scope_count--;
+}
+
+static void gen_application(Compiler* c, SchemeObject* expr) {
+    int argc = proper_length(cdr(expr));
+    if (argc < 0) {
+        gen_fallback(c, expr);
+        return;
+    }
+
+    SchemeObject* operator = car(expr);
+    Opcode numeric = OPCODE_COUNT;
+    if (argc == 2) {
+        numeric = numeric_opcode(operator);
+    } else if (argc == 1 && is_global_named(operator, "-")) {
+        numeric = OP_NEGATE;
+    }
+    if (numeric != OPCODE_COUNT) {
+        int global = add_constant(c, operator);
+        SchemeObject* first = car(cdr(expr));
+        SchemeObject* second = argc == 2 ? car(cdr(cdr(expr))) : NULL;
+        int slot = stack_slot(c, first);
+        int other = second ? stack_slot(c, second) : -1;
+        if (slot >= 0 && other >= 0) {
+            emit2(c, OP_LOCAL_LOCAL, slot, other);
+            adjust_depth(c, 2);
+        } else if (slot >= 0 && second && is_self_evaluating(second)) {
+            emit2(c, OP_LOCAL_CONST, slot, add_constant(c, second));
+            adjust_depth(c, 2);
+        } else {
+            for (SchemeObject* a = cdr(expr); is_pair(a); a = cdr(a)) {
+                gen(c, car(a), false);
+            }
+            if (c->needs_heap) {
+                return;
+            }
+        }
+        emit1(c, numeric, global);
+        // The fallback pushes the procedure under the operands
+        adjust_depth(c, 1);
+        adjust_depth(c, -argc);
+        return;
+    }
+
+    if (is_global_ref(operator) && argc == 2) {
+        // (g local constant) and (g local local)
+        SchemeObject* first = car(cdr(expr));
+        SchemeObject* second = car(cdr(cdr(expr)));
+        int slot = stack_slot(c, first);
+        int other = stack_slot(c, second);
+        if (slot >= 0 && (other >= 0 || is_self_evaluating(second))) {
+            int global = add_constant(c, operator);
+            if (other >= 0) {
+                emit3(c, OP_CALL_LOCAL_LOCAL, global, slot, other);
+            } else {
+                emit3(c, OP_CALL_LOCAL_CONST, global, slot, add_constant(c, second));
+            }
+            // The fallback pushes the procedure and both arguments
+            adjust_depth(c, 3);
+            adjust_depth(c, -2);
+            return;
+        }
+    }
+
+    if (argc == 1 && (is_global_named(operator, "car") || is_global_named(operator, "cdr"))) {
+        bool is_car = is_global_named(operator, "car");
+        int global = add_constant(c, operator);
+        gen(c, car(cdr(expr)), false);
+        if (c->needs_heap) {
+            return;
+        }
+        int32_t* last = &c->bc->code[c->last_op];
+        if (*last == OP_LOCAL && c->last_label != c->bc->code_length) {
+            *last = is_car ? OP_LOCAL_CAR : OP_LOCAL_CDR;
+            emit(c, global);
+        } else {
+            emit1(c, is_car ? OP_CAR : OP_CDR, global);
+        }
+        // The fallback pushes the procedure under its argument
+        adjust_depth(c, 1);
+        adjust_depth(c, -1);
+        return;
+    }
+
+    gen(c, operator, false);
+    for (SchemeObject* a = cdr(expr); is_pair(a); a = cdr(a)) {
+        gen(c, car(a), false);
+    }
+    emit1(c, OP_CALL, argc);
+    adjust_depth(c, -argc);
+}
+
+static void gen(Compiler* c, SchemeObject* expr, bool tail) {
+    if (c->needs_heap) {
+        return;
+    }
+    if (is_local_ref(expr)) {
+        gen_local(c, expr, false);
+        return;
+    }
+    if (is_global_ref(expr)) {
+        emit1(c, OP_GLOBAL, add_constant(c, expr));
+        adjust_depth(c, 1);
+        return;
+    }
+    if (is_self_evaluating(expr)) {
+        emit_constant(c, expr);
+        return;
+    }
+    if (!is_pair(expr)) {
+        gen_fallback(c, expr);
+        return;
+    }
+
+    SchemeObject* head = car(expr);
+    if (is_symbol(head)) {
+        if (head == SYMBOL_QUOTE) {
+            SchemeObject* args = cdr(expr);
+            if (proper_length(args) == 1) {
+                emit_constant(c, car(args));
+            } else {
+                gen_fallback(c, expr);
+            }
+        } else if (head == SYMBOL_IF) {
+            gen_if(c, expr, tail);
+        } else if (head == SYMBOL_DEFINE) {
+            gen_assignment(c, expr, true);
+        } else if (head == SYMBOL_SET) {
+            gen_assignment(c, expr, false);
+        } else if (head == SYMBOL_BEGIN) {
+            if (proper_length(cdr(expr)) >= 0) {
+                gen_sequence(c, cdr(expr), tail);
+            } else {
+                gen_fallback(c, expr);
+            }
+        } else if (head == SYMBOL_AND) {
+            gen_and_or(c, expr, true, tail);
+        } else if (head == SYMBOL_OR) {
+            gen_and_or(c, expr, false, tail);
+        } else if (head == SYMBOL_COND) {
+            gen_cond(c, expr, tail);
+        } else if (head == SYMBOL_RESOLVED_LAMBDA) {
+            gen_lambda(c, expr);
+        } else if (head == SYMBOL_RESOLVED_LET || head == SYMBOL_RESOLVED_LET_STAR ||
+                   head == SYMBOL_RESOLVED_LETREC) {
+            gen_let(c, expr, tail);
+        } else if (head == SYMBOL_RESOLVED_LET_VALUES) {
+            gen_let_values(c, expr, tail);
+        } else {
+            // Unresolved forms and unresolved variables
+            gen_fallback(c, expr);
+        }
+        return;
+    }
+
+    gen_application(c, expr);
+}
+
+// Compiles a body into object, flat if it can be. A lambda body's own frame
+// is the outermost flat scope, its parameters in the first slots.
+static void compile_body(SchemeObject* object, SchemeObject* body, SchemeObject* layout, bool sequence) {
+    Bytecode* bc = object->value.bytecode;
+    Compiler c = {0};
+    c.object = object;
+    c.bc = bc;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        reset_bytecode(bc);
+        c.heap_frames = attempt == 1;
+        c.needs_heap = false;
+        c.scope_count = 0;
+        c.depth = 0;
+        c.last_op = -1;
+        c.last_label = -1;
+
+        if (layout && !c.heap_frames) {
+            push_scope(&c, reserve_locals(&c, layout));
+        }
+        if (sequence) {
+            gen_sequence(&c, body, true);
+        } else {
+            gen(&c, body, true);
+        }
+        if (!c.needs_heap) {
+            break;
+        }
+    }
+
+    emit_op(&c, OP_RETURN);
+    bc->heap_frames = c.heap_frames;
+    scheme_free(c.scope_bases);
+    thread_bytecode(bc);
+}
+
+// (lambda layout params body...)
+static SchemeObject* compile_procedure(SchemeObject* expr) {
+    SchemeObject* args = cdr(expr);
+    SchemeObject* object = make_bytecode(expr);
+    Bytecode* bc = object->value.bytecode;
+    bc->layout = car(args);
+    bc->params = car(cdr(args));
+    bc->body = cdr(cdr(args));
+
+    SchemeObject* params = bc->params;
+    for (; is_pair(params); params = cdr(params)) {
+        bc->param_count++;
+    }
+    bc->has_rest = is_symbol(params);
+
+    compile_body(object, bc->body, bc->layout, true);
+    return object;
+}
+
+SchemeObject* compile_bytecode(SchemeObject* expr) {
+    SchemeObject* object = make_bytecode(expr);
+    compile_body(object, expr, NULL, false);
+    return object;
+}
@@ -587,18 +587,18 @@ void compile_expression(SchemeObject* expr, CompilerContext* ctx) {
         return;
     }
     
-    switch (expr->type) {
+    switch (object_type(expr)) {
         case SCHEME_NIL:
             emit_line(ctx, "result = scheme_nil;");
             break;
             
         case SCHEME_BOOLEAN:
             emit_line(ctx, "result = make_boolean(%s);", 
-                     expr->value.boolean_value ? "true" : "false");
+                     boolean_value(expr) ? "true" : "false");
             break;
             
         case SCHEME_NUMBER:
-            emit_line(ctx, "result = make_number(%.6g);", expr->value.number_value);
+            emit_line(ctx, "result = make_number(%.6g);", number_value(expr));
             break;
             
         case SCHEME_SYMBOL:
@@ -1213,9 +1213,9 @@ void compile_quoted_expression(SchemeObject* expr, CompilerContext* ctx) {
     if (!expr || is_nil(expr)) {
         emit_line(ctx, "result = scheme_nil;");
     } else if (is_number(expr)) {
-        emit_line(ctx, "result = make_number(%.6g);", expr->value.number_value);
+        emit_line(ctx, "result = make_number(%.6g);", number_value(expr));
     } else if (is_boolean(expr)) {
-        emit_line(ctx, "result = make_boolean(%s);", expr->value.boolean_value ? "true" : "false");
+        emit_line(ctx, "result = make_boolean(%s);", boolean_value(expr) ? "true" : "false");
     } else if (is_string(expr)) {
         emit_line(ctx, "result = make_string(\"%s\");", expr->value.string_value);
     } else if (is_symbol(expr)) {
@@ -1298,9 +1298,9 @@ void compile_simple_quoted_list(SchemeObject* list_expr, CompilerContext* ctx) {
         if (temp && is_pair(temp)) {
             SchemeObject* item = car(temp);
             if (is_number(item)) {
-                emit_line(ctx, "    elements[%d] = make_number(%.6g);", i, item->value.number_value);
+                emit_line(ctx, "    elements[%d] = make_number(%.6g);", i, number_value(item));
             } else if (is_boolean(item)) {
-                emit_line(ctx, "    elements[%d] = make_boolean(%s);", i, item->value.boolean_value ? "true" : "false");
+                emit_line(ctx, "    elements[%d] = make_boolean(%s);", i, boolean_value(item) ? "true" : "false");
             } else if (is_string(item)) {
                 emit_line(ctx, "    elements[%d] = make_string(\"%s\");", i, item->value.string_value);
             } else if (is_symbol(item)) {
@@ -1326,9 +1326,9 @@ void compile_quoted_value_to_variable(SchemeObject* expr, CompilerContext* ctx,
     if (!expr || is_nil(expr)) {
         emit_line(ctx, "        %s = scheme_nil;", var_name);
     } else if (is_number(expr)) {
-        emit_line(ctx, "        %s = make_number(%.6g);", var_name, expr->value.number_value);
+        emit_line(ctx, "        %s = make_number(%.6g);", var_name, number_value(expr));
     } else if (is_boolean(expr)) {
-        emit_line(ctx, "        %s = make_boolean(%s);", var_name, expr->value.boolean_value ? "true" : "false");
+        emit_line(ctx, "        %s = make_boolean(%s);", var_name, boolean_value(expr) ? "true" : "false");
     } else if (is_string(expr)) {
         emit_line(ctx, "        %s = make_string(\"%s\");", var_name, expr->value.string_value);
     } else if (is_symbol(expr)) {
@@ -1433,7 +1433,7 @@ void compile_lambda(SchemeObject* args, CompilerContext* ctx) {
     // Create a simple compilation for the body that uses compile_expression logic
     if (is_number(body)) {
         offset += snprintf(lambda_code + offset, sizeof(lambda_code) - offset,
-                          "    result = make_number(%.6g);\n", body->value.number_value);
+                          "    result = make_number(%.6g);\n", number_value(body));
     } else if (is_symbol(body)) {
         // Check if it's a parameter reference
         bool is_param = false;
@@ -1699,7 +1699,7 @@ void compile_lambda_expression(SchemeObject* expr, SchemeObject* params, char* l
     
     if (is_number(expr)) {
         *offset += snprintf(lambda_code + *offset, max_size - *offset,
-                           "        %s = make_number(%.6g);\n", result_var, expr->value.number_value);
+                           "        %s = make_number(%.6g);\n", result_var, number_value(expr));
     } else if (is_symbol(expr)) {
         // Check if it's a parameter reference
         bool is_param = false;
@@ -1719,7 +1719,7 @@ void compile_lambda_expression(SchemeObject* expr, SchemeObject* params, char* l
         }
     } else if (is_boolean(expr)) {
         *offset += snprintf(lambda_code + *offset, max_size - *offset,
-                           "        %s = make_boolean(%s);\n", result_var, expr->value.boolean_value ? "true" : "false");
+                           "        %s = make_boolean(%s);\n", result_var, boolean_value(expr) ? "true" : "false");
     } else if (is_string(expr)) {
         *offset += snprintf(lambda_code + *offset, max_size - *offset,
                            "        %s = make_string(\"%s\");\n", result_var, expr->value.string_value);
@@ -0,0 +1,424 @@
+#include "rscheme.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// dynamic-wind entries, (before . after), innermost first
+static SchemeObject* winders = NULL;
+
+// Exception handlers, innermost first
+static SchemeObject* handlers = NULL;
+
+// The escape in flight, if the error state is EVAL_ESCAPE
+static SchemeObject* escape_target = NULL;
+static SchemeObject* escape_value = NULL;
+
+static CatchFrame* catch_frames = NULL;
+
+// The stack the system gives the main thread when it does not say
+#ifdef _WIN32
+#define DEFAULT_STACK_SIZE ((size_t)1 << 20)
+#else
+#define DEFAULT_STACK_SIZE ((size_t)8 << 20)
+#endif
+#define MAX_STACK_RESERVE ((size_t)256 << 10)
+
+char* stack_limit = NULL;
+static size_t stack_reserve = 0;
+static bool in_stack_reserve = false;
+
+// The environment procedures called from here run primitives in
+static Environment* control_env = NULL;
+
+// These are Scheme so that, under the VM, their thunks run on the VM's own
+// stack and continuations captured inside them are full ones. guard
+// expands into a call of %guard (see resolver.c).
+static const char* const control_prelude =
+    "(define (dynamic-wind before thunk after)"
+    "  (before)"
+    "  (%push-winder before after)"
+    "  (let ((result (thunk)))"
+    "    (%pop-winder)"
+    "    (after)"
+    "    result))"
+    "(define (with-exception-handler handler thunk)"
+    "  (let ((outer (%handlers)))"
+    "    (%set-handlers! (cons handler outer))"
+    "    (let ((result (thunk)))"
+    "      (%set-handlers! outer)"
+    "      result)))"
+    "(define (%guard body handler)"
+    "  ((call/cc"
+    "     (lambda (guard-k)"
+    "       (with-exception-handler"
+    "         (lambda (condition)"
+    "           (guard-k (lambda ()"
+    "                      (handler condition (lambda () (raise-continuable condition))))))"
+    "         (lambda ()"
+    "           (let ((result (body)))"
+    "             (lambda () result))))))))";
+
+void push_catch(CatchFrame* frame) {
+    frame->outer = catch_frames;
+    frame->arguments = mark_arguments();
+    frame->vm_entry = current_vm_entry();
+    catch_frames = frame;
+}
+
+void pop_catch(CatchFrame* frame) {
+    catch_frames = frame->outer;
+}
+
+// Close the stack reserve again once the error that opened it has been
+// handled, or has unwound out of the evaluation
+static void close_stack_reserve(void) {
+    if (in_stack_reserve) {
+        stack_limit += stack_reserve;
+        in_stack_reserve = false;
+    }
+}
+
+void set_stack_limit(void* bottom) {
+    size_t size = DEFAULT_STACK_SIZE;
+#ifndef _WIN32
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        size = (size_t)limit.rlim_cur;
+    }
+#endif
+    stack_reserve = size / 8 < MAX_STACK_RESERVE ? size / 8 : MAX_STACK_RESERVE;
+    // One reserve for the handlers, and one for what lies beyond bottom:
+    // the frames that called main, and the program's arguments and
+    // environment
+    stack_limit = (char*)bottom - (size - 2 * stack_reserve);
+    in_stack_reserve = false;
+}
+
+void stack_depth_exceeded(void) {
+    if (!in_stack_reserve) {
+        stack_limit -= stack_reserve;
+        in_stack_reserve = true;
+    }
+    set_eval_error(EVAL_ERROR_RUNTIME, "stack depth exceeded");
+}
+
+void throw_error(void) {
+    close_stack_reserve();
+    CatchFrame* frame = catch_frames;
+    if (!frame) {
+        return;
+    }
+    catch_frames = frame->outer;
+    unwind_arguments(frame->arguments);
+    unwind_vm_entries(frame->vm_entry);
+    longjmp(frame->jump, 1);
+}
+
+void reset_control(void) {
+    close_stack_reserve();
+    winders = SCHEME_NIL_OBJECT;
+    handlers = SCHEME_NIL_OBJECT;
+    escape_target = NULL;
+    escape_value = NULL;
+}
+
+SchemeObject* pending_escape(void) {
+    return get_eval_error() == EVAL_ESCAPE ? escape_target : NULL;
+}
+
+SchemeObject* take_escape(void) {
+    SchemeObject* value = escape_value;
+    escape_target = NULL;
+    escape_value = NULL;
+    clear_eval_error();
+    return value;
+}
+
+// A continuation takes one value, or none
+SchemeObject* continuation_value(int argc, SchemeObject** argv) {
+    if (argc > 1) {
+        set_eval_error(EVAL_ERROR_WRONG_ARITY, "continuation expects at most 1 argument");
+        return NULL;
+    }
+    return argc == 1 ? argv[0] : SCHEME_NIL_OBJECT;
+}
+
+SchemeObject* throw_to_continuation(SchemeObject* k, int argc, SchemeObject** argv) {
+    SchemeObject* value = continuation_value(argc, argv);
+    if (!k->value.continuation.segment && !k->value.continuation.active) {
+        set_eval_error(EVAL_ERROR_RUNTIME, "continuation invoked after its call/cc returned");
+        return NULL;
+    }
+    escape_target = k;
+    escape_value = value;
+    set_eval_error(EVAL_ESCAPE, "continuation invoked outside its extent");
+    return NULL;
+}
+
+void capture_extent(SchemeObject* k) {
+    k->value.continuation.winders = winders;
+    k->value.continuation.handlers = handlers;
+}
+
+static size_t list_length_of(SchemeObject* list) {
+    size_t length = 0;
+    for (; is_pair(list); list = cdr(list)) {
+        length++;
+    }
+    return length;
+}
+
+void rewind_to(SchemeObject* k) {
+    SchemeObject* target = k->value.continuation.winders;
+
+    // The innermost extent both lists share
+    SchemeObject* from = winders;
+    SchemeObject* to = target;
+    size_t from_length = list_length_of(from);
+    size_t to_length = list_length_of(to);
+    for (; from_length > to_length; from_length--) {
+        from = cdr(from);
+    }
+    for (; to_length > from_length; to_length--) {
+        to = cdr(to);
+    }
+    while (from != to) {
+        from = cdr(from);
+        to = cdr(to);
+    }
+    SchemeObject* common = from;
+
+    while (winders != common) {
+        SchemeObject* after = cdr(car(winders));
+        winders = cdr(winders);
+        apply_procedure_argv(after, 0, NULL, control_env);
+    }
+
+    // Enter outermost first: each step finds the entry just inside the
+    // extents already entered
+    while (winders != target) {
+        SchemeObject* entry = target;
+        while (cdr(entry) != winders) {
+            entry = cdr(entry);
+        }
+        apply_procedure_argv(car(car(entry)), 0, NULL, control_env);
+        winders = entry;
+    }
+
+    handlers = k->value.continuation.handlers;
+}
+
+// The tree-walker's call/cc. The VM captures its own continuations and
+// only reaches this from code it does not run itself.
+SchemeObject* builtin_call_cc(int argc, SchemeObject** argv, Environment* env) {
+    if (argc != 1) {
+        set_eval_error(EVAL_ERROR_WRONG_ARITY, "call/cc expects 1 argument");
+        return NULL;
+    }
+
+    SchemeObject** frame = push_arguments(1);
+    SchemeObject* k = make_continuation(NULL);
+    capture_extent(k);
+    k->value.continuation.active = true;
+    frame[0] = k;
+
+    CatchFrame catcher;
+    push_catch(&catcher);
+    if (setjmp(catcher.jump)) {
+        k->value.continuation.active = false;
+        if (pending_escape() != k) {
+            throw_error();
+            return NULL;
+        }
+        SchemeObject* result = take_escape();
+        pop_arguments(1);
+        rewind_to(k);
+        return result;
+    }
+
+    SchemeObject* result = apply_procedure_argv(argv[0], 1, frame, env);
+    pop_catch(&catcher);
+    k->value.continuation.active = false;
+    pop_arguments(1);
+    return result;
+}
+
+// The message of an exception nothing handled
+static void uncaught_message(SchemeObject* obj, char* message, size_t size) {
+    char* printed;
+    if (!is_error_object(obj)) {
+        printed = object_to_string(obj);
+        snprintf(message, size, "uncaught exception: %s", printed);
+        scheme_free(printed);
+        return;
+    }
+
+    size_t length = (size_t)snprintf(message, size, "%s", obj->value.error.message->value.string_value);
+    for (SchemeObject* i = obj->value.error.irritants; is_pair(i) && length < size; i = cdr(i)) {
+        printed = object_to_string(car(i));
+        length += (size_t)snprintf(message + length, size - length, " %s", printed);
+        scheme_free(printed);
+    }
+}
+
+// Out of raise_object, whose frame a chain of handlers that raise again
+// nests, so that its message buffer is not
+static void uncaught_error(SchemeObject* obj) {
+    char message[1024];
+    uncaught_message(obj, message, sizeof(message));
+    set_eval_error(EVAL_ERROR_RUNTIME, message);
+}
+
+// Call the innermost handler on obj, with the outer ones in force. If a
+// handler returns from a raise that cannot continue, obj is raised again
+// to the handlers outside it; with none left it becomes an error.
+static SchemeObject* raise_object(SchemeObject* obj, bool continuable, Environment* env) {
+    if (!is_pair(handlers)) {
+        uncaught_error(obj);
+        return NULL;
+    }
+
+    SchemeObject* installed = handlers;
+    handlers = cdr(installed);
+    SchemeObject** frame = push_arguments(1);
+    frame[0] = obj;
+    SchemeObject* result = apply_procedure_argv(car(installed), 1, frame, env);
+    pop_arguments(1);
+    if (!continuable) {
+        return raise_object(obj, false, env);
+    }
+    handlers = installed;
+    return result;
+}
+
+void signal_error(const char* message) {
+    if (is_pair(handlers)) {
+        SchemeObject* obj = make_error_object(make_string(message ? message : "error"),
+                                              SCHEME_NIL_OBJECT);
+        raise_object(obj, false, control_env);
+    }
+}
+
+static SchemeObject* builtin_raise(int argc, SchemeObject** argv, Environment* env) {
+    if (argc != 1) {
+        set_eval_error(EVAL_ERROR_WRONG_ARITY, "raise expects 1 argument");
+        return NULL;
+    }
+    return raise_object(argv[0], false, env);
+}
+
+static SchemeObject* builtin_raise_continuable(int argc, SchemeObject** argv, Environment* env) {
+    if (argc != 1) {
+        set_eval_error(EVAL_ERROR_WRONG_ARITY, "raise-continuable expects 1 argument");
+        return NULL;
+    }
+    return raise_object(argv[0], true, env);
+}
+
+static SchemeObject* builtin_error(int argc, SchemeObject** argv, Environment* env) {
+    if (argc < 1 || !is_string(argv[0])) {
+        set_eval_error(EVAL_ERROR_WRONG_TYPE, "error expects a message string");
+        return NULL;
+    }
+    SchemeObject* irritants = SCHEME_NIL_OBJECT;
+    for (int i = argc - 1; i >= 1; i--) {
+        irritants = cons(argv[i], irritants);
+    }
+    return raise_object(make_error_object(argv[0], irritants), false, env);
+}
+
+static SchemeObject* builtin_error_object_p(int argc, SchemeObject** argv, Environment* env) {
+    (void)env; // Unused
+    if (argc != 1) {
+        set_eval_error(EVAL_ERROR_WRONG_ARITY, "error-object? expects 1 argument");
+        return NULL;
+    }
+    return make_boolean(is_error_object(argv[0]));
+}
+
+static SchemeObject* builtin_error_object_message(int argc, SchemeObject** argv, Environment* env) {
+    (void)env; // Unused
+    if (argc != 1 || !is_error_object(argv[0])) {
+        set_eval_error(EVAL_ERROR_WRONG_TYPE, "error-object-message expects an error object");
+        return NULL;
+    }
+    return argv[0]->value.error.message;
+}
+
+static SchemeObject* builtin_error_object_irritants(int argc, SchemeObject** argv, Environment* env) {
+    (void)env; // Unused
+    if (argc != 1 || !is_error_object(argv[0])) {
+        set_eval_error(EVAL_ERROR_WRONG_TYPE, "error-object-irritants expects an error object");
+        return NULL;
+    }
+    return argv[0]->value.error.irritants;
+}
+
+static SchemeObject* builtin_push_winder(int argc, SchemeObject** argv, Environment* env) {
+    (void)env; // Unused
+    if (argc != 2) {
+        set_eval_error(EVAL_ERROR_WRONG_ARITY, "%push-winder expects 2 arguments");
+        return NULL;
+    }
+    winders = cons(cons(argv[0], argv[1]), winders);
+    return SCHEME_NIL_OBJECT;
+}
+
+static SchemeObject* builtin_pop_winder(int argc, SchemeObject** argv, Environment* env) {
+    (void)argc; (void)argv; (void)env; // Unused
+    if (is_pair(winders)) {
+        winders = cdr(winders);
+    }
+    return SCHEME_NIL_OBJECT;
+}
+
+static SchemeObject* builtin_handlers(int argc, SchemeObject** argv, Environment* env) {
+    (void)argc; (void)argv; (void)env; // Unused
+    return handlers;
+}
+
+static SchemeObject* builtin_set_handlers(int argc, SchemeObject** argv, Environment* env) {
+    (void)env; // Unused
+    if (argc != 1) {
+        set_eval_error(EVAL_ERROR_WRONG_ARITY, "%set-handlers! expects 1 argument");
+        return NULL;
+    }
+    handlers = argv[0];
+    return SCHEME_NIL_OBJECT;
+}
+
+void init_control(Environment* env) {
+    static bool roots_added = false;
+    if (!roots_added) {
+        winders = SCHEME_NIL_OBJECT;
+        handlers = SCHEME_NIL_OBJECT;
+        gc_add_root(&winders);
+        gc_add_root(&handlers);
+        gc_add_root(&escape_target);
+        gc_add_root(&escape_value);
+        roots_added = true;
+    }
+    control_env = env;
+
+    SchemeObject* call_cc = make_primitive(builtin_call_cc);
+    define_variable(env, "call-with-current-continuation", call_cc);
+    define_variable(env, "call/cc", call_cc);
+    define_variable(env, "raise", make_primitive(builtin_raise));
+    define_variable(env, "raise-continuable", make_primitive(builtin_raise_continuable));
+    define_variable(env, "error", make_primitive(builtin_error));
+    define_variable(env, "error-object?", make_primitive(builtin_error_object_p));
+    define_variable(env, "error-object-message", make_primitive(builtin_error_object_message));
+    define_variable(env, "error-object-irritants", make_primitive(builtin_error_object_irritants));
+    define_variable(env, "%push-winder", make_primitive(builtin_push_winder));
+    define_variable(env, "%pop-winder", make_primitive(builtin_pop_winder));
+    define_variable(env, "%handlers", make_primitive(builtin_handlers));
+    define_variable(env, "%set-handlers!", make_primitive(builtin_set_handlers));
+
+    Parser* parser = create_parser(control_prelude);
+    SchemeObject* expr;
+    while ((expr = parse_expression(parser)) != NULL) {
+        eval_toplevel(expr, env);
+    }
+    destroy_parser(parser);
+}
@@ -1,10 +1,18 @@
 #include "rscheme.h"
 
+uint64_t binding_version = 0;
+
 Environment* make_environment(Environment* parent) {
-    Environment* env = (Environment*)scheme_malloc(sizeof(Environment));
+    Environment* env = gc_allocate_environment();
+    env->slots = NULL;
+    env->layout = NULL;
     env->bindings = NULL;
+    env->table = NULL;
+    env->table_capacity = 0;
+    env->binding_count = 0;
     env->parent = parent;
     env->ref_count = 1;
+    env->marked = false;
     
     if (parent) {
         retain_environment(parent);
@@ -13,6 +21,28 @@ Environment* make_environment(Environment* parent) {
     return env;
 }
 
+// A frame whose variables live in slots, as the resolver laid them out.
+// Slots start unassigned (NULL).
+Environment* make_frame(Environment* parent, SchemeObject* layout) {
+    Environment* env = make_environment(parent);
+    size_t count = layout->value.vector.length;
+    if (count <= ENV_INLINE_SLOTS) {
+        env->slots = env->inline_slots;
+    } else {
+        env->slots = (SchemeObject**)scheme_malloc(count * sizeof(SchemeObject*));
+        memset(env->slots, 0, count * sizeof(SchemeObject*));
+    }
+    gc_write_barrier_environment(env, layout);
+    env->layout = layout;
+    return env;
+}
+
+void set_frame_slot(Environment* env, int slot, SchemeObject* value) {
+    gc_snapshot_barrier(env->slots[slot]);
+    gc_write_barrier_environment(env, value);
+    env->slots[slot] = value;
+}
+
 void retain_environment(Environment* env) {
     if (env) {
         env->ref_count++;
@@ -20,122 +50,262 @@ void retain_environment(Environment* env) {
 }
 
 void release_environment(Environment* env) {
-    if (!env || --env->ref_count > 0) {
-        return;
+    // Environments are reclaimed by the collector once unreachable
+    if (env) {
+        env->ref_count--;
+    }
+}
+
+void mark_environment(Environment* env) {
+    if (env && !env->marked && gc_is_traced(env->generation)) {
+        env->marked = true;
+        gc_push_gray_environment(env);
+    }
+}
+
+void mark_environment_children(Environment* env) {
+    mark_environment_bindings(env);
+    mark_environment(env->parent);
+}
+
+void mark_environment_bindings(Environment* env) {
+    if (env->layout) {
+        mark_object(env->layout);
+        for (size_t i = 0; i < env->layout->value.vector.length; i++) {
+            mark_object(env->slots[i]);
+        }
     }
+    for (Binding* current = env->bindings; current; current = current->next) {
+        mark_object(current->symbol);
+        mark_object(current->value);
+    }
+}
+
+size_t finalize_environment(Environment* env) {
+    size_t freed = 0;
     
-    // Free all bindings
     Binding* current = env->bindings;
     while (current) {
         Binding* next = current->next;
-        scheme_free(current->name);
-        if (current->value) {
-            release_object(current->value);
-        }
+        freed += sizeof(Binding);
         scheme_free(current);
         current = next;
     }
+    env->bindings = NULL;
     
-    // Release parent
-    if (env->parent) {
-        release_environment(env->parent);
+    if (env->slots && env->slots != env->inline_slots) {
+        freed += env->layout->value.vector.length * sizeof(SchemeObject*);
+        scheme_free(env->slots);
+    }
+    env->slots = NULL;
+    env->layout = NULL;
+    
+    if (env->table) {
+        freed += env->table_capacity * sizeof(Binding*);
+        scheme_free(env->table);
+        env->table = NULL;
     }
+    env->table_capacity = 0;
+    env->binding_count = 0;
     
-    scheme_free(env);
+    return freed;
 }
 
-void define_variable(Environment* env, const char* name, SchemeObject* value) {
-    if (!env || !name) {
-        return;
+// Bindings are keyed by interned symbol, so lookups compare pointers. The
+// string-named entry points intern the name first.
+
+static Binding* find_binding(Environment* env, SchemeObject* symbol) {
+    if (env->table) {
+        size_t mask = env->table_capacity - 1;
+        for (size_t i = symbol->value.symbol_hash & mask; env->table[i]; i = (i + 1) & mask) {
+            if (env->table[i]->symbol == symbol) {
+                return env->table[i];
+            }
+        }
+        return NULL;
     }
     
-    // Check if already bound in this environment
-    Binding* current = env->bindings;
-    while (current) {
-        if (strcmp(current->name, name) == 0) {
-            // Update existing binding
-            if (current->value) {
-                release_object(current->value);
-            }
-            current->value = value;
-            if (value) {
-                retain_object(value);
+    for (Binding* current = env->bindings; current; current = current->next) {
+        if (current->symbol == symbol) {
+            return current;
+        }
+    }
+    return NULL;
+}
+
+static SchemeObject** find_slot(Environment* env, SchemeObject* symbol) {
+    if (env->layout) {
+        SchemeVector* names = &env->layout->value.vector;
+        for (size_t i = 0; i < names->length; i++) {
+            if (names->elements[i] == symbol) {
+                return &env->slots[i];
             }
-            return;
         }
-        current = current->next;
+    }
+    return NULL;
+}
+
+// Bindings are never removed, so the table needs no tombstones
+static void table_insert(Binding** table, size_t capacity, Binding* binding) {
+    size_t mask = capacity - 1;
+    size_t i = binding->symbol->value.symbol_hash & mask;
+    while (table[i]) {
+        i = (i + 1) & mask;
+    }
+    table[i] = binding;
+}
+
+// Keep the table at most half full, building it when the frame first
+// outgrows linear search
+static void grow_binding_table(Environment* env) {
+    size_t capacity = env->table_capacity ? env->table_capacity * 2 : ENV_HASH_THRESHOLD * 4;
+    Binding** table = (Binding**)scheme_malloc(capacity * sizeof(Binding*));
+    memset(table, 0, capacity * sizeof(Binding*));
+    
+    for (Binding* current = env->bindings; current; current = current->next) {
+        table_insert(table, capacity, current);
+    }
+    
+    if (env->table) {
+        scheme_free(env->table);
+    }
+    env->table = table;
+    env->table_capacity = capacity;
+}
+
+static void update_binding(Environment* env, Binding* binding, SchemeObject* value) {
+    if (binding->value) {
+        release_object(binding->value);
+    }
+    gc_snapshot_barrier(binding->value);
+    gc_write_barrier_environment(env, value);
+    binding->value = value;
+    if (value) {
+        retain_object(value);
+    }
+}
+
+void define_symbol(Environment* env, SchemeObject* symbol, SchemeObject* value) {
+    if (!env || !symbol) {
+        return;
+    }
+    
+    // A name the resolver gave a slot is defined by filling the slot
+    SchemeObject** slot = find_slot(env, symbol);
+    if (slot) {
+        set_frame_slot(env, (int)(slot - env->slots), value);
+        return;
+    }
+    
+    // Check if already bound in this environment
+    Binding* existing = find_binding(env, symbol);
+    if (existing) {
+        update_binding(env, existing, value);
+        return;
     }
     
     // Create new binding
     Binding* binding = (Binding*)scheme_malloc(sizeof(Binding));
-    binding->name = scheme_strdup(name);
+    binding->symbol = symbol;
     binding->value = value;
     binding->next = env->bindings;
+    gc_write_barrier_environment(env, symbol);
+    gc_write_barrier_environment(env, value);
     
     if (value) {
         retain_object(value);
     }
     
     env->bindings = binding;
+    env->binding_count++;
+    binding_version++;
+    
+    if (env->table && env->binding_count * 2 <= env->table_capacity) {
+        table_insert(env->table, env->table_capacity, binding);
+    } else if (env->binding_count > ENV_HASH_THRESHOLD) {
+        grow_binding_table(env);
+    }
 }
 
-void set_variable(Environment* env, const char* name, SchemeObject* value) {
-    if (!env || !name) {
-        return;
+bool set_symbol_if_exists(Environment* env, SchemeObject* symbol, SchemeObject* value) {
+    if (!env || !symbol) {
+        return false;
     }
     
     // Search this environment and all parents
-    Environment* current_env = env;
-    while (current_env) {
-        Binding* current = current_env->bindings;
-        while (current) {
-            if (strcmp(current->name, name) == 0) {
-                // Found binding, update it
-                if (current->value) {
-                    release_object(current->value);
-                }
-                current->value = value;
-                if (value) {
-                    retain_object(value);
-                }
-                return;
-            }
-            current = current->next;
+    for (Environment* current_env = env; current_env; current_env = current_env->parent) {
+        SchemeObject** slot = find_slot(current_env, symbol);
+        if (slot) {
+            set_frame_slot(current_env, (int)(slot - current_env->slots), value);
+            return true;
+        }
+        Binding* binding = find_binding(current_env, symbol);
+        if (binding) {
+            update_binding(current_env, binding, value);
+            return true;
         }
-        current_env = current_env->parent;
     }
     
-    // Variable not found, define in current environment
-    define_variable(env, name, value);
+    return false; // Variable not found
 }
 
-bool set_variable_if_exists(Environment* env, const char* name, SchemeObject* value) {
-    if (!env || !name) {
-        return false;
+void set_symbol(Environment* env, SchemeObject* symbol, SchemeObject* value) {
+    if (!set_symbol_if_exists(env, symbol, value)) {
+        // Variable not found, define in current environment
+        define_symbol(env, symbol, value);
+    }
+}
+
+Binding* lookup_global_binding(Environment* env, SchemeObject* symbol) {
+    for (Environment* current_env = env; current_env; current_env = current_env->parent) {
+        if (find_slot(current_env, symbol)) {
+            return NULL;
+        }
+        Binding* binding = find_binding(current_env, symbol);
+        if (binding) {
+            return current_env->parent ? NULL : binding;
+        }
     }
     
+    return NULL; // Not found
+}
+
+SchemeObject* lookup_symbol(Environment* env, SchemeObject* symbol) {
     // Search this environment and all parents
-    Environment* current_env = env;
-    while (current_env) {
-        Binding* current = current_env->bindings;
-        while (current) {
-            if (strcmp(current->name, name) == 0) {
-                // Found binding, update it
-                if (current->value) {
-                    release_object(current->value);
-                }
-                current->value = value;
-                if (value) {
-                    retain_object(value);
-                }
-                return true;
-            }
-            current = current->next;
+    for (Environment* current_env = env; current_env; current_env = current_env->parent) {
+        // An empty slot's variable is not defined yet
+        SchemeObject** slot = find_slot(current_env, symbol);
+        if (slot && *slot) {
+            return *slot;
+        }
+        Binding* binding = find_binding(current_env, symbol);
+        if (binding) {
+            return binding->value;
         }
-        current_env = current_env->parent;
     }
     
-    return false; // Variable not found
+    return NULL; // Not found
+}
+
+void define_variable(Environment* env, const char* name, SchemeObject* value) {
+    if (!env || !name) {
+        return;
+    }
+    define_symbol(env, make_symbol(name), value);
+}
+
+void set_variable(Environment* env, const char* name, SchemeObject* value) {
+    if (!env || !name) {
+        return;
+    }
+    set_symbol(env, make_symbol(name), value);
+}
+
+bool set_variable_if_exists(Environment* env, const char* name, SchemeObject* value) {
+    if (!env || !name) {
+        return false;
+    }
+    return set_symbol_if_exists(env, make_symbol(name), value);
 }
 
 SchemeObject* lookup_variable(Environment* env, const char* name) {
@@ -143,20 +313,9 @@ SchemeObject* lookup_variable(Environment* env, const char* name) {
         return NULL;
     }
     
-    // Search this environment and all parents
-    Environment* current_env = env;
-    while (current_env) {
-        Binding* current = current_env->bindings;
-        while (current) {
-            if (strcmp(current->name, name) == 0) {
-                return current->value;
-            }
-            current = current->next;
-        }
-        current_env = current_env->parent;
-    }
-    
-    return NULL; // Not found
+    // A name that was never interned cannot be bound
+    SchemeObject* symbol = find_symbol(name, hash_string(name));
+    return symbol ? lookup_symbol(env, symbol) : NULL;
 }
 
 bool is_bound(Environment* env, const char* name) {
@@ -165,6 +324,7 @@ bool is_bound(Environment* env, const char* name) {
 
 Environment* make_global_environment(void) {
     Environment* env = make_environment(NULL);
+    gc_add_environment_root(env);
     init_builtins(env);
     return env;
 }
@@ -181,7 +341,7 @@ Environment* extend_environment(Environment* base, SchemeObject* vars, SchemeObj
         SchemeObject* val = car(val_list);
         
         if (is_symbol(var)) {
-            define_variable(env, var->value.symbol_name, val);
+            define_symbol(env, var, val);
         }
         
         var_list = cdr(var_list);
@@ -190,7 +350,43 @@ Environment* extend_environment(Environment* base, SchemeObject* vars, SchemeObj
     
     // Handle dotted parameter lists (for variadic functions)
     if (var_list && is_symbol(var_list)) {
-        define_variable(env, var_list->value.symbol_name, val_list);
+        define_symbol(env, var_list, val_list);
+    }
+    
+    return env;
+}
+
+// As extend_environment, with the values in an array. Only a rest
+// parameter receives a freshly consed list. Given a layout, the frame is a
+// slot frame whose first slots are the parameters in order.
+Environment* extend_environment_argv(Environment* base, SchemeObject* vars, SchemeObject* layout,
+                                     int argc, SchemeObject** argv) {
+    Environment* env = layout ? make_frame(base, layout) : make_environment(base);
+    
+    SchemeObject* var_list = vars;
+    int i = 0;
+    
+    while (is_pair(var_list) && i < argc) {
+        if (layout) {
+            env->slots[i] = argv[i];   // Fresh frame, nothing allocated since
+        } else if (is_symbol(car(var_list))) {
+            define_symbol(env, car(var_list), argv[i]);
+        }
+        var_list = cdr(var_list);
+        i++;
+    }
+    
+    if (is_symbol(var_list)) {
+        SchemeObject* rest = SCHEME_NIL_OBJECT;
+        for (int j = argc - 1; j >= i; j--) {
+            rest = cons(argv[j], rest);
+        }
+        if (layout) {
+            // Consing may have promoted the frame, so go through the barrier
+            set_frame_slot(env, i, rest);
+        } else {
+            define_symbol(env, var_list, rest);
+        }
     }
     
     return env;
@@ -204,9 +400,17 @@ void print_environment(Environment* env, FILE* out) {
     
     fprintf(out, "Environment:\n");
     
+    if (env->layout) {
+        for (size_t i = 0; i < env->layout->value.vector.length; i++) {
+            fprintf(out, "  %s = ", env->layout->value.vector.elements[i]->value.symbol_name);
+            print_object(env->slots[i], out);
+            fprintf(out, "\n");
+        }
+    }
+    
     Binding* current = env->bindings;
     while (current) {
-        fprintf(out, "  %s = ", current->name);
+        fprintf(out, "  %s = ", current->symbol->value.symbol_name);
         print_object(current->value, out);
         fprintf(out, "\n");
         current = current->next;
@@ -223,12 +427,6 @@ size_t environment_size(Environment* env) {
         return 0;
     }
     
-    size_t count = 0;
-    Binding* current = env->bindings;
-    while (current) {
-        count++;
-        current = current->next;
-    }
-    
-    return count;
+    size_t slots = env->layout ? env->layout->value.vector.length : 0;
+    return slots + env->binding_count;
 }
\ No newline at end of file
@@ -0,0 +1,1073 @@
+#include "rscheme.h"
+#include <setjmp.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define GC_NOINLINE __attribute__((noinline))
+#define GC_NO_SANITIZE __attribute__((no_sanitize_address))
+#elif defined(_MSC_VER)
+#define GC_NOINLINE __declspec(noinline)
+#define GC_NO_SANITIZE
+#else
+#define GC_NOINLINE
+#define GC_NO_SANITIZE
+#endif
+
+// Cells per heap chunk, the default number of young allocations between
+// minor collections, and the default growth of the old generation that
+// triggers a full collection.
+#define GC_CELLS_PER_CHUNK 1024
+#define GC_DEFAULT_NURSERY 32768
+#define GC_DEFAULT_THRESHOLD 100000
+// Allocations between incremental steps while a cycle is in progress
+#define GC_STEP_INTERVAL 1024
+// Gray entries scanned between clock reads
+#define GC_STEP_CHECK 64
+#define GC_MAX_CELLS_PER_CHUNK \
+    (GC_PAIRS_PER_CHUNK > GC_CELLS_PER_CHUNK ? GC_PAIRS_PER_CHUNK : GC_CELLS_PER_CHUNK)
+
+// A chunk holds cells of a single kind: GC_CELLS_PER_CHUNK objects or
+// environments, or GC_PAIRS_PER_CHUNK pairs in an aligned block. Allocation
+// bumps a cursor through the chunk, skipping cells that survived earlier
+// cycles.
+typedef struct HeapChunk {
+    GCCellKind kind;
+    size_t cell_size;
+    size_t cell_count;
+    size_t live_cells;
+    size_t cursor;             // Next cell the allocator will try
+    size_t young_start;        // First cell allocated in the current cycle
+    bool young;                // Allocated into since the last collection
+    bool swept;                // Already swept by the current incremental cycle
+    struct HeapChunk* next_available;  // Next chunk of this kind with free cells
+    char* block;               // Allocation holding the cells
+    char* cells;
+    uint8_t in_use[GC_MAX_CELLS_PER_CHUNK];
+} HeapChunk;
+
+// Phases of an incremental full collection
+typedef enum {
+    GC_PHASE_IDLE,
+    GC_PHASE_MARKING,
+    GC_PHASE_SWEEPING
+} GCPhase;
+
+// Mark stack entries are object values (plain or pair-tagged) or
+// environments carrying this otherwise unused tag
+#define GC_GRAY_ENVIRONMENT_TAG 0x4
+// A mark stack grown past this many entries is released after a collection
+#define GC_GRAY_KEEP 65536
+
+static struct {
+    bool initialized;
+    bool enabled;
+    bool collecting;
+    bool full_collection;
+    bool verbose;
+    char* stack_bottom;
+
+    // All chunks, sorted by cell address for conservative pointer lookup
+    HeapChunk** chunks;
+    size_t chunk_count;
+    size_t chunk_capacity;
+    HeapChunk* available[GC_CELL_KIND_COUNT];
+    HeapChunk* current[GC_CELL_KIND_COUNT];
+
+    // Chunks holding young cells
+    HeapChunk** young_chunks;
+    size_t young_chunk_count;
+    size_t young_chunk_capacity;
+
+    // Old cells that had a young pointer stored into them
+    SchemeObject** remembered_objects;
+    size_t remembered_object_count;
+    size_t remembered_object_capacity;
+    Environment** remembered_envs;
+    size_t remembered_env_count;
+    size_t remembered_env_capacity;
+    SchemePair** remembered_pairs;
+    size_t remembered_pair_count;
+    size_t remembered_pair_capacity;
+
+    SchemeObject*** roots;
+    size_t root_count;
+    size_t root_capacity;
+    Environment** env_roots;
+    size_t env_root_count;
+    size_t env_root_capacity;
+
+    size_t nursery_size;
+    size_t young_allocs;
+    size_t threshold;
+    size_t min_threshold;
+    size_t promoted_since_full;
+
+    // Mark stack
+    uintptr_t* gray;
+    size_t gray_count;
+    size_t gray_capacity;
+
+    // Incremental collection
+    double pause_budget_us;
+    GCPhase phase;
+    size_t sweep_cursor;
+    size_t step_allocs;
+    size_t cycle_steps;
+    size_t cycle_reclaimed;
+    bool release_empty_pending;
+    GCStats stats;
+} gc_state = {0};
+
+bool gc_incremental_marking = false;
+
+static const size_t cell_sizes[GC_CELL_KIND_COUNT] = {
+    sizeof(SchemeObject),
+    sizeof(Environment),
+    sizeof(SchemePair)
+};
+
+static void free_chunk(HeapChunk* chunk);
+
+static double gc_now_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1e6 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+#endif
+}
+
+void gc_init(void) {
+    if (gc_state.initialized) {
+        return;
+    }
+
+    gc_state.initialized = true;
+    gc_state.enabled = true;
+    gc_state.nursery_size = GC_DEFAULT_NURSERY;
+    gc_state.min_threshold = GC_DEFAULT_THRESHOLD;
+    gc_state.threshold = GC_DEFAULT_THRESHOLD;
+    gc_state.root_capacity = 16;
+    gc_state.roots = (SchemeObject***)scheme_malloc(
+        gc_state.root_capacity * sizeof(SchemeObject**));
+    gc_state.env_root_capacity = 4;
+    gc_state.env_roots = (Environment**)scheme_malloc(
+        gc_state.env_root_capacity * sizeof(Environment*));
+}
+
+void gc_cleanup(void) {
+    if (!gc_state.initialized) {
+        return;
+    }
+
+    // Release every remaining cell's payload, then the chunks: finalizing a
+    // frame reads its layout, which may live in any chunk
+    for (size_t i = 0; i < gc_state.chunk_count; i++) {
+        HeapChunk* chunk = gc_state.chunks[i];
+        for (size_t j = 0; j < chunk->cell_count; j++) {
+            if (!chunk->in_use[j]) {
+                continue;
+            }
+            void* cell = chunk->cells + j * chunk->cell_size;
+            if (chunk->kind == GC_CELL_OBJECT) {
+                finalize_object((SchemeObject*)cell);
+            } else if (chunk->kind == GC_CELL_ENVIRONMENT) {
+                finalize_environment((Environment*)cell);
+            }
+        }
+    }
+    for (size_t i = 0; i < gc_state.chunk_count; i++) {
+        free_chunk(gc_state.chunks[i]);
+    }
+
+    scheme_free(gc_state.chunks);
+    scheme_free(gc_state.young_chunks);
+    scheme_free(gc_state.remembered_objects);
+    scheme_free(gc_state.remembered_envs);
+    scheme_free(gc_state.remembered_pairs);
+    scheme_free(gc_state.gray);
+    scheme_free(gc_state.roots);
+    scheme_free(gc_state.env_roots);
+    memset(&gc_state, 0, sizeof(gc_state));
+    gc_incremental_marking = false;
+}
+
+void gc_set_stack_bottom(void* bottom) {
+    gc_state.stack_bottom = (char*)bottom;
+}
+
+// Chunk management
+
+static void insert_chunk(HeapChunk* chunk) {
+    if (gc_state.chunk_count >= gc_state.chunk_capacity) {
+        gc_state.chunk_capacity = gc_state.chunk_capacity ? gc_state.chunk_capacity * 2 : 16;
+        gc_state.chunks = (HeapChunk**)scheme_realloc(gc_state.chunks,
+            gc_state.chunk_capacity * sizeof(HeapChunk*));
+    }
+
+    size_t pos = gc_state.chunk_count;
+    while (pos > 0 && gc_state.chunks[pos - 1]->cells > chunk->cells) {
+        gc_state.chunks[pos] = gc_state.chunks[pos - 1];
+        pos--;
+    }
+    gc_state.chunks[pos] = chunk;
+    gc_state.chunk_count++;
+}
+
+// Pair blocks are aligned to their size so gc_pair_flags can find a pair's
+// flag byte by masking its address
+static char* allocate_pair_block(void) {
+#ifdef _MSC_VER
+    char* block = (char*)_aligned_malloc(GC_PAIR_BLOCK_SIZE, GC_PAIR_BLOCK_SIZE);
+#else
+    char* block = (char*)aligned_alloc(GC_PAIR_BLOCK_SIZE, GC_PAIR_BLOCK_SIZE);
+#endif
+    if (!block) {
+        runtime_error("Out of memory: failed to allocate pair chunk");
+        exit(EXIT_FAILURE);
+    }
+    memset(block, 0, GC_PAIR_HEADER_SLOTS * sizeof(SchemePair));
+    return block;
+}
+
+static void free_pair_block(char* block) {
+#ifdef _MSC_VER
+    _aligned_free(block);
+#else
+    free(block);
+#endif
+}
+
+static size_t chunk_bytes(const HeapChunk* chunk) {
+    return chunk->kind == GC_CELL_PAIR ? GC_PAIR_BLOCK_SIZE : chunk->cell_size * chunk->cell_count;
+}
+
+static HeapChunk* add_chunk(GCCellKind kind) {
+    HeapChunk* chunk = (HeapChunk*)scheme_malloc(sizeof(HeapChunk));
+    chunk->kind = kind;
+    chunk->cell_size = cell_sizes[kind];
+    chunk->live_cells = 0;
+    chunk->cursor = 0;
+    chunk->young_start = 0;
+    chunk->young = false;
+    // Cells allocated once marking is over hold nothing the sweep must see
+    chunk->swept = gc_state.phase == GC_PHASE_SWEEPING;
+    chunk->next_available = NULL;
+    if (kind == GC_CELL_PAIR) {
+        chunk->cell_count = GC_PAIRS_PER_CHUNK;
+        chunk->block = allocate_pair_block();
+        chunk->cells = chunk->block + GC_PAIR_HEADER_SLOTS * sizeof(SchemePair);
+    } else {
+        chunk->cell_count = GC_CELLS_PER_CHUNK;
+        chunk->block = (char*)scheme_malloc(chunk->cell_size * chunk->cell_count);
+        chunk->cells = chunk->block;
+    }
+    memset(chunk->in_use, 0, sizeof(chunk->in_use));
+
+    insert_chunk(chunk);
+    gc_state.stats.heap_bytes += chunk_bytes(chunk);
+    return chunk;
+}
+
+static void free_chunk(HeapChunk* chunk) {
+    gc_state.stats.heap_bytes -= chunk_bytes(chunk);
+    if (chunk->kind == GC_CELL_PAIR) {
+        free_pair_block(chunk->block);
+    } else {
+        scheme_free(chunk->block);
+    }
+    scheme_free(chunk);
+}
+
+// Find the chunk containing an address, or NULL
+static HeapChunk* find_chunk(const char* ptr) {
+    size_t low = 0;
+    size_t high = gc_state.chunk_count;
+
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        HeapChunk* chunk = gc_state.chunks[mid];
+        if (ptr < chunk->cells) {
+            high = mid;
+        } else if (ptr >= chunk->cells + chunk->cell_size * chunk->cell_count) {
+            low = mid + 1;
+        } else {
+            return chunk;
+        }
+    }
+
+    return NULL;
+}
+
+// Pick the next chunk to allocate into and record it as holding young cells
+static HeapChunk* next_allocation_chunk(GCCellKind kind) {
+    HeapChunk* chunk = gc_state.available[kind];
+    if (chunk) {
+        gc_state.available[kind] = chunk->next_available;
+        chunk->next_available = NULL;
+    } else {
+        chunk = add_chunk(kind);
+    }
+
+    if (gc_state.young_chunk_count >= gc_state.young_chunk_capacity) {
+        gc_state.young_chunk_capacity = gc_state.young_chunk_capacity ?
+            gc_state.young_chunk_capacity * 2 : 16;
+        gc_state.young_chunks = (HeapChunk**)scheme_realloc(gc_state.young_chunks,
+            gc_state.young_chunk_capacity * sizeof(HeapChunk*));
+    }
+    gc_state.young_chunks[gc_state.young_chunk_count++] = chunk;
+    chunk->young = true;
+    chunk->young_start = chunk->cursor;
+
+    gc_state.current[kind] = chunk;
+    return chunk;
+}
+
+static void incremental_step(bool complete);
+
+static void* allocate_cell(GCCellKind kind) {
+    if (gc_state.phase != GC_PHASE_IDLE && ++gc_state.step_allocs >= GC_STEP_INTERVAL) {
+        gc_state.step_allocs = 0;
+        incremental_step(false);
+    }
+    if (gc_state.young_allocs >= gc_state.nursery_size) {
+        gc_run_minor();
+    }
+
+    HeapChunk* chunk = gc_state.current[kind];
+    while (true) {
+        if (chunk) {
+            while (chunk->cursor < chunk->cell_count && chunk->in_use[chunk->cursor]) {
+                chunk->cursor++;
+            }
+            if (chunk->cursor < chunk->cell_count) {
+                break;
+            }
+        }
+        chunk = next_allocation_chunk(kind);
+    }
+
+    size_t index = chunk->cursor++;
+    chunk->in_use[index] = 1;
+    chunk->live_cells++;
+
+    gc_state.young_allocs++;
+    gc_state.stats.cells_allocated++;
+    gc_state.stats.live_cells++;
+
+    // Zero-filled cells start out young and unmarked
+    char* cell = chunk->cells + index * chunk->cell_size;
+    memset(cell, 0, chunk->cell_size);
+    return cell;
+}
+
+SchemeObject* gc_allocate_object(void) {
+    return (SchemeObject*)allocate_cell(GC_CELL_OBJECT);
+}
+
+Environment* gc_allocate_environment(void) {
+    return (Environment*)allocate_cell(GC_CELL_ENVIRONMENT);
+}
+
+// A reclaimed pair's flags were cleared by the sweep, and a fresh block's
+// by allocate_pair_block, so the new pair is young and unmarked
+SchemePair* gc_allocate_pair(void) {
+    return (SchemePair*)allocate_cell(GC_CELL_PAIR);
+}
+
+// Storage a new cell owns outside the heap, such as a bignum's digits,
+// brings the next minor collection nearer by the cells it would fill
+void gc_note_external(size_t bytes) {
+    gc_state.young_allocs += bytes / sizeof(SchemeObject);
+}
+
+// Write barrier support
+
+void gc_remember_object(SchemeObject* owner) {
+    if (gc_state.remembered_object_count >= gc_state.remembered_object_capacity) {
+        gc_state.remembered_object_capacity = gc_state.remembered_object_capacity ?
+            gc_state.remembered_object_capacity * 2 : 64;
+        gc_state.remembered_objects = (SchemeObject**)scheme_realloc(
+            gc_state.remembered_objects,
+            gc_state.remembered_object_capacity * sizeof(SchemeObject*));
+    }
+    owner->remembered = true;
+    gc_state.remembered_objects[gc_state.remembered_object_count++] = owner;
+}
+
+void gc_remember_environment(Environment* owner) {
+    if (gc_state.remembered_env_count >= gc_state.remembered_env_capacity) {
+        gc_state.remembered_env_capacity = gc_state.remembered_env_capacity ?
+            gc_state.remembered_env_capacity * 2 : 16;
+        gc_state.remembered_envs = (Environment**)scheme_realloc(
+            gc_state.remembered_envs,
+            gc_state.remembered_env_capacity * sizeof(Environment*));
+    }
+    owner->remembered = true;
+    gc_state.remembered_envs[gc_state.remembered_env_count++] = owner;
+}
+
+void gc_remember_pair(SchemePair* owner) {
+    if (gc_state.remembered_pair_count >= gc_state.remembered_pair_capacity) {
+        gc_state.remembered_pair_capacity = gc_state.remembered_pair_capacity ?
+            gc_state.remembered_pair_capacity * 2 : 64;
+        gc_state.remembered_pairs = (SchemePair**)scheme_realloc(
+            gc_state.remembered_pairs,
+            gc_state.remembered_pair_capacity * sizeof(SchemePair*));
+    }
+    *gc_pair_flags(owner) |= GC_PAIR_REMEMBERED;
+    gc_state.remembered_pairs[gc_state.remembered_pair_count++] = owner;
+}
+
+static void clear_remembered_set(void) {
+    for (size_t i = 0; i < gc_state.remembered_object_count; i++) {
+        gc_state.remembered_objects[i]->remembered = false;
+    }
+    for (size_t i = 0; i < gc_state.remembered_env_count; i++) {
+        gc_state.remembered_envs[i]->remembered = false;
+    }
+    for (size_t i = 0; i < gc_state.remembered_pair_count; i++) {
+        *gc_pair_flags(gc_state.remembered_pairs[i]) &= (uint8_t)~GC_PAIR_REMEMBERED;
+    }
+    gc_state.remembered_object_count = 0;
+    gc_state.remembered_env_count = 0;
+    gc_state.remembered_pair_count = 0;
+}
+
+bool gc_is_traced(uint8_t generation) {
+    // Incremental marking leaves young cells to the minor collections
+    if (gc_incremental_marking) {
+        return generation == GC_OLD;
+    }
+    return generation == GC_YOUNG || gc_state.full_collection;
+}
+
+// Root registration
+
+void gc_add_root(SchemeObject** root) {
+    if (gc_state.root_count >= gc_state.root_capacity) {
+        gc_state.root_capacity *= 2;
+        gc_state.roots = (SchemeObject***)scheme_realloc(gc_state.roots,
+            gc_state.root_capacity * sizeof(SchemeObject**));
+    }
+    gc_state.roots[gc_state.root_count++] = root;
+}
+
+void gc_remove_root(SchemeObject** root) {
+    for (size_t i = 0; i < gc_state.root_count; i++) {
+        if (gc_state.roots[i] == root) {
+            // Move last element to this position
+            gc_state.roots[i] = gc_state.roots[gc_state.root_count - 1];
+            gc_state.root_count--;
+            break;
+        }
+    }
+}
+
+void gc_add_environment_root(Environment* env) {
+    if (gc_state.env_root_count >= gc_state.env_root_capacity) {
+        gc_state.env_root_capacity *= 2;
+        gc_state.env_roots = (Environment**)scheme_realloc(gc_state.env_roots,
+            gc_state.env_root_capacity * sizeof(Environment*));
+    }
+    gc_state.env_roots[gc_state.env_root_count++] = env;
+}
+
+void gc_remove_environment_root(Environment* env) {
+    for (size_t i = 0; i < gc_state.env_root_count; i++) {
+        if (gc_state.env_roots[i] == env) {
+            gc_state.env_roots[i] = gc_state.env_roots[gc_state.env_root_count - 1];
+            gc_state.env_root_count--;
+            break;
+        }
+    }
+}
+
+// Mark phase
+
+// Mark the cell an ambiguous word points into, if any. Interior pointers
+// are accepted since optimised code may only hold a field address.
+static void mark_ambiguous(void* word) {
+    HeapChunk* chunk = find_chunk((const char*)word);
+    if (!chunk) {
+        return;
+    }
+
+    size_t index = ((char*)word - chunk->cells) / chunk->cell_size;
+    if (!chunk->in_use[index]) {
+        return;
+    }
+
+    void* cell = chunk->cells + index * chunk->cell_size;
+    if (chunk->kind == GC_CELL_OBJECT) {
+        mark_object((SchemeObject*)cell);
+    } else if (chunk->kind == GC_CELL_ENVIRONMENT) {
+        mark_environment((Environment*)cell);
+    } else {
+        mark_pair((SchemePair*)cell);
+    }
+}
+
+// Stack words are read without regard to the variables they belong to
+static GC_NO_SANITIZE void mark_range(char* low, char* high) {
+    uintptr_t start = ((uintptr_t)low + sizeof(void*) - 1) & ~(uintptr_t)(sizeof(void*) - 1);
+    for (char* p = (char*)start; p + sizeof(void*) <= high; p += sizeof(void*)) {
+        void* word;
+        memcpy(&word, p, sizeof(word));
+        mark_ambiguous(word);
+    }
+}
+
+// Scan the C stack, which holds the evaluator's and builtins' in-flight
+// temporaries. Callee-saved registers are spilled into this frame first.
+static GC_NOINLINE void mark_stack(void) {
+    jmp_buf registers;
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_unwind_init();
+#endif
+    setjmp(registers);
+
+    char* top = (char*)&registers;
+    char* bottom = gc_state.stack_bottom;
+    if (top < bottom) {
+        mark_range(top, bottom);
+    } else {
+        mark_range(bottom, top + sizeof(registers));
+    }
+}
+
+static void mark_roots(void) {
+    for (size_t i = 0; i < gc_state.root_count; i++) {
+        if (gc_state.roots[i]) {
+            mark_object(*gc_state.roots[i]);
+        }
+    }
+
+    for (size_t i = 0; i < gc_state.env_root_count; i++) {
+        mark_environment(gc_state.env_roots[i]);
+    }
+
+    mark_argument_stack();
+    mark_values_register();
+    mark_vm_frames();
+    mark_stack();
+
+    // Old cells are not traced by a minor collection, so the young cells
+    // stored into them since the last cycle are roots too
+    if (gc_state.collecting && !gc_state.full_collection) {
+        for (size_t i = 0; i < gc_state.remembered_object_count; i++) {
+            mark_object_children(gc_state.remembered_objects[i]);
+        }
+        for (size_t i = 0; i < gc_state.remembered_env_count; i++) {
+            mark_environment_bindings(gc_state.remembered_envs[i]);
+        }
+        for (size_t i = 0; i < gc_state.remembered_pair_count; i++) {
+            mark_object(gc_state.remembered_pairs[i]->car);
+            mark_object(gc_state.remembered_pairs[i]->cdr);
+        }
+    }
+}
+
+// Mark stack
+
+static void push_gray(uintptr_t entry) {
+    if (gc_state.gray_count >= gc_state.gray_capacity) {
+        gc_state.gray_capacity = gc_state.gray_capacity ? gc_state.gray_capacity * 2 : 256;
+        gc_state.gray = (uintptr_t*)scheme_realloc(gc_state.gray,
+            gc_state.gray_capacity * sizeof(uintptr_t));
+    }
+    gc_state.gray[gc_state.gray_count++] = entry;
+}
+
+void gc_push_gray_object(SchemeObject* obj) {
+    push_gray((uintptr_t)obj);
+}
+
+void gc_push_gray_environment(Environment* env) {
+    push_gray((uintptr_t)env | GC_GRAY_ENVIRONMENT_TAG);
+}
+
+// Blacken a gray cell by marking (and so graying) what it points to
+static void scan_gray(uintptr_t entry) {
+    if (entry & GC_GRAY_ENVIRONMENT_TAG) {
+        mark_environment_children((Environment*)(entry & ~(uintptr_t)GC_GRAY_ENVIRONMENT_TAG));
+        return;
+    }
+
+    SchemeObject* value = (SchemeObject*)entry;
+    if (is_pair(value)) {
+        mark_pair_children(pair_cell(value));
+    } else {
+        mark_object_children(value);
+    }
+}
+
+// Trace until the stack is back at base. Entries below it belong to an
+// incremental cycle that a minor collection has interrupted.
+static void drain_mark_stack(size_t base) {
+    while (gc_state.gray_count > base) {
+        scan_gray(gc_state.gray[--gc_state.gray_count]);
+    }
+
+    if (gc_state.gray_count == 0 && gc_state.gray_capacity > GC_GRAY_KEEP) {
+        scheme_free(gc_state.gray);
+        gc_state.gray = NULL;
+        gc_state.gray_capacity = 0;
+    }
+}
+
+void gc_read_weak(SchemeObject* obj) {
+    if (gc_state.phase == GC_PHASE_MARKING) {
+        mark_object(obj);
+    } else if (gc_state.phase == GC_PHASE_SWEEPING && obj->generation == GC_OLD && !obj->marked) {
+        // The pending sweep would otherwise reclaim it
+        HeapChunk* chunk = find_chunk((const char*)obj);
+        if (chunk && !chunk->swept) {
+            obj->marked = true;
+        }
+    }
+}
+
+// Sweep phase
+
+// Cells promoted while an incremental cycle is in progress were allocated
+// after its snapshot and are live, so they stay marked (black) until the
+// cycle's sweep has passed their chunk
+static bool promote_marked(const HeapChunk* chunk) {
+    return gc_state.phase == GC_PHASE_MARKING ||
+        (gc_state.phase == GC_PHASE_SWEEPING && !chunk->swept);
+}
+
+// Reclaim an unmarked cell, or clear the mark of a surviving one and
+// promote it to the old generation. Returns the bytes reclaimed.
+static size_t sweep_cell(HeapChunk* chunk, size_t index) {
+    char* cell = chunk->cells + index * chunk->cell_size;
+
+    if (chunk->kind == GC_CELL_OBJECT) {
+        SchemeObject* obj = (SchemeObject*)cell;
+        if (obj->marked) {
+            obj->marked = false;
+            if (obj->generation == GC_YOUNG) {
+                obj->generation = GC_OLD;
+                obj->marked = promote_marked(chunk);
+                gc_state.promoted_since_full++;
+                gc_state.stats.promoted_cells++;
+            }
+            return 0;
+        }
+    } else if (chunk->kind == GC_CELL_PAIR) {
+        uint8_t* flags = gc_pair_flags((SchemePair*)cell);
+        if (*flags & GC_PAIR_MARKED) {
+            *flags &= (uint8_t)~GC_PAIR_MARKED;
+            if (!(*flags & GC_PAIR_OLD)) {
+                *flags |= GC_PAIR_OLD;
+                if (promote_marked(chunk)) {
+                    *flags |= GC_PAIR_MARKED;
+                }
+                gc_state.promoted_since_full++;
+                gc_state.stats.promoted_cells++;
+            }
+            return 0;
+        }
+        *flags = 0;
+    } else {
+        Environment* env = (Environment*)cell;
+        if (env->marked) {
+            env->marked = false;
+            if (env->generation == GC_YOUNG) {
+                env->generation = GC_OLD;
+                env->marked = promote_marked(chunk);
+                gc_state.promoted_since_full++;
+                gc_state.stats.promoted_cells++;
+            }
+            return 0;
+        }
+    }
+
+    size_t reclaimed = chunk->cell_size;
+    if (chunk->kind == GC_CELL_OBJECT) {
+        reclaimed += finalize_object((SchemeObject*)cell);
+    } else if (chunk->kind == GC_CELL_ENVIRONMENT) {
+        reclaimed += finalize_environment((Environment*)cell);
+    }
+    chunk->in_use[index] = 0;
+    chunk->live_cells--;
+    return reclaimed;
+}
+
+static bool cell_is_young(HeapChunk* chunk, size_t index) {
+    char* cell = chunk->cells + index * chunk->cell_size;
+    if (chunk->kind == GC_CELL_OBJECT) {
+        return ((SchemeObject*)cell)->generation == GC_YOUNG;
+    }
+    if (chunk->kind == GC_CELL_PAIR) {
+        return !(*gc_pair_flags((SchemePair*)cell) & GC_PAIR_OLD);
+    }
+    return ((Environment*)cell)->generation == GC_YOUNG;
+}
+
+// Minor sweep: only the cells allocated since the last collection
+static size_t sweep_young(void) {
+    size_t reclaimed = 0;
+
+    for (size_t i = 0; i < gc_state.young_chunk_count; i++) {
+        HeapChunk* chunk = gc_state.young_chunks[i];
+        for (size_t index = chunk->young_start; index < chunk->cursor; index++) {
+            if (chunk->in_use[index] && cell_is_young(chunk, index)) {
+                reclaimed += sweep_cell(chunk, index);
+            }
+        }
+    }
+
+    return reclaimed;
+}
+
+void sweep_objects(void) {
+    size_t reclaimed = 0;
+
+    for (size_t i = 0; i < gc_state.chunk_count; i++) {
+        HeapChunk* chunk = gc_state.chunks[i];
+        for (size_t index = 0; index < chunk->cell_count; index++) {
+            if (chunk->in_use[index]) {
+                reclaimed += sweep_cell(chunk, index);
+            }
+        }
+    }
+
+    gc_state.stats.last_reclaimed_bytes = reclaimed;
+}
+
+// Rebuild the allocation lists after a collection. Empty chunks beyond the
+// nursery's needs are returned to the system after a full collection.
+static void reset_allocation(bool release_empty) {
+    size_t reserve = gc_state.nursery_size / GC_CELLS_PER_CHUNK + 1;
+    size_t empty = 0;
+    size_t live = 0;
+    size_t kept = 0;
+
+    for (int kind = 0; kind < GC_CELL_KIND_COUNT; kind++) {
+        gc_state.available[kind] = NULL;
+        gc_state.current[kind] = NULL;
+    }
+
+    for (size_t i = 0; i < gc_state.chunk_count; i++) {
+        HeapChunk* chunk = gc_state.chunks[i];
+        chunk->young = false;
+        chunk->cursor = 0;
+        chunk->young_start = 0;
+
+        if (chunk->live_cells == 0 && release_empty && ++empty > reserve) {
+            free_chunk(chunk);
+            continue;
+        }
+
+        live += chunk->live_cells;
+        if (chunk->live_cells < chunk->cell_count) {
+            chunk->next_available = gc_state.available[chunk->kind];
+            gc_state.available[chunk->kind] = chunk;
+        } else {
+            chunk->next_available = NULL;
+        }
+        gc_state.chunks[kept++] = chunk;
+    }
+
+    gc_state.chunk_count = kept;
+    gc_state.young_chunk_count = 0;
+    gc_state.young_allocs = 0;
+    gc_state.stats.live_cells = live;
+}
+
+static void collect(bool full) {
+    // Without a known stack extent the roots are incomplete
+    if (!gc_state.enabled || gc_state.collecting || !gc_state.stack_bottom) {
+        gc_state.young_allocs = 0;
+        return;
+    }
+
+    // A minor collection may run in the middle of an incremental cycle; it
+    // traces only young cells and leaves the cycle's gray cells alone
+    bool resume_marking = gc_incremental_marking;
+    size_t gray_base = gc_state.gray_count;
+    gc_incremental_marking = false;
+    gc_state.collecting = true;
+    gc_state.full_collection = full;
+    double start = gc_now_us();
+
+    mark_roots();
+    drain_mark_stack(gray_base);
+    if (full) {
+        sweep_objects();
+    } else {
+        gc_state.stats.last_reclaimed_bytes = sweep_young();
+    }
+    clear_remembered_set();
+    reset_allocation(full || gc_state.release_empty_pending);
+    gc_state.release_empty_pending = false;
+
+    double pause = gc_now_us() - start;
+    gc_state.stats.collections++;
+    if (full) {
+        gc_state.stats.major_collections++;
+        gc_state.promoted_since_full = 0;
+        // Let the old generation double before the next full collection
+        gc_state.threshold = gc_state.stats.live_cells > gc_state.min_threshold ?
+            gc_state.stats.live_cells : gc_state.min_threshold;
+    } else {
+        gc_state.stats.minor_collections++;
+    }
+    gc_state.stats.total_reclaimed_bytes += gc_state.stats.last_reclaimed_bytes;
+    gc_state.stats.last_pause_us = pause;
+    gc_state.stats.total_pause_us += pause;
+    if (pause > gc_state.stats.max_pause_us) {
+        gc_state.stats.max_pause_us = pause;
+    }
+    gc_state.full_collection = false;
+    gc_state.collecting = false;
+    gc_incremental_marking = resume_marking;
+
+    if (gc_state.verbose) {
+        fprintf(stderr, "GC #%zu (%s): pause %.1f us, reclaimed %zu bytes, %zu live cells\n",
+                gc_state.stats.collections, full ? "full" : "minor", pause,
+                gc_state.stats.last_reclaimed_bytes, gc_state.stats.live_cells);
+    }
+}
+
+// Incremental full collection
+
+static void record_step(double start) {
+    double pause = gc_now_us() - start;
+    gc_state.cycle_steps++;
+    gc_state.stats.incremental_steps++;
+    gc_state.stats.total_step_us += pause;
+    if (pause > gc_state.stats.max_step_us) {
+        gc_state.stats.max_step_us = pause;
+    }
+}
+
+// Called right after a minor collection, so every live cell is old. The
+// roots are shaded in this one pause; from then on the snapshot barrier
+// keeps the snapshot's cells from being hidden by mutation.
+static void start_cycle(void) {
+    if (!gc_state.enabled || !gc_state.stack_bottom) {
+        return;
+    }
+
+    double start = gc_now_us();
+    for (size_t i = 0; i < gc_state.chunk_count; i++) {
+        gc_state.chunks[i]->swept = false;
+    }
+    gc_state.phase = GC_PHASE_MARKING;
+    gc_state.sweep_cursor = 0;
+    gc_state.step_allocs = 0;
+    gc_state.cycle_steps = 0;
+    gc_state.cycle_reclaimed = 0;
+    gc_state.promoted_since_full = 0;
+    gc_state.stats.incremental_cycles++;
+
+    gc_incremental_marking = true;
+    mark_roots();
+    record_step(start);
+}
+
+// Dead old cells may sit in the remembered set; drop them before the sweep
+// frees them under the minor collector's feet
+static void prune_remembered_set(void) {
+    size_t kept = 0;
+    for (size_t i = 0; i < gc_state.remembered_object_count; i++) {
+        if (gc_state.remembered_objects[i]->marked) {
+            gc_state.remembered_objects[kept++] = gc_state.remembered_objects[i];
+        }
+    }
+    gc_state.remembered_object_count = kept;
+
+    kept = 0;
+    for (size_t i = 0; i < gc_state.remembered_env_count; i++) {
+        if (gc_state.remembered_envs[i]->marked) {
+            gc_state.remembered_envs[kept++] = gc_state.remembered_envs[i];
+        }
+    }
+    gc_state.remembered_env_count = kept;
+
+    kept = 0;
+    for (size_t i = 0; i < gc_state.remembered_pair_count; i++) {
+        if (*gc_pair_flags(gc_state.remembered_pairs[i]) & GC_PAIR_MARKED) {
+            gc_state.remembered_pairs[kept++] = gc_state.remembered_pairs[i];
+        }
+    }
+    gc_state.remembered_pair_count = kept;
+}
+
+// Sweep the old cells of one chunk; young ones belong to minor collections
+static void sweep_chunk_old(HeapChunk* chunk) {
+    for (size_t index = 0; index < chunk->cell_count; index++) {
+        if (chunk->in_use[index] && !cell_is_young(chunk, index)) {
+            gc_state.cycle_reclaimed += sweep_cell(chunk, index);
+        }
+    }
+    chunk->swept = true;
+}
+
+static void finish_cycle(void) {
+    size_t live = 0;
+    for (size_t i = 0; i < gc_state.chunk_count; i++) {
+        live += gc_state.chunks[i]->live_cells;
+    }
+
+    gc_state.phase = GC_PHASE_IDLE;
+    gc_state.release_empty_pending = true;
+    gc_state.stats.live_cells = live;
+    gc_state.stats.collections++;
+    gc_state.stats.major_collections++;
+    gc_state.stats.last_reclaimed_bytes = gc_state.cycle_reclaimed;
+    gc_state.stats.total_reclaimed_bytes += gc_state.cycle_reclaimed;
+    gc_state.threshold = live > gc_state.min_threshold ? live : gc_state.min_threshold;
+
+    if (gc_state.verbose) {
+        fprintf(stderr, "GC #%zu (incremental): %zu steps, reclaimed %zu bytes, %zu live cells\n",
+                gc_state.stats.collections, gc_state.cycle_steps,
+                gc_state.cycle_reclaimed, live);
+    }
+}
+
+// Advance the cycle until the pause budget is spent, or to its end
+static void incremental_step(bool complete) {
+    if (!gc_state.enabled || gc_state.collecting) {
+        return;
+    }
+
+    double start = gc_now_us();
+    double deadline = start + gc_state.pause_budget_us;
+    bool out_of_time = false;
+
+    if (gc_state.phase == GC_PHASE_MARKING) {
+        size_t scanned = 0;
+        while (gc_state.gray_count > 0) {
+            scan_gray(gc_state.gray[--gc_state.gray_count]);
+            if (!complete && ++scanned % GC_STEP_CHECK == 0 && gc_now_us() >= deadline) {
+                out_of_time = true;
+                break;
+            }
+        }
+        if (gc_state.gray_count == 0) {
+            gc_incremental_marking = false;
+            gc_state.phase = GC_PHASE_SWEEPING;
+            prune_remembered_set();
+        }
+    }
+
+    if (gc_state.phase == GC_PHASE_SWEEPING && !out_of_time) {
+        // Chunks added meanwhile shift the array, but the swept flags keep
+        // any chunk from being swept twice
+        while (gc_state.sweep_cursor < gc_state.chunk_count) {
+            HeapChunk* chunk = gc_state.chunks[gc_state.sweep_cursor++];
+            if (!chunk->swept) {
+                sweep_chunk_old(chunk);
+                if (!complete && gc_now_us() >= deadline) {
+                    break;
+                }
+            }
+        }
+        if (gc_state.sweep_cursor >= gc_state.chunk_count) {
+            finish_cycle();
+        }
+    }
+
+    record_step(start);
+}
+
+void gc_run(void) {
+    // Finish any cycle in progress first: its marks and lazy sweep assume
+    // the heap is not collected under them
+    if (gc_state.phase != GC_PHASE_IDLE) {
+        incremental_step(true);
+    }
+    collect(true);
+}
+
+void gc_run_minor(void) {
+    collect(false);
+    if (gc_state.phase == GC_PHASE_IDLE && gc_state.promoted_since_full >= gc_state.threshold) {
+        if (gc_state.pause_budget_us > 0) {
+            start_cycle();
+        } else {
+            collect(true);
+        }
+    }
+}
+
+void gc_enable(void) {
+    gc_state.enabled = true;
+}
+
+void gc_disable(void) {
+    gc_state.enabled = false;
+}
+
+bool gc_is_enabled(void) {
+    return gc_state.enabled;
+}
+
+void gc_set_threshold(size_t cells) {
+    gc_state.min_threshold = cells > 0 ? cells : 1;
+    gc_state.threshold = gc_state.min_threshold;
+}
+
+size_t gc_get_threshold(void) {
+    return gc_state.threshold;
+}
+
+void gc_set_nursery_size(size_t cells) {
+    gc_state.nursery_size = cells > 0 ? cells : 1;
+}
+
+size_t gc_get_nursery_size(void) {
+    return gc_state.nursery_size;
+}
+
+void gc_set_pause_budget(double us) {
+    gc_state.pause_budget_us = us > 0 ? us : 0;
+}
+
+double gc_get_pause_budget(void) {
+    return gc_state.pause_budget_us;
+}
+
+void gc_set_verbose(bool enabled) {
+    gc_state.verbose = enabled;
+}
+
+const GCStats* gc_get_stats(void) {
+    return &gc_state.stats;
+}
+
+void gc_print_stats(FILE* out) {
+    const GCStats* stats = &gc_state.stats;
+    fprintf(out, "  GC collections: %zu (%zu minor, %zu full)\n",
+            stats->collections, stats->minor_collections, stats->major_collections);
+    fprintf(out, "  Nursery size: %zu cells\n", gc_state.nursery_size);
+    fprintf(out, "  Full GC threshold: %zu promoted cells\n", gc_state.threshold);
+    fprintf(out, "  Promoted cells: %zu\n", stats->promoted_cells);
+    fprintf(out, "  Heap size: %zu bytes\n", stats->heap_bytes);
+    fprintf(out, "  Live cells: %zu\n", stats->live_cells);
+    fprintf(out, "  Cells allocated: %zu\n", stats->cells_allocated);
+    fprintf(out, "  Bytes reclaimed: %zu (last: %zu)\n",
+            stats->total_reclaimed_bytes, stats->last_reclaimed_bytes);
+    fprintf(out, "  GC pause: total %.1f us, max %.1f us, last %.1f us\n",
+            stats->total_pause_us, stats->max_pause_us, stats->last_pause_us);
+    if (gc_state.pause_budget_us > 0) {
+        fprintf(out, "  Incremental GC: budget %.1f us, %zu cycles, %zu steps\n",
+                gc_state.pause_budget_us, stats->incremental_cycles, stats->incremental_steps);
+        fprintf(out, "  GC step pause: total %.1f us, max %.1f us, avg %.1f us\n",
+                stats->total_step_us, stats->max_step_us,
+                stats->incremental_steps ? stats->total_step_us / (double)stats->incremental_steps : 0.0);
+    }
+}
@@ -7,11 +7,15 @@ static struct {
 } eval_error_state = {EVAL_OK, NULL};
 
 void set_eval_error(EvalError error, const char* message) {
+    if (error != EVAL_ESCAPE) {
+        signal_error(message);
+    }
     eval_error_state.error = error;
     if (eval_error_state.message) {
         scheme_free(eval_error_state.message);
     }
     eval_error_state.message = message ? scheme_strdup(message) : NULL;
+    throw_error();
 }
 
 void print_eval_error(FILE* out) {
@@ -21,6 +25,10 @@ void print_eval_error(FILE* out) {
     }
 }
 
+EvalError get_eval_error(void) {
+    return eval_error_state.error;
+}
+
 bool has_eval_error(void) {
     return eval_error_state.error != EVAL_OK;
 }
@@ -33,6 +41,159 @@ void clear_eval_error(void) {
     }
 }
 
+// Inline cache statistics for global references
+size_t global_cache_hits = 0;
+static size_t global_cache_misses = 0;
+
+void print_interpreter_stats(FILE* out) {
+    size_t lookups = global_cache_hits + global_cache_misses;
+    fprintf(out, "  Global reference caches: %zu hits, %zu misses (%.1f%% hit rate)\n",
+            global_cache_hits, global_cache_misses,
+            lookups ? 100.0 * (double)global_cache_hits / (double)lookups : 0.0);
+}
+
+// Argument stack, kept as a chain of blocks so that pushing a frame never
+// moves the frames beneath it. Emptied blocks are kept for reuse.
+#define ARG_BLOCK_SLOTS 4096
+
+typedef struct ArgBlock {
+    struct ArgBlock* prev;
+    struct ArgBlock* next;
+    size_t capacity;
+    size_t top;
+    SchemeObject* slots[];
+} ArgBlock;
+
+static ArgBlock* arg_stack = NULL;
+
+static ArgBlock* new_arg_block(ArgBlock* prev, size_t capacity) {
+    ArgBlock* block = (ArgBlock*)scheme_malloc(sizeof(ArgBlock) + capacity * sizeof(SchemeObject*));
+    block->prev = prev;
+    block->next = NULL;
+    block->capacity = capacity;
+    block->top = 0;
+    return block;
+}
+
+SchemeObject** push_arguments(int count) {
+    size_t n = (size_t)count;
+    if (!arg_stack) {
+        arg_stack = new_arg_block(NULL, n > ARG_BLOCK_SLOTS ? n : ARG_BLOCK_SLOTS);
+    } else if (arg_stack->top + n > arg_stack->capacity) {
+        ArgBlock* next = arg_stack->next;
+        if (next && next->capacity < n) {
+            // Too small for this frame; drop the cached blocks
+            while (next) {
+                ArgBlock* after = next->next;
+                scheme_free(next);
+                next = after;
+            }
+        }
+        if (!next) {
+            next = new_arg_block(arg_stack, n > ARG_BLOCK_SLOTS ? n : ARG_BLOCK_SLOTS);
+            arg_stack->next = next;
+        }
+        arg_stack = next;
+    }
+    
+    // Slots the collector may see before they are filled must not hold
+    // stale pointers
+    SchemeObject** frame = arg_stack->slots + arg_stack->top;
+    for (size_t i = 0; i < n; i++) {
+        frame[i] = NULL;
+    }
+    arg_stack->top += n;
+    return frame;
+}
+
+void pop_arguments(int count) {
+    arg_stack->top -= (size_t)count;
+    if (arg_stack->top == 0 && arg_stack->prev) {
+        arg_stack = arg_stack->prev;
+    }
+}
+
+ArgumentMark mark_arguments(void) {
+    ArgumentMark mark = {arg_stack, arg_stack ? arg_stack->top : 0};
+    return mark;
+}
+
+void unwind_arguments(ArgumentMark mark) {
+    if (!arg_stack) {
+        return;
+    }
+    if (mark.block) {
+        arg_stack = mark.block;
+        arg_stack->top = mark.top;
+    } else {
+        // Nothing was pushed yet
+        while (arg_stack->prev) {
+            arg_stack = arg_stack->prev;
+        }
+        arg_stack->top = 0;
+    }
+
+    // Blocks above are kept for reuse, empty
+    for (ArgBlock* block = arg_stack->next; block; block = block->next) {
+        block->top = 0;
+    }
+}
+
+void mark_argument_stack(void) {
+    for (ArgBlock* block = arg_stack; block; block = block->prev) {
+        for (size_t i = 0; i < block->top; i++) {
+            mark_object(block->slots[i]);
+        }
+    }
+}
+
+void cleanup_argument_stack(void) {
+    if (!arg_stack) {
+        return;
+    }
+    
+    ArgBlock* block = arg_stack;
+    while (block->prev) {
+        block = block->prev;
+    }
+    while (block) {
+        ArgBlock* next = block->next;
+        scheme_free(block);
+        block = next;
+    }
+    arg_stack = NULL;
+}
+
+// Slow path of a global reference: look the name up and, if it is bound
+// in the global frame, remember the binding cell in the reference
+SchemeObject* lookup_global_ref(SchemeObject* ref, Environment* env) {
+    global_cache_misses++;
+    
+    SchemeObject* symbol = ref->value.global_symbol;
+    Binding* binding = lookup_global_binding(env, symbol);
+    if (binding && binding->value) {
+        ref->value.global_binding = binding;
+        ref->value.global_version = binding_version;
+        return binding->value;
+    }
+    
+    SchemeObject* value = lookup_symbol(env, symbol);
+    if (!value) {
+        set_eval_error(EVAL_ERROR_UNBOUND_VARIABLE, symbol->value.symbol_name);
+        return NULL;
+    }
+    return value;
+}
+
+SchemeObject* unassigned_variable(Environment* env, SchemeObject* name) {
+    SchemeObject* value = lookup_symbol(env, name);
+    if (!value) {
+        set_eval_error(EVAL_ERROR_UNBOUND_VARIABLE, name->value.symbol_name);
+        return NULL;
+    }
+    return value;
+}
+
 bool is_self_evaluating(SchemeObject* expr) {
     return expr && (is_number(expr) || is_string(expr) || is_boolean(expr) || is_char(expr) || is_nil(expr));
 }
@@ -55,30 +216,37 @@ bool is_special_form(SchemeObject* expr) {
         return false;
     }
     
-    const char* name = operator->value.symbol_name;
-    return strcmp(name, "quote") == 0 ||
-           strcmp(name, "if") == 0 ||
-           strcmp(name, "define") == 0 ||
-           strcmp(name, "set!") == 0 ||
-           strcmp(name, "lambda") == 0 ||
-           strcmp(name, "begin") == 0 ||
-           strcmp(name, "cond") == 0 ||
-           strcmp(name, "and") == 0 ||
-           strcmp(name, "or") == 0 ||
-           strcmp(name, "let") == 0 ||
-           strcmp(name, "let*") == 0 ||
-           strcmp(name, "letrec") == 0;
+    return operator == SYMBOL_QUOTE ||
+           operator == SYMBOL_IF ||
+           operator == SYMBOL_DEFINE ||
+           operator == SYMBOL_SET ||
+           operator == SYMBOL_LAMBDA ||
+           operator == SYMBOL_BEGIN ||
+           operator == SYMBOL_COND ||
+           operator == SYMBOL_AND ||
+           operator == SYMBOL_OR ||
+           operator == SYMBOL_LET ||
+           operator == SYMBOL_LET_STAR ||
+           operator == SYMBOL_LETREC;
 }
 
 SchemeObject* eval_expression(SchemeObject* expr, Environment* env) {
-    if (has_eval_error()) {
-        return NULL;
-    }
-    
     if (!expr) {
         return SCHEME_NIL_OBJECT;
     }
     
+    // Local variables, resolved to a frame slot
+    if (is_local_ref(expr)) {
+        Environment* frame = frame_at_depth(env, expr->value.local_depth);
+        SchemeObject* value = frame->slots[expr->value.local_slot];
+        return value ? value : unbound_local(frame, expr->value.local_slot);
+    }
+    
+    // Global variables, through the reference's inline cache
+    if (is_global_ref(expr)) {
+        return eval_global_ref(expr, env);
+    }
+    
     // Self-evaluating expressions
     if (is_self_evaluating(expr)) {
         return expr;
@@ -86,7 +254,7 @@ SchemeObject* eval_expression(SchemeObject* expr, Environment* env) {
     
     // Variables
     if (is_variable(expr)) {
-        SchemeObject* value = lookup_variable(env, expr->value.symbol_name);
+        SchemeObject* value = lookup_symbol(env, expr);
         if (!value) {
             set_eval_error(EVAL_ERROR_UNBOUND_VARIABLE, expr->value.symbol_name);
             return NULL;
@@ -100,79 +268,100 @@ SchemeObject* eval_expression(SchemeObject* expr, Environment* env) {
         SchemeObject* operands = cdr(expr);
         
         if (is_symbol(operator)) {
-            const char* name = operator->value.symbol_name;
-            
-            // Special forms
-            if (strcmp(name, "quote") == 0) {
+            // Special forms; symbols are interned, so compare pointers
+            if (operator == SYMBOL_QUOTE) {
                 return eval_quote(operands, env);
-            } else if (strcmp(name, "if") == 0) {
+            } else if (operator == SYMBOL_IF) {
                 return eval_if(operands, env);
-            } else if (strcmp(name, "define") == 0) {
+            } else if (operator == SYMBOL_DEFINE) {
                 return eval_define(operands, env);
-            } else if (strcmp(name, "set!") == 0) {
+            } else if (operator == SYMBOL_SET) {
                 return eval_set(operands, env);
-            } else if (strcmp(name, "lambda") == 0) {
+            } else if (operator == SYMBOL_LAMBDA) {
                 return eval_lambda(operands, env);
-            } else if (strcmp(name, "begin") == 0) {
+            } else if (operator == SYMBOL_BEGIN) {
                 return eval_begin(operands, env);
-            } else if (strcmp(name, "and") == 0) {
+            } else if (operator == SYMBOL_AND) {
                 return eval_and(operands, env);
-            } else if (strcmp(name, "or") == 0) {
+            } else if (operator == SYMBOL_OR) {
                 return eval_or(operands, env);
-            } else if (strcmp(name, "cond") == 0) {
+            } else if (operator == SYMBOL_COND) {
                 return eval_cond(operands, env);
-            } else if (strcmp(name, "let") == 0) {
+            } else if (operator == SYMBOL_LET) {
                 return eval_let(operands, env);
-            } else if (strcmp(name, "let*") == 0) {
+            } else if (operator == SYMBOL_LET_STAR) {
                 return eval_let_star(operands, env);
-            } else if (strcmp(name, "letrec") == 0) {
+            } else if (operator == SYMBOL_LETREC) {
                 return eval_letrec(operands, env);
+            } else if (operator == SYMBOL_RESOLVED_LAMBDA) {
+                return eval_resolved_lambda(operands, env);
+            } else if (operator == SYMBOL_RESOLVED_LET ||
+                       operator == SYMBOL_RESOLVED_LET_STAR ||
+                       operator == SYMBOL_RESOLVED_LETREC) {
+                return eval_resolved_let(operator, operands, env);
+            } else if (operator == SYMBOL_RESOLVED_LET_VALUES) {
+                return eval_resolved_let_values(operands, env);
             }
         }
         
         // Application
         SchemeObject* procedure = eval_expression(operator, env);
-        if (has_eval_error()) {
-            return NULL;
+        // Evaluate arguments into a frame on the argument stack
+        int argc = 0;
+        for (SchemeObject* current = operands; is_pair(current); current = cdr(current)) {
+            argc++;
         }
         
-        // Evaluate arguments
-        SchemeObject* args = SCHEME_NIL_OBJECT;
+        SchemeObject** argv = push_arguments(argc);
         SchemeObject* current_arg = operands;
-        SchemeObject* last_pair = NULL;
-        
-        while (current_arg && is_pair(current_arg)) {
-            SchemeObject* arg_value = eval_expression(car(current_arg), env);
-            if (has_eval_error()) {
-                return NULL;
-            }
-            
-            SchemeObject* new_pair = cons(arg_value, SCHEME_NIL_OBJECT);
-            if (last_pair) {
-                set_cdr(last_pair, new_pair);
-            } else {
-                args = new_pair;
-            }
-            last_pair = new_pair;
-            
+        for (int i = 0; i < argc; i++) {
+            argv[i] = eval_expression(car(current_arg), env);
             current_arg = cdr(current_arg);
         }
         
-        return apply_procedure(procedure, args, env);
+        SchemeObject* result = apply_procedure_argv(procedure, argc, argv, env);
+        pop_arguments(argc);
+        return result;
     }
     
     set_eval_error(EVAL_ERROR_INVALID_SYNTAX, "Invalid expression");
     return NULL;
 }
 
+static ExecutionEngine execution_engine = ENGINE_TREE;
+
+void set_execution_engine(ExecutionEngine engine) {
+    execution_engine = engine;
+}
+
+SchemeObject* eval_toplevel(SchemeObject* expr, Environment* env) {
+    // An error unwinds to here, and leaves the form's result NULL with the
+    // error recorded
+    CatchFrame catcher;
+    push_catch(&catcher);
+    if (setjmp(catcher.jump)) {
+        reset_control();
+        return NULL;
+    }
+
+    SchemeObject* result = eval_form(expr, env);
+    pop_catch(&catcher);
+    return result;
+}
+
+SchemeObject* eval_form(SchemeObject* expr, Environment* env) {
+    SchemeObject* resolved = resolve_expression(expr);
+    if (execution_engine == ENGINE_VM) {
+        return vm_execute(compile_bytecode(resolved), env);
+    }
+    return run_code(analyze_expression(resolved), env);
+}
+
 SchemeObject* eval_sequence(SchemeObject* exprs, Environment* env) {
     SchemeObject* result = SCHEME_NIL_OBJECT;
     
     while (exprs && is_pair(exprs)) {
         result = eval_expression(car(exprs), env);
-        if (has_eval_error()) {
-            return NULL;
-        }
         exprs = cdr(exprs);
     }
     
@@ -210,13 +399,8 @@ SchemeObject* eval_if(SchemeObject* args, Environment* env) {
     SchemeObject* else_expr = (args && is_pair(args)) ? car(args) : SCHEME_NIL_OBJECT;
     
     SchemeObject* test_result = eval_expression(test, env);
-    if (has_eval_error()) {
-        return NULL;
-    }
-    
     // In Scheme, only #f is false
-    bool is_true = !(test_result == SCHEME_FALSE_OBJECT ||
-                    (is_boolean(test_result) && !test_result->value.boolean_value));
+    bool is_true = test_result != SCHEME_FALSE_OBJECT;
     
     if (is_true) {
         return eval_expression(then_expr, env);
@@ -234,7 +418,12 @@ SchemeObject* eval_define(SchemeObject* args, Environment* env) {
     SchemeObject* first = car(args);
     SchemeObject* rest = cdr(args);
     
-    if (is_symbol(first)) {
+    if (is_local_ref(first)) {
+        // Internal define the resolver gave a slot: (define local value)
+        SchemeObject* value = eval_expression(car(rest), env);
+        set_frame_slot(frame_at_depth(env, first->value.local_depth), first->value.local_slot, value);
+        return SCHEME_NIL_OBJECT;
+    } else if (is_symbol(first)) {
         // Variable definition: (define var value)
         if (!rest || !is_pair(rest) || cdr(rest) != SCHEME_NIL_OBJECT) {
             set_eval_error(EVAL_ERROR_WRONG_ARITY, "define expects exactly 2 arguments for variable");
@@ -242,11 +431,7 @@ SchemeObject* eval_define(SchemeObject* args, Environment* env) {
         }
         
         SchemeObject* value = eval_expression(car(rest), env);
-        if (has_eval_error()) {
-            return NULL;
-        }
-        
-        define_variable(env, first->value.symbol_name, value);
+        define_symbol(env, first, value);
         return SCHEME_NIL_OBJECT;
     } else if (is_pair(first)) {
         // Function definition: (define (name args...) body...)
@@ -259,7 +444,7 @@ SchemeObject* eval_define(SchemeObject* args, Environment* env) {
         }
         
         SchemeObject* procedure = make_procedure(params, rest, env);
-        define_variable(env, name->value.symbol_name, procedure);
+        define_symbol(env, name, procedure);
         return SCHEME_NIL_OBJECT;
     } else {
         set_eval_error(EVAL_ERROR_INVALID_SYNTAX, "define first argument must be symbol or list");
@@ -279,6 +464,49 @@ SchemeObject* eval_lambda(SchemeObject* args, Environment* env) {
     return make_procedure(params, body, env);
 }
 
+// (lambda layout params body...): the closure builds a slot frame per call
+SchemeObject* eval_resolved_lambda(SchemeObject* args, Environment* env) {
+    SchemeObject* layout = car(args);
+    SchemeObject* rest = cdr(args);
+    SchemeObject* procedure = make_procedure(car(rest), cdr(rest), env);
+    procedure->value.procedure.layout = layout;
+    return procedure;
+}
+
+// (let layout ((local init) ...) body...), and likewise let* and letrec.
+// Only let evaluates its initialisers outside the new frame.
+SchemeObject* eval_resolved_let(SchemeObject* kind, SchemeObject* args, Environment* env) {
+    SchemeObject* bindings = car(cdr(args));
+    SchemeObject* body = cdr(cdr(args));
+    Environment* frame = make_frame(env, car(args));
+    
+    if (kind == SYMBOL_RESOLVED_LETREC) {
+        // Every variable is bound, to (), while the initialisers run
+        for (SchemeObject* b = bindings; is_pair(b); b = cdr(b)) {
+            frame->slots[car(car(b))->value.local_slot] = SCHEME_NIL_OBJECT;
+        }
+    }
+    
+    Environment* init_env = kind == SYMBOL_RESOLVED_LET ? env : frame;
+    for (SchemeObject* b = bindings; is_pair(b); b = cdr(b)) {
+        SchemeObject* binding = car(b);
+        SchemeObject* value = eval_expression(car(cdr(binding)), init_env);
+        set_frame_slot(frame, car(binding)->value.local_slot, value);
+    }
+    
+    return eval_sequence(body, frame);
+}
+
+// (let-values layout ((targets init) ...) body...)
+SchemeObject* eval_resolved_let_values(SchemeObject* args, Environment* env) {
+    Environment* frame = make_frame(env, car(args));
+    for (SchemeObject* c = car(cdr(args)); is_pair(c); c = cdr(c)) {
+        SchemeObject* clause = car(c);
+        bind_values(frame, car(clause), eval_expression(car(cdr(clause)), env));
+    }
+    return eval_sequence(cdr(cdr(args)), frame);
+}
+
 SchemeObject* eval_begin(SchemeObject* args, Environment* env) {
     if (!args) {
         return SCHEME_NIL_OBJECT;
@@ -288,23 +516,47 @@ SchemeObject* eval_begin(SchemeObject* args, Environment* env) {
 }
 
 SchemeObject* apply_procedure(SchemeObject* proc, SchemeObject* args, Environment* env) {
+    int argc = (int)list_length(args);
+    SchemeObject** argv = push_arguments(argc);
+    for (int i = 0; i < argc; i++) {
+        argv[i] = car(args);
+        args = cdr(args);
+    }
+    
+    SchemeObject* result = apply_procedure_argv(proc, argc, argv, env);
+    pop_arguments(argc);
+    return result;
+}
+
+SchemeObject* apply_procedure_argv(SchemeObject* proc, int argc, SchemeObject** argv, Environment* env) {
     if (!proc) {
         set_eval_error(EVAL_ERROR_WRONG_TYPE, "Cannot apply null procedure");
         return NULL;
     }
     
     if (is_primitive(proc)) {
-        return proc->value.primitive(args, env);
+        return proc->value.primitive(argc, argv, env);
     } else if (is_procedure(proc)) {
-        Environment* new_env = extend_environment(
+        if (is_bytecode(proc->value.procedure.code)) {
+            return vm_apply(proc, argc, argv);
+        }
+        
+        if (proc->value.procedure.code) {
+            return run_procedure(proc, argc, argv);
+        }
+        
+        check_stack_depth();
+        Environment* new_env = extend_environment_argv(
             proc->value.procedure.closure,
             proc->value.procedure.parameters,
-            args
+            proc->value.procedure.layout,
+            argc, argv
         );
-        
         SchemeObject* result = eval_sequence(proc->value.procedure.body, new_env);
         release_environment(new_env);
         return result;
+    } else if (is_continuation(proc)) {
+        return throw_to_continuation(proc, argc, argv);
     } else {
         set_eval_error(EVAL_ERROR_WRONG_TYPE, "Object is not a procedure");
         return NULL;
@@ -342,7 +594,7 @@ void run_repl(Environment* env) {
         if (has_parse_error(parser)) {
             print_parse_error(parser, stderr);
         } else if (expr) {
-            SchemeObject* result = eval_expression(expr, env);
+            SchemeObject* result = eval_toplevel(expr, env);
             if (has_eval_error()) {
                 print_eval_error(stderr);
             } else {
@@ -382,7 +634,7 @@ SchemeObject* eval_cond(SchemeObject* args, Environment* env) {
         SchemeObject* exprs = cdr(clause);
         
         // Handle (else ...) clause
-        if (is_symbol(test) && strcmp(test->value.symbol_name, "else") == 0) {
+        if (test == SYMBOL_ELSE) {
             if (!is_nil(cdr(current))) {
                 set_eval_error(EVAL_ERROR_INVALID_SYNTAX, "else clause must be last in cond");
                 return NULL;
@@ -393,12 +645,8 @@ SchemeObject* eval_cond(SchemeObject* args, Environment* env) {
         
         // Evaluate the test
         SchemeObject* test_result = eval_expression(test, env);
-        if (has_eval_error()) {
-            return NULL;
-        }
-        
         // If test is true (anything other than #f)
-        if (!is_boolean(test_result) || test_result->value.boolean_value) {
+        if (!is_boolean(test_result) || boolean_value(test_result)) {
             if (is_nil(exprs)) {
                 // No expressions, return the test result
                 return test_result;
@@ -432,12 +680,8 @@ SchemeObject* eval_and(SchemeObject* args, Environment* env) {
         }
         
         result = eval_expression(car(current), env);
-        if (has_eval_error()) {
-            return NULL;
-        }
-        
         // If result is #f, short-circuit and return #f
-        if (is_boolean(result) && !result->value.boolean_value) {
+        if (is_boolean(result) && !boolean_value(result)) {
             return SCHEME_FALSE_OBJECT;
         }
         
@@ -464,12 +708,8 @@ SchemeObject* eval_or(SchemeObject* args, Environment* env) {
         }
         
         SchemeObject* result = eval_expression(car(current), env);
-        if (has_eval_error()) {
-            return NULL;
-        }
-        
         // If result is not #f, short-circuit and return it
-        if (!is_boolean(result) || result->value.boolean_value) {
+        if (!is_boolean(result) || boolean_value(result)) {
             return result;
         }
         
@@ -521,12 +761,8 @@ SchemeObject* eval_let(SchemeObject* args, Environment* env) {
         
         // Evaluate the value in the original environment
         SchemeObject* value = eval_expression(val_expr, env);
-        if (has_eval_error()) {
-            return NULL;
-        }
-        
         // Bind in the new environment
-        define_variable(let_env, var->value.symbol_name, value);
+        define_symbol(let_env, var, value);
         
         current_binding = cdr(current_binding);
     }
@@ -576,12 +812,8 @@ SchemeObject* eval_let_star(SchemeObject* args, Environment* env) {
         
         // Evaluate the value in the current environment (includes previous bindings)
         SchemeObject* value = eval_expression(val_expr, current_env);
-        if (has_eval_error()) {
-            return NULL;
-        }
-        
         // Bind in the current environment
-        define_variable(current_env, var->value.symbol_name, value);
+        define_symbol(current_env, var, value);
         
         current_binding = cdr(current_binding);
     }
@@ -628,7 +860,7 @@ SchemeObject* eval_letrec(SchemeObject* args, Environment* env) {
         }
         
         // Bind to nil initially (unspecified value)
-        define_variable(letrec_env, var->value.symbol_name, SCHEME_NIL_OBJECT);
+        define_symbol(letrec_env, var, SCHEME_NIL_OBJECT);
         
         current_binding = cdr(current_binding);
     }
@@ -642,12 +874,8 @@ SchemeObject* eval_letrec(SchemeObject* args, Environment* env) {
         
         // Evaluate the value in the environment with all variables bound
         SchemeObject* value = eval_expression(val_expr, letrec_env);
-        if (has_eval_error()) {
-            return NULL;
-        }
-        
         // Update the binding
-        set_variable(letrec_env, var->value.symbol_name, value);
+        set_symbol(letrec_env, var, value);
         
         current_binding = cdr(current_binding);
     }
@@ -665,17 +893,19 @@ SchemeObject* eval_set(SchemeObject* args, Environment* env) {
     SchemeObject* var = car(args);
     SchemeObject* value_expr = car(cdr(args));
     
-    if (!is_symbol(var)) {
+    if (!is_symbol(var) && !is_local_ref(var)) {
         set_eval_error(EVAL_ERROR_INVALID_SYNTAX, "set! first argument must be a symbol");
         return NULL;
     }
     
     SchemeObject* value = eval_expression(value_expr, env);
-    if (!value) {
-        return NULL; // Error already set
+    
+    if (is_local_ref(var)) {
+        set_frame_slot(frame_at_depth(env, var->value.local_depth), var->value.local_slot, value);
+        return SCHEME_NIL_OBJECT;
     }
     
-    if (!set_variable_if_exists(env, var->value.symbol_name, value)) {
+    if (!set_symbol_if_exists(env, var, value)) {
         set_eval_error(EVAL_ERROR_RUNTIME, "set! variable not defined");
         return NULL;
     }
@@ -0,0 +1,722 @@
+#include "rscheme.h"
+#include <stddef.h>
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define JIT_SUPPORTED 1
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef JIT_SUPPORTED
+uint64_t jit_threshold = JIT_DEFAULT_THRESHOLD;
+#else
+uint64_t jit_threshold = 0;
+#endif
+
+static uint64_t configured_threshold = JIT_DEFAULT_THRESHOLD;
+static bool enabled = true;
+
+// Every body compiled, in order, for the statistics
+static JitCode* compiled = NULL;
+static JitCode** compiled_tail = &compiled;
+
+void jit_set_enabled(bool on) {
+    enabled = on;
+    jit_set_threshold(configured_threshold);
+}
+
+void jit_set_threshold(uint64_t threshold) {
+    configured_threshold = threshold;
+#ifdef JIT_SUPPORTED
+    jit_threshold = enabled ? threshold : 0;
+#endif
+}
+
+#ifdef JIT_SUPPORTED
+
+// Assembler. Only the handful of instruction forms the code generator
+// needs, all on 64-bit operands unless noted.
+
+enum { RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15 };
+
+// Condition codes; a condition's inverse differs in the low bit
+enum { CC_O = 0x0, CC_E = 0x4, CC_NE = 0x5, CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF };
+
+// The /digit of the immediate group-1 instructions
+enum { ALU_ADD = 0, ALU_OR = 1, ALU_AND = 4, ALU_SUB = 5, ALU_CMP = 7 };
+
+typedef struct {
+    uint8_t* code;
+    int length;
+    int capacity;
+    int depth;                     // 8-byte pushes since the stack was aligned
+    int compiled_nodes;
+    int called_nodes;
+} Assembler;
+
+static void emit_byte(Assembler* a, uint8_t byte) {
+    if (a->length == a->capacity) {
+        a->capacity = a->capacity ? a->capacity * 2 : 512;
+        a->code = (uint8_t*)scheme_realloc(a->code, (size_t)a->capacity);
+    }
+    a->code[a->length++] = byte;
+}
+
+static void emit_u32(Assembler* a, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        emit_byte(a, (uint8_t)(value >> (8 * i)));
+    }
+}
+
+static void emit_u64(Assembler* a, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        emit_byte(a, (uint8_t)(value >> (8 * i)));
+    }
+}
+
+// REX prefix: W for 64-bit operands, and the high bits of the ModRM reg
+// and rm fields; omitted when it would be empty
+static void emit_rex(Assembler* a, bool wide, int reg, int rm) {
+    uint8_t rex = (uint8_t)(0x40 | (wide ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0));
+    if (rex != 0x40) {
+        emit_byte(a, rex);
+    }
+}
+
+static void emit_modrm_reg(Assembler* a, int reg, int rm) {
+    emit_byte(a, (uint8_t)(0xC0 | (reg & 7) << 3 | (rm & 7)));
+}
+
+// ModRM (and SIB) for [base + disp]
+static void emit_modrm_mem(Assembler* a, int reg, int base, int32_t disp) {
+    int mod = disp == 0 && (base & 7) != RBP ? 0 : disp >= -128 && disp <= 127 ? 1 : 2;
+    emit_byte(a, (uint8_t)(mod << 6 | (reg & 7) << 3 | (base & 7)));
+    if ((base & 7) == RSP) {
+        emit_byte(a, 0x24);
+    }
+    if (mod == 1) {
+        emit_byte(a, (uint8_t)disp);
+    } else if (mod == 2) {
+        emit_u32(a, (uint32_t)disp);
+    }
+}
+
+// op rm, reg: mov (0x89), add (0x01), sub (0x29), and (0x21), cmp (0x39),
+// test (0x85)
+static void emit_rr(Assembler* a, uint8_t op, int rm, int reg) {
+    emit_rex(a, true, reg, rm);
+    emit_byte(a, op);
+    emit_modrm_reg(a, reg, rm);
+}
+
+static void emit_mov(Assembler* a, int dst, int src) {
+    emit_rr(a, 0x89, dst, src);
+}
+
+static void emit_load(Assembler* a, int dst, int base, int32_t disp) {
+    emit_rex(a, true, dst, base);
+    emit_byte(a, 0x8B);
+    emit_modrm_mem(a, dst, base, disp);
+}
+
+static void emit_store(Assembler* a, int base, int32_t disp, int src) {
+    emit_rex(a, true, src, base);
+    emit_byte(a, 0x89);
+    emit_modrm_mem(a, src, base, disp);
+}
+
+// cmp reg, [base + disp]
+static void emit_cmp_mem(Assembler* a, int reg, int base, int32_t disp) {
+    emit_rex(a, true, reg, base);
+    emit_byte(a, 0x3B);
+    emit_modrm_mem(a, reg, base, disp);
+}
+
+// cmp dword [base + disp], imm32
+static void emit_cmp_mem32_imm(Assembler* a, int base, int32_t disp, uint32_t value) {
+    emit_rex(a, false, 0, base);
+    emit_byte(a, 0x81);
+    emit_modrm_mem(a, ALU_CMP, base, disp);
+    emit_u32(a, value);
+}
+
+// add qword [base + disp], imm8
+static void emit_add_mem_imm(Assembler* a, int base, int32_t disp, int8_t value) {
+    emit_rex(a, true, 0, base);
+    emit_byte(a, 0x83);
+    emit_modrm_mem(a, ALU_ADD, base, disp);
+    emit_byte(a, (uint8_t)value);
+}
+
+static void emit_alu_imm(Assembler* a, int op, int reg, int32_t value) {
+    emit_rex(a, true, 0, reg);
+    if (value >= -128 && value <= 127) {
+        emit_byte(a, 0x83);
+        emit_modrm_reg(a, op, reg);
+        emit_byte(a, (uint8_t)value);
+    } else {
+        emit_byte(a, 0x81);
+        emit_modrm_reg(a, op, reg);
+        emit_u32(a, (uint32_t)value);
+    }
+}
+
+static void emit_test_imm(Assembler* a, int reg, int32_t value) {
+    emit_rex(a, true, 0, reg);
+    emit_byte(a, 0xF7);
+    emit_modrm_reg(a, 0, reg);
+    emit_u32(a, (uint32_t)value);
+}
+
+// sar reg, 1 (digit 7) and shl reg, 1 (digit 4)
+static void emit_shift1(Assembler* a, int digit, int reg) {
+    emit_rex(a, true, 0, reg);
+    emit_byte(a, 0xD1);
+    emit_modrm_reg(a, digit, reg);
+}
+
+static void emit_neg(Assembler* a, int reg) {
+    emit_rex(a, true, 0, reg);
+    emit_byte(a, 0xF7);
+    emit_modrm_reg(a, 3, reg);
+}
+
+static void emit_imul(Assembler* a, int dst, int src) {
+    emit_rex(a, true, dst, src);
+    emit_byte(a, 0x0F);
+    emit_byte(a, 0xAF);
+    emit_modrm_reg(a, dst, src);
+}
+
+static void emit_cmov(Assembler* a, int cc, int dst, int src) {
+    emit_rex(a, true, dst, src);
+    emit_byte(a, 0x0F);
+    emit_byte(a, (uint8_t)(0x40 | cc));
+    emit_modrm_reg(a, dst, src);
+}
+
+// Values that fit take the zero-extending 32-bit form
+static void emit_mov_imm(Assembler* a, int reg, uint64_t value) {
+    emit_rex(a, value > UINT32_MAX, 0, reg);
+    emit_byte(a, (uint8_t)(0xB8 + (reg & 7)));
+    if (value > UINT32_MAX) {
+        emit_u64(a, value);
+    } else {
+        emit_u32(a, (uint32_t)value);
+    }
+}
+
+static void emit_push(Assembler* a, int reg) {
+    emit_rex(a, false, 0, reg);
+    emit_byte(a, (uint8_t)(0x50 + (reg & 7)));
+    a->depth++;
+}
+
+static void emit_pop(Assembler* a, int reg) {
+    emit_rex(a, false, 0, reg);
+    emit_byte(a, (uint8_t)(0x58 + (reg & 7)));
+    a->depth--;
+}
+
+// Calls a C function, keeping the stack 16-byte aligned as the ABI asks.
+// Clobbers rax and the other caller-saved registers. emit_call_rax calls
+// the function whose address is in rax.
+static void emit_call_rax(Assembler* a) {
+    bool pad = a->depth & 1;
+    if (pad) {
+        emit_alu_imm(a, ALU_SUB, RSP, 8);
+    }
+    emit_byte(a, 0xFF);
+    emit_modrm_reg(a, 2, RAX);
+    if (pad) {
+        emit_alu_imm(a, ALU_ADD, RSP, 8);
+    }
+}
+
+static void emit_call(Assembler* a, uintptr_t function) {
+    emit_mov_imm(a, RAX, function);
+    emit_call_rax(a);
+}
+
+// Forward jumps to the same place are chained through their rel32 fields
+// until the target is known, as bytecode.c chains its jump operands. cc < 0
+// makes an unconditional jump.
+static void emit_jump(Assembler* a, int cc, int* chain) {
+    if (cc < 0) {
+        emit_byte(a, 0xE9);
+    } else {
+        emit_byte(a, 0x0F);
+        emit_byte(a, (uint8_t)(0x80 | cc));
+    }
+    emit_u32(a, (uint32_t)*chain);
+    *chain = a->length - 4;
+}
+
+static void patch_jumps(Assembler* a, int chain) {
+    while (chain >= 0) {
+        int32_t next;
+        memcpy(&next, a->code + chain, 4);
+        int32_t rel = a->length - (chain + 4);
+        memcpy(a->code + chain, &rel, 4);
+        chain = next;
+    }
+}
+
+// Code generation. rbx holds the environment throughout; each node leaves
+// its value in rax. Temporaries are pushed on the machine stack, where the
+// collector's scan of the C stack sees them.
+
+#define VALUE(obj) ((uintptr_t)(obj))
+#define FUNCTION(fn) ((uintptr_t)(fn))
+
+static void compile(Assembler* a, Node* node);
+
+static SchemeObject* divide(Node* node, SchemeObject* procedure, SchemeObject* first,
+                            SchemeObject* second, Environment* env) {
+    SchemeObject* result;
+    if (is_builtin(procedure, builtin_divide) && (result = fast_divide(first, second))) {
+        return result;
+    }
+    return call_numeric(node, procedure, 2, first, second, env);
+}
+
+static void compile_global(Assembler* a, SchemeObject* ref) {
+    int slow = -1;
+    int done = -1;
+
+    // The inline cache of eval_global_ref
+    emit_mov_imm(a, RCX, VALUE(ref));
+    emit_load(a, RDX, RCX, (int32_t)offsetof(SchemeObject, value.global_binding));
+    emit_rr(a, 0x85, RDX, RDX);
+    emit_jump(a, CC_E, &slow);
+    emit_load(a, RAX, RCX, (int32_t)offsetof(SchemeObject, value.global_version));
+    emit_mov_imm(a, R8, VALUE(&binding_version));
+    emit_cmp_mem(a, RAX, R8, 0);
+    emit_jump(a, CC_NE, &slow);
+    emit_mov_imm(a, R8, VALUE(&global_cache_hits));
+    emit_add_mem_imm(a, R8, 0, 1);
+    emit_load(a, RAX, RDX, (int32_t)offsetof(Binding, value));
+    emit_jump(a, -1, &done);
+
+    patch_jumps(a, slow);
+    emit_mov(a, RDI, RCX);
+    emit_mov(a, RSI, RBX);
+    emit_call(a, FUNCTION(lookup_global_ref));
+    patch_jumps(a, done);
+}
+
+static void compile_local(Assembler* a, Node* node) {
+    int base = RBX;
+    if (node->local.depth > 0) {
+        emit_mov(a, RCX, RBX);
+        for (int i = 0; i < node->local.depth; i++) {
+            emit_load(a, RCX, RCX, (int32_t)offsetof(Environment, parent));
+        }
+        base = RCX;
+    }
+    emit_load(a, RAX, base, (int32_t)offsetof(Environment, slots));
+    emit_load(a, RAX, RAX, (int32_t)(node->local.slot * (int)sizeof(SchemeObject*)));
+
+    // A slot nothing was stored in yet
+    int bound = -1;
+    emit_rr(a, 0x85, RAX, RAX);
+    emit_jump(a, CC_NE, &bound);
+    emit_mov(a, RDI, base);
+    emit_mov_imm(a, RSI, (uint64_t)node->local.slot);
+    emit_call(a, FUNCTION(unbound_local));
+    patch_jumps(a, bound);
+}
+
+// A numeric node: the operator's builtin check and fixnum arithmetic
+// inline, call_numeric otherwise. With if_false set, a comparison jumps
+// there when false instead of producing a boolean.
+static void compile_numeric(Assembler* a, Node* node, NodeKind kind, int* if_false) {
+    static const struct {
+        PrimitiveFn builtin;
+        int cc;
+    } operators[] = {
+        [NODE_ADD] = {builtin_add, 0}, [NODE_SUBTRACT] = {builtin_subtract, 0},
+        [NODE_MULTIPLY] = {builtin_multiply, 0}, [NODE_NEGATE] = {builtin_subtract, 0},
+        [NODE_NUM_EQ] = {builtin_num_eq, CC_E}, [NODE_LT] = {builtin_lt, CC_L},
+        [NODE_GT] = {builtin_gt, CC_G}, [NODE_LE] = {builtin_le, CC_LE},
+        [NODE_GE] = {builtin_ge, CC_GE},
+    };
+    bool unary = kind == NODE_NEGATE;
+    bool comparison = kind >= NODE_NUM_EQ && kind <= NODE_GE;
+
+    // Operator, then operands, as the interpreter evaluates them; leaves
+    // the procedure in rdi and the operands in rsi and rdx
+    compile(a, node->numeric.operator);
+    emit_push(a, RAX);
+    compile(a, node->numeric.operands[0]);
+    if (unary) {
+        emit_mov(a, RSI, RAX);
+    } else {
+        emit_push(a, RAX);
+        compile(a, node->numeric.operands[1]);
+        emit_mov(a, RDX, RAX);
+        emit_pop(a, RSI);
+    }
+    emit_pop(a, RDI);
+
+    if (kind == NODE_DIVIDE) {
+        emit_mov(a, RCX, RDX);
+        emit_mov(a, RDX, RSI);
+        emit_mov(a, RSI, RDI);
+        emit_mov_imm(a, RDI, VALUE(node));
+        emit_mov(a, R8, RBX);
+        emit_call(a, FUNCTION(divide));
+        return;
+    }
+
+    int slow = -1;
+    int done = -1;
+
+    // The operator is still the builtin
+    emit_test_imm(a, RDI, SCHEME_TAG_MASK);
+    emit_jump(a, CC_NE, &slow);
+    emit_cmp_mem32_imm(a, RDI, (int32_t)offsetof(SchemeObject, type), SCHEME_PRIMITIVE);
+    emit_jump(a, CC_NE, &slow);
+    emit_mov_imm(a, RAX, FUNCTION(operators[kind].builtin));
+    emit_cmp_mem(a, RAX, RDI, (int32_t)offsetof(SchemeObject, value.primitive));
+    emit_jump(a, CC_NE, &slow);
+
+    // The operands are fixnums
+    if (unary) {
+        emit_mov(a, RAX, RSI);
+    } else {
+        emit_mov(a, RAX, RSI);
+        emit_rr(a, 0x21, RAX, RDX);
+    }
+    emit_test_imm(a, RAX, SCHEME_FIXNUM_TAG);
+    emit_jump(a, CC_E, &slow);
+
+    if (comparison) {
+        // Tagged fixnums order as their values do
+        emit_rr(a, 0x39, RSI, RDX);
+        if (if_false) {
+            emit_jump(a, operators[kind].cc ^ 1, if_false);
+        } else {
+            emit_mov_imm(a, RAX, VALUE(SCHEME_FALSE_OBJECT));
+            emit_mov_imm(a, RCX, VALUE(SCHEME_TRUE_OBJECT));
+            emit_cmov(a, operators[kind].cc, RAX, RCX);
+        }
+    } else {
+        emit_mov(a, RAX, RSI);
+        emit_shift1(a, 7, RAX);
+        if (unary) {
+            emit_neg(a, RAX);
+        } else {
+            emit_mov(a, RCX, RDX);
+            emit_shift1(a, 7, RCX);
+            if (kind == NODE_ADD) {
+                emit_rr(a, 0x01, RAX, RCX);
+            } else if (kind == NODE_SUBTRACT) {
+                emit_rr(a, 0x29, RAX, RCX);
+            } else {
+                emit_imul(a, RAX, RCX);
+                emit_jump(a, CC_O, &slow);
+            }
+            // Results outside the fixnum range take the generic path
+            emit_mov_imm(a, RCX, (uint64_t)SCHEME_FIXNUM_MAX);
+            emit_rr(a, 0x39, RAX, RCX);
+            emit_jump(a, CC_G, &slow);
+            emit_neg(a, RCX);
+            emit_rr(a, 0x39, RAX, RCX);
+            emit_jump(a, CC_L, &slow);
+        }
+        emit_rr(a, 0x01, RAX, RAX);
+        emit_alu_imm(a, ALU_OR, RAX, SCHEME_FIXNUM_TAG);
+    }
+    emit_jump(a, -1, &done);
+
+    patch_jumps(a, slow);
+    emit_mov(a, R8, RDX);
+    emit_mov(a, RCX, RSI);
+    emit_mov(a, RSI, RDI);
+    emit_mov_imm(a, RDX, unary ? 1 : 2);
+    emit_mov_imm(a, RDI, VALUE(node));
+    emit_mov(a, R9, RBX);
+    emit_call(a, FUNCTION(call_numeric));
+    if (comparison && if_false) {
+        emit_alu_imm(a, ALU_CMP, RAX, (int32_t)VALUE(SCHEME_FALSE_OBJECT));
+        emit_jump(a, CC_E, if_false);
+    }
+    patch_jumps(a, done);
+}
+
+// Evaluates a test, jumping to if_false when it is #f
+static void compile_test(Assembler* a, Node* node, int* if_false) {
+    NodeKind kind = node_kind(node);
+    if (kind >= NODE_NUM_EQ && kind <= NODE_GE) {
+        a->compiled_nodes++;
+        compile_numeric(a, node, kind, if_false);
+        return;
+    }
+    compile(a, node);
+    emit_alu_imm(a, ALU_CMP, RAX, (int32_t)VALUE(SCHEME_FALSE_OBJECT));
+    emit_jump(a, CC_E, if_false);
+}
+
+// Calls build their argument frame on the argument stack as eval_call_node
+// does; a tail call's frame also holds the procedure and goes to tail_call
+static void compile_call(Assembler* a, Node* node, bool tail) {
+    int argc = node->call.argc;
+    int first = tail ? 1 : 0;
+
+    compile(a, node->call.operator);
+    emit_push(a, RAX);
+    emit_mov_imm(a, RDI, (uint64_t)(argc + first));
+    emit_call(a, FUNCTION(push_arguments));
+    emit_push(a, RAX);
+    if (tail) {
+        emit_load(a, RCX, RSP, 8);
+        emit_store(a, RAX, 0, RCX);
+    }
+    for (int i = 0; i < argc; i++) {
+        compile(a, node->call.operands[i]);
+        emit_load(a, RCX, RSP, 0);
+        emit_store(a, RCX, (int32_t)((i + first) * (int)sizeof(SchemeObject*)), RAX);
+    }
+
+    if (tail) {
+        emit_pop(a, RDI);
+        emit_pop(a, RCX);
+        emit_mov_imm(a, RSI, (uint64_t)argc);
+        emit_call(a, FUNCTION(tail_call));
+        return;
+    }
+    emit_pop(a, RDX);
+    emit_pop(a, RDI);
+    emit_mov_imm(a, RSI, (uint64_t)argc);
+    emit_mov(a, RCX, RBX);
+    emit_call(a, FUNCTION(apply_procedure_argv));
+    emit_mov(a, R12, RAX);
+    emit_mov_imm(a, RDI, (uint64_t)argc);
+    emit_call(a, FUNCTION(pop_arguments));
+    emit_mov(a, RAX, R12);
+}
+
+static void compile(Assembler* a, Node* node) {
+    NodeKind kind = node_kind(node);
+    int if_false = -1;
+    int done = -1;
+
+    if (kind != NODE_OTHER) {
+        a->compiled_nodes++;
+    }
+    switch (kind) {
+        case NODE_CONSTANT:
+            emit_mov_imm(a, RAX, VALUE(node->constant));
+            break;
+
+        case NODE_LOCAL0:
+        case NODE_LOCAL:
+            compile_local(a, node);
+            break;
+
+        case NODE_GLOBAL:
+            compile_global(a, node->global.ref);
+            break;
+
+        case NODE_IF:
+            compile_test(a, node->branch.test, &if_false);
+            compile(a, node->branch.consequent);
+            emit_jump(a, -1, &done);
+            patch_jumps(a, if_false);
+            if (node->branch.alternative) {
+                compile(a, node->branch.alternative);
+            } else {
+                emit_mov_imm(a, RAX, VALUE(SCHEME_NIL_OBJECT));
+            }
+            patch_jumps(a, done);
+            break;
+
+        case NODE_SEQUENCE:
+            for (int i = 0; i < node->sequence.count; i++) {
+                compile(a, node->sequence.items[i]);
+            }
+            break;
+
+        case NODE_AND:
+        case NODE_OR:
+            // The first #f (and) or true value (or) is the result
+            if (node->sequence.count == 0) {
+                emit_mov_imm(a, RAX, VALUE(kind == NODE_AND ? SCHEME_TRUE_OBJECT : SCHEME_FALSE_OBJECT));
+            }
+            for (int i = 0; i < node->sequence.count; i++) {
+                compile(a, node->sequence.items[i]);
+                if (i < node->sequence.count - 1) {
+                    emit_alu_imm(a, ALU_CMP, RAX, (int32_t)VALUE(SCHEME_FALSE_OBJECT));
+                    emit_jump(a, kind == NODE_AND ? CC_E : CC_NE, &done);
+                }
+            }
+            patch_jumps(a, done);
+            break;
+
+        case NODE_COND:
+            for (int i = 0; i < node->cond.count; i++) {
+                Node* test = node->cond.tests[i];
+                Node* body = node->cond.bodies[i];
+                int next = -1;
+                if (test) {
+                    if (body) {
+                        compile_test(a, test, &next);
+                    } else {
+                        // The test's value is the result
+                        compile(a, test);
+                        emit_alu_imm(a, ALU_CMP, RAX, (int32_t)VALUE(SCHEME_FALSE_OBJECT));
+                        emit_jump(a, CC_NE, &done);
+                        continue;
+                    }
+                }
+                if (body) {
+                    compile(a, body);
+                } else {
+                    emit_mov_imm(a, RAX, VALUE(SCHEME_NIL_OBJECT));
+                }
+                emit_jump(a, -1, &done);
+                patch_jumps(a, next);
+                if (!test) {
+                    break;
+                }
+            }
+            emit_mov_imm(a, RAX, VALUE(SCHEME_NIL_OBJECT));
+            patch_jumps(a, done);
+            break;
+
+        case NODE_CALL:
+        case NODE_TAIL_CALL:
+            compile_call(a, node, kind == NODE_TAIL_CALL);
+            break;
+
+        case NODE_ADD:
+        case NODE_SUBTRACT:
+        case NODE_MULTIPLY:
+        case NODE_DIVIDE:
+        case NODE_NEGATE:
+        case NODE_NUM_EQ:
+        case NODE_LT:
+        case NODE_GT:
+        case NODE_LE:
+        case NODE_GE:
+            compile_numeric(a, node, kind, NULL);
+            break;
+
+        case NODE_OTHER:
+            // The interpreter's own evaluation function, read at each call:
+            // type feedback may rewrite it
+            a->called_nodes++;
+            emit_mov_imm(a, RDI, VALUE(node));
+            emit_mov(a, RSI, RBX);
+            emit_load(a, RAX, RDI, offsetof(Node, eval));
+            emit_call_rax(a);
+            break;
+    }
+}
+
+bool jit_compile(SchemeObject* code) {
+    SchemeCode* c = &code->value.code;
+    Assembler a = {0};
+
+    // push rbp; mov rbp, rsp; push rbx; push r12, leaving the stack aligned
+    emit_push(&a, RBP);
+    emit_mov(&a, RBP, RSP);
+    emit_push(&a, RBX);
+    emit_push(&a, R12);
+    a.depth = 0;
+    emit_mov(&a, RBX, RDI);
+
+    compile(&a, c->root);
+
+    emit_pop(&a, R12);
+    emit_pop(&a, RBX);
+    emit_pop(&a, RBP);
+    emit_byte(&a, 0xC3);
+
+    // Pages of its own, writable while the code is copied in, then
+    // executable only
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mapped = ((size_t)a.length + page - 1) / page * page;
+    void* memory = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        scheme_free(a.code);
+        return false;
+    }
+    memcpy(memory, a.code, (size_t)a.length);
+    scheme_free(a.code);
+    if (mprotect(memory, mapped, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, mapped);
+        return false;
+    }
+
+    JitCode* jit = (JitCode*)scheme_malloc(sizeof(JitCode));
+    memset(jit, 0, sizeof(JitCode));
+    jit->entry = (JitFn)(uintptr_t)memory;
+    jit->size = (size_t)a.length;
+    jit->mapped = mapped;
+    jit->compiled_nodes = a.compiled_nodes;
+    jit->called_nodes = a.called_nodes;
+    jit->name = scheme_strdup(c->name ? c->name->value.symbol_name : "(anonymous)");
+    jit->code = code;
+    jit->compiled_at = c->runs;
+    *compiled_tail = jit;
+    compiled_tail = &jit->next;
+
+    c->jit = jit;
+    return true;
+}
+
+void jit_free(JitCode* jit, uint64_t runs) {
+    munmap((void*)(uintptr_t)jit->entry, jit->mapped);
+    jit->entry = NULL;
+    jit->code = NULL;
+    jit->runs = runs;
+}
+
+#else
+
+bool jit_compile(SchemeObject* code) {
+    (void)code;
+    return false;
+}
+
+void jit_free(JitCode* jit, uint64_t runs) {
+    (void)jit;
+    (void)runs;
+}
+
+#endif // JIT_SUPPORTED
+
+void print_jit_stats(FILE* out) {
+    if (!compiled) {
+        fprintf(out, "JIT: no procedures compiled%s\n", jit_threshold ? "" : " (disabled)");
+        return;
+    }
+
+    size_t count = 0;
+    size_t bytes = 0;
+    for (JitCode* jit = compiled; jit; jit = jit->next) {
+        count++;
+        bytes += jit->size;
+    }
+    fprintf(out, "JIT: %zu procedures compiled after %llu calls, %zu bytes of machine code\n",
+            count, (unsigned long long)configured_threshold, bytes);
+    fprintf(out, "  %-24s %14s %10s %10s %8s\n", "procedure", "native calls", "compiled", "called", "bytes");
+    for (JitCode* jit = compiled; jit; jit = jit->next) {
+        uint64_t runs = jit->code ? jit->code->value.code.runs : jit->runs;
+        fprintf(out, "  %-24s %14llu %10d %10d %8zu\n", jit->name,
+                (unsigned long long)(runs - jit->compiled_at + 1),
+                jit->compiled_nodes, jit->called_nodes, jit->size);
+    }
+}
+
+void cleanup_jit(void) {
+    while (compiled) {
+        JitCode* next = compiled->next;
+        scheme_free(compiled->name);
+        scheme_free(compiled);
+        compiled = next;
+    }
+    compiled_tail = &compiled;
+}
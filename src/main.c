@@ -19,6 +19,17 @@ void print_usage(const char* program_name) {
     printf("  -O, --optimize     Enable optimizations\n");
     printf("  --verbose          Enable verbose output\n");
     printf("  --debug            Enable debug mode\n");
+    printf("  --vm               Run programs on the bytecode VM instead of the tree-walker\n");
+    printf("  --no-jit           Never compile hot procedures to machine code\n");
+    printf("  --jit-threshold N  Calls of a procedure before it is compiled (default %d)\n",
+           JIT_DEFAULT_THRESHOLD);
+    printf("  --jit-stats        Print per-procedure JIT statistics at exit\n");
+    printf("  --feedback-stats   Print per-procedure numeric specializations and deopts at exit\n");
+    printf("  --gc-stats         Log each collection and print heap statistics at exit\n");
+    printf("  --gc-threshold N   Minimum old-generation growth (cells) between full collections\n");
+    printf("  --gc-nursery N     Young-generation size in cells\n");
+    printf("  --gc-budget US     Collect the old generation incrementally, pausing at most\n");
+    printf("                     about US microseconds per step\n");
     printf("\nExamples:\n");
     printf("  %s                    # Start REPL\n", program_name);
     printf("  %s program.scm        # Run Scheme file\n", program_name);
@@ -33,6 +44,9 @@ AppContext* create_app_context(void) {
     ctx->output_file = NULL;
     ctx->verbose = false;
     ctx->optimize = false;
+    ctx->gc_stats = false;
+    ctx->jit_stats = false;
+    ctx->feedback_stats = false;
     ctx->global_env = NULL;
     return ctx;
 }
@@ -40,6 +54,7 @@ AppContext* create_app_context(void) {
 void destroy_app_context(AppContext* ctx) {
     if (ctx) {
         if (ctx->global_env) {
+            gc_remove_environment_root(ctx->global_env);
             release_environment(ctx->global_env);
         }
         scheme_free(ctx);
@@ -75,6 +90,61 @@ static bool parse_arguments(int argc, char* argv[], AppContext* ctx) {
             ctx->verbose = true;
         } else if (strcmp(argv[i], "--debug") == 0) {
             set_debug_mode(true);
+        } else if (strcmp(argv[i], "--vm") == 0) {
+            set_execution_engine(ENGINE_VM);
+        } else if (strcmp(argv[i], "--no-jit") == 0) {
+            jit_set_enabled(false);
+        } else if (strcmp(argv[i], "--jit-stats") == 0) {
+            ctx->jit_stats = true;
+        } else if (strcmp(argv[i], "--feedback-stats") == 0) {
+            ctx->feedback_stats = true;
+        } else if (strcmp(argv[i], "--jit-threshold") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: --jit-threshold option requires a number\n");
+                return false;
+            }
+            long threshold = strtol(argv[++i], NULL, 10);
+            if (threshold <= 0) {
+                fprintf(stderr, "Error: Invalid JIT threshold: %s\n", argv[i]);
+                return false;
+            }
+            jit_set_threshold((uint64_t)threshold);
+        } else if (strcmp(argv[i], "--gc-stats") == 0) {
+            ctx->gc_stats = true;
+            gc_set_verbose(true);
+        } else if (strcmp(argv[i], "--gc-threshold") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: --gc-threshold option requires a number\n");
+                return false;
+            }
+            long threshold = strtol(argv[++i], NULL, 10);
+            if (threshold <= 0) {
+                fprintf(stderr, "Error: Invalid GC threshold: %s\n", argv[i]);
+                return false;
+            }
+            gc_set_threshold((size_t)threshold);
+        } else if (strcmp(argv[i], "--gc-nursery") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: --gc-nursery option requires a number\n");
+                return false;
+            }
+            long nursery = strtol(argv[++i], NULL, 10);
+            if (nursery <= 0) {
+                fprintf(stderr, "Error: Invalid nursery size: %s\n", argv[i]);
+                return false;
+            }
+            gc_set_nursery_size((size_t)nursery);
+        } else if (strcmp(argv[i], "--gc-budget") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "Error: --gc-budget option requires a number\n");
+                return false;
+            }
+            double budget = strtod(argv[++i], NULL);
+            if (budget <= 0) {
+                fprintf(stderr, "Error: Invalid GC pause budget: %s\n", argv[i]);
+                return false;
+            }
+            gc_set_pause_budget(budget);
         } else if (argv[i][0] == '-') {
             fprintf(stderr, "Error: Unknown option: %s\n", argv[i]);
             return false;
@@ -133,7 +203,7 @@ static void run_interpreter_mode(AppContext* ctx) {
                 break; // End of input
             }
             
-            SchemeObject* result = eval_expression(expr, ctx->global_env);
+            SchemeObject* result = eval_toplevel(expr, ctx->global_env);
             
             if (has_eval_error()) {
                 print_eval_error(stderr);
@@ -266,8 +336,12 @@ static void run_compiler_mode(AppContext* ctx) {
 }
 
 int rscheme_main(int argc, char* argv[]) {
-    // Initialize runtime
+    // Initialize runtime; everything the interpreter does happens in frames
+    // below this one, so it bounds the collector's stack scan
+    void* stack_bottom = NULL;
     init_runtime();
+    gc_set_stack_bottom(&stack_bottom);
+    set_stack_limit(&stack_bottom);
     init_scheme_objects();
     
     AppContext* ctx = create_app_context();
@@ -298,6 +372,16 @@ int rscheme_main(int argc, char* argv[]) {
             break;
     }
     
+    if (ctx->gc_stats) {
+        print_memory_stats(stderr);
+    }
+    if (ctx->jit_stats) {
+        print_jit_stats(stderr);
+    }
+    if (ctx->feedback_stats) {
+        print_feedback_stats(stderr);
+    }
+    
     // Cleanup
     destroy_app_context(ctx);
     cleanup_scheme_objects();
@@ -204,6 +204,7 @@ SchemeObject* parse_vector(Parser* parser) {
         if (has_parse_error(parser)) {
             return NULL;
         }
+        gc_write_barrier(vector, element);
         vector->value.vector.elements[i] = element;
         if (element) {
             retain_object(element);
@@ -230,7 +231,7 @@ SchemeObject* parse_quote(Parser* parser) {
         return NULL;
     }
     
-    SchemeObject* quote_symbol = make_symbol("quote");
+    SchemeObject* quote_symbol = SYMBOL_QUOTE;
     return cons(quote_symbol, cons(quoted, make_nil()));
 }
 
@@ -326,6 +327,16 @@ SchemeObject* parse_number(const char* str) {
         return NULL;
     }
     
+    // Integer literals are exact, however many digits they have
+    const char* digits = str + (*str == '+' || *str == '-');
+    const char* end = digits;
+    while (isdigit((unsigned char)*end)) {
+        end++;
+    }
+    if (*end == '\0' && end > digits) {
+        return parse_integer(str);
+    }
+    
     double value = strtod(str, NULL);
     return make_number(value);
 }
@@ -0,0 +1,543 @@
+#include "rscheme.h"
+
+// A frame being laid out. Of its slot names only the first `visible` are
+// in scope: let* brings its variables into scope one at a time.
+typedef struct Scope {
+    SchemeObject** names;
+    int count;
+    int capacity;
+    int visible;
+    struct Scope* parent;
+} Scope;
+
+static SchemeObject* resolve(SchemeObject* expr, Scope* scope);
+
+static void scope_init(Scope* scope, Scope* parent) {
+    scope->names = NULL;
+    scope->count = 0;
+    scope->capacity = 0;
+    scope->visible = 0;
+    scope->parent = parent;
+}
+
+static void scope_free(Scope* scope) {
+    if (scope->names) {
+        scheme_free(scope->names);
+    }
+}
+
+static int scope_find(Scope* scope, SchemeObject* symbol, int limit) {
+    for (int i = 0; i < limit; i++) {
+        if (scope->names[i] == symbol) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// The slot for a name, added if the frame does not have one yet
+static int scope_add(Scope* scope, SchemeObject* symbol) {
+    int slot = scope_find(scope, symbol, scope->count);
+    if (slot >= 0) {
+        return slot;
+    }
+
+    if (scope->count == scope->capacity) {
+        scope->capacity = scope->capacity ? scope->capacity * 2 : 8;
+        scope->names = (SchemeObject**)scheme_realloc(scope->names, scope->capacity * sizeof(SchemeObject*));
+    }
+    scope->names[scope->count] = symbol;
+    return scope->count++;
+}
+
+static SchemeObject* scope_layout(Scope* scope) {
+    SchemeObject* layout = make_vector((size_t)scope->count);
+    for (int i = 0; i < scope->count; i++) {
+        layout->value.vector.elements[i] = scope->names[i];
+    }
+    return layout;
+}
+
+static SchemeObject* resolve_local(SchemeObject* symbol, Scope* scope) {
+    for (int depth = 0; scope; depth++, scope = scope->parent) {
+        int slot = scope_find(scope, symbol, scope->visible);
+        if (slot >= 0) {
+            return make_local_ref(depth, slot);
+        }
+    }
+    return NULL;
+}
+
+// A variable reference: local, or global with an inline cache of its own
+static SchemeObject* resolve_variable(SchemeObject* symbol, Scope* scope) {
+    SchemeObject* local = resolve_local(symbol, scope);
+    return local ? local : make_global_ref(symbol);
+}
+
+// The target of define or set!: local, or the symbol itself
+static SchemeObject* resolve_target(SchemeObject* symbol, Scope* scope) {
+    SchemeObject* local = resolve_local(symbol, scope);
+    return local ? local : symbol;
+}
+
+// Internal defines. A define creates its variable in the frame it runs in,
+// so the frame gets a slot for every define reached without entering a form
+// that builds a frame of its own. A define that does not run, in a branch
+// not taken, leaves its slot empty, and reads of it look further out (see
+// unassigned_variable).
+
+static void collect_defines(SchemeObject* expr, Scope* scope);
+
+static void collect_defines_list(SchemeObject* list, Scope* scope) {
+    for (; is_pair(list); list = cdr(list)) {
+        collect_defines(car(list), scope);
+    }
+}
+
+static void collect_defines(SchemeObject* expr, Scope* scope) {
+    if (!is_pair(expr)) {
+        return;
+    }
+
+    SchemeObject* head = car(expr);
+    SchemeObject* args = cdr(expr);
+
+    if (head == SYMBOL_QUOTE || head == SYMBOL_LAMBDA ||
+        head == SYMBOL_LET_STAR || head == SYMBOL_LETREC || head == SYMBOL_GUARD) {
+        return;
+    }
+
+    if (head == SYMBOL_DEFINE) {
+        if (!is_pair(args)) {
+            return;
+        }
+        SchemeObject* target = car(args);
+        if (is_symbol(target)) {
+            scope_add(scope, target);
+            collect_defines_list(cdr(args), scope);
+        } else if (is_pair(target) && is_symbol(car(target))) {
+            scope_add(scope, car(target));
+        }
+        return;
+    }
+
+    if (head == SYMBOL_LET) {
+        // Only the initialisers run in this frame
+        if (is_pair(args)) {
+            for (SchemeObject* b = car(args); is_pair(b); b = cdr(b)) {
+                if (is_pair(car(b))) {
+                    collect_defines_list(cdr(car(b)), scope);
+                }
+            }
+        }
+        return;
+    }
+
+    if (head == SYMBOL_RECEIVE) {
+        if (is_pair(args) && is_pair(cdr(args))) {
+            collect_defines(car(cdr(args)), scope);
+        }
+        return;
+    }
+
+    if (head == SYMBOL_LET_VALUES) {
+        if (is_pair(args)) {
+            for (SchemeObject* c = car(args); is_pair(c); c = cdr(c)) {
+                if (is_pair(car(c))) {
+                    collect_defines_list(cdr(car(c)), scope);
+                }
+            }
+        }
+        return;
+    }
+
+    if (head == SYMBOL_COND) {
+        for (; is_pair(args); args = cdr(args)) {
+            collect_defines_list(car(args), scope);
+        }
+        return;
+    }
+
+    collect_defines_list(expr, scope);
+}
+
+// Resolves the elements of a list, keeping any improper tail as it is
+static SchemeObject* resolve_list(SchemeObject* list, Scope* scope) {
+    if (!is_pair(list)) {
+        return list;
+    }
+
+    SchemeObject* head = cons(resolve(car(list), scope), SCHEME_NIL_OBJECT);
+    SchemeObject* last = head;
+    for (list = cdr(list); is_pair(list); list = cdr(list)) {
+        SchemeObject* next = cons(resolve(car(list), scope), SCHEME_NIL_OBJECT);
+        set_cdr(last, next);
+        last = next;
+    }
+    set_cdr(last, list);
+    return head;
+}
+
+static bool appears_before(SchemeObject* params, SchemeObject* end, SchemeObject* name) {
+    for (SchemeObject* p = params; p != end; p = cdr(p)) {
+        if (car(p) == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A parameter list the evaluator can bind positionally: symbols, possibly
+// with a rest symbol, none repeated
+static bool valid_parameters(SchemeObject* params) {
+    SchemeObject* p = params;
+    for (; is_pair(p); p = cdr(p)) {
+        if (!is_symbol(car(p)) || appears_before(params, p, car(p))) {
+            return false;
+        }
+    }
+    return is_nil(p) || (is_symbol(p) && !appears_before(params, p, p));
+}
+
+// (lambda params body...) as a resolved lambda, or NULL if the parameter
+// list is unusable
+static SchemeObject* resolve_lambda(SchemeObject* params, SchemeObject* body, Scope* scope) {
+    if (!valid_parameters(params)) {
+        return NULL;
+    }
+
+    Scope frame;
+    scope_init(&frame, scope);
+    SchemeObject* p = params;
+    for (; is_pair(p); p = cdr(p)) {
+        scope_add(&frame, car(p));
+    }
+    if (is_symbol(p)) {
+        scope_add(&frame, p);
+    }
+    collect_defines_list(body, &frame);
+    frame.visible = frame.count;
+
+    SchemeObject* layout = scope_layout(&frame);
+    SchemeObject* resolved_body = resolve_list(body, &frame);
+    scope_free(&frame);
+
+    return cons(SYMBOL_RESOLVED_LAMBDA, cons(layout, cons(params, resolved_body)));
+}
+
+static SchemeObject* resolve_define(SchemeObject* expr, Scope* scope) {
+    SchemeObject* args = cdr(expr);
+    if (!is_pair(args)) {
+        return expr;
+    }
+
+    SchemeObject* target = car(args);
+    SchemeObject* value;
+
+    if (is_symbol(target)) {
+        // (define var value)
+        SchemeObject* rest = cdr(args);
+        if (!is_pair(rest) || !is_nil(cdr(rest))) {
+            return expr;
+        }
+        value = resolve(car(rest), scope);
+    } else if (is_pair(target) && is_symbol(car(target))) {
+        // (define (name params...) body...) defines a lambda
+        value = resolve_lambda(cdr(target), cdr(args), scope);
+        if (!value) {
+            return expr;
+        }
+        target = car(target);
+    } else {
+        return expr;
+    }
+
+    return cons(SYMBOL_DEFINE, cons(resolve_target(target, scope), cons(value, SCHEME_NIL_OBJECT)));
+}
+
+static SchemeObject* resolve_set(SchemeObject* expr, Scope* scope) {
+    SchemeObject* args = cdr(expr);
+    if (!is_pair(args) || !is_symbol(car(args)) || !is_pair(cdr(args)) || !is_nil(cdr(cdr(args)))) {
+        return expr;
+    }
+
+    SchemeObject* target = resolve_target(car(args), scope);
+    SchemeObject* value = resolve(car(cdr(args)), scope);
+    return cons(SYMBOL_SET, cons(target, cons(value, SCHEME_NIL_OBJECT)));
+}
+
+// let, let* and letrec. Each binding must be (var init).
+static SchemeObject* resolve_let(SchemeObject* expr, Scope* scope) {
+    SchemeObject* head = car(expr);
+    SchemeObject* args = cdr(expr);
+    if (!is_pair(args)) {
+        return expr;
+    }
+
+    SchemeObject* bindings = car(args);
+    SchemeObject* body = cdr(args);
+    int binding_count = 0;
+    SchemeObject* b = bindings;
+    for (; is_pair(b); b = cdr(b)) {
+        SchemeObject* binding = car(b);
+        if (!is_pair(binding) || !is_symbol(car(binding)) ||
+            !is_pair(cdr(binding)) || !is_nil(cdr(cdr(binding)))) {
+            return expr;
+        }
+        binding_count++;
+    }
+    if (!is_nil(b)) {
+        return expr;
+    }
+
+    // Lay out the frame. visible_before[i] is how many slots are in scope
+    // for the i-th initialiser of a let*.
+    Scope frame;
+    scope_init(&frame, scope);
+    int* slots = (int*)scheme_malloc((size_t)(binding_count + 1) * sizeof(int));
+    int* visible_before = (int*)scheme_malloc((size_t)(binding_count + 1) * sizeof(int));
+    int i = 0;
+    for (b = bindings; is_pair(b); b = cdr(b), i++) {
+        visible_before[i] = frame.count;
+        slots[i] = scope_add(&frame, car(car(b)));
+    }
+    if (head != SYMBOL_LET) {
+        for (b = bindings; is_pair(b); b = cdr(b)) {
+            collect_defines(car(cdr(car(b))), &frame);
+        }
+    }
+    collect_defines_list(body, &frame);
+
+    SchemeObject* layout = scope_layout(&frame);
+    SchemeObject* resolved_bindings = SCHEME_NIL_OBJECT;
+    SchemeObject* last = NULL;
+    i = 0;
+    for (b = bindings; is_pair(b); b = cdr(b), i++) {
+        SchemeObject* init = car(cdr(car(b)));
+        if (head == SYMBOL_LET) {
+            init = resolve(init, scope);
+        } else {
+            frame.visible = head == SYMBOL_LET_STAR ? visible_before[i] : frame.count;
+            init = resolve(init, &frame);
+        }
+
+        SchemeObject* binding = cons(make_local_ref(0, slots[i]), cons(init, SCHEME_NIL_OBJECT));
+        SchemeObject* cell = cons(binding, SCHEME_NIL_OBJECT);
+        if (last) {
+            set_cdr(last, cell);
+        } else {
+            resolved_bindings = cell;
+        }
+        last = cell;
+    }
+
+    frame.visible = frame.count;
+    SchemeObject* resolved_body = resolve_list(body, &frame);
+    scheme_free(slots);
+    scheme_free(visible_before);
+    scope_free(&frame);
+
+    SchemeObject* resolved_head = head == SYMBOL_LET ? SYMBOL_RESOLVED_LET :
+                                  head == SYMBOL_LET_STAR ? SYMBOL_RESOLVED_LET_STAR :
+                                  SYMBOL_RESOLVED_LETREC;
+    return cons(resolved_head, cons(layout, cons(resolved_bindings, resolved_body)));
+}
+
+// A parameter list with each name replaced by the reference to its slot
+static SchemeObject* formals_targets(SchemeObject* formals, Scope* frame) {
+    if (is_symbol(formals)) {
+        return make_local_ref(0, scope_find(frame, formals, frame->count));
+    }
+    if (!is_pair(formals)) {
+        return formals;
+    }
+    SchemeObject* first = formals_targets(car(formals), frame);
+    return cons(first, formals_targets(cdr(formals), frame));
+}
+
+// (let-values ((formals init) ...) body...), and (receive formals init
+// body...) as a let-values of one clause. Each formals is a parameter list,
+// whose variables get slots of the new frame; the initialisers run outside
+// it. A clause becomes (targets init), targets being its formals with each
+// name replaced by a local reference.
+static SchemeObject* resolve_let_values(SchemeObject* expr, Scope* scope) {
+    SchemeObject* args = cdr(expr);
+    SchemeObject* clauses;
+    SchemeObject* body;
+    if (car(expr) == SYMBOL_RECEIVE) {
+        if (!is_pair(args) || !is_pair(cdr(args))) {
+            return expr;
+        }
+        clauses = cons(cons(car(args), cons(car(cdr(args)), SCHEME_NIL_OBJECT)), SCHEME_NIL_OBJECT);
+        body = cdr(cdr(args));
+    } else {
+        if (!is_pair(args)) {
+            return expr;
+        }
+        clauses = car(args);
+        body = cdr(args);
+    }
+
+    Scope frame;
+    scope_init(&frame, scope);
+    SchemeObject* c = clauses;
+    for (; is_pair(c); c = cdr(c)) {
+        SchemeObject* clause = car(c);
+        if (!is_pair(clause) || !is_pair(cdr(clause)) || !is_nil(cdr(cdr(clause))) ||
+            !valid_parameters(car(clause))) {
+            scope_free(&frame);
+            return expr;
+        }
+        // No variable may be bound twice, in one clause or across them
+        SchemeObject* p = car(clause);
+        for (; is_pair(p); p = cdr(p)) {
+            if (scope_find(&frame, car(p), frame.count) >= 0) {
+                scope_free(&frame);
+                return expr;
+            }
+            scope_add(&frame, car(p));
+        }
+        if (is_symbol(p)) {
+            if (scope_find(&frame, p, frame.count) >= 0) {
+                scope_free(&frame);
+                return expr;
+            }
+            scope_add(&frame, p);
+        }
+    }
+    if (!is_nil(c)) {
+        scope_free(&frame);
+        return expr;
+    }
+    collect_defines_list(body, &frame);
+    frame.visible = frame.count;
+
+    SchemeObject* layout = scope_layout(&frame);
+    SchemeObject* resolved_clauses = SCHEME_NIL_OBJECT;
+    SchemeObject* last = NULL;
+    for (c = clauses; is_pair(c); c = cdr(c)) {
+        SchemeObject* clause = car(c);
+        SchemeObject* targets = formals_targets(car(clause), &frame);
+        SchemeObject* init = resolve(car(cdr(clause)), scope);
+
+        SchemeObject* cell = cons(cons(targets, cons(init, SCHEME_NIL_OBJECT)), SCHEME_NIL_OBJECT);
+        if (last) {
+            set_cdr(last, cell);
+        } else {
+            resolved_clauses = cell;
+        }
+        last = cell;
+    }
+
+    SchemeObject* resolved_body = resolve_list(body, &frame);
+    scope_free(&frame);
+    return cons(SYMBOL_RESOLVED_LET_VALUES, cons(layout, cons(resolved_clauses, resolved_body)));
+}
+
+static SchemeObject* resolve_cond(SchemeObject* expr, Scope* scope) {
+    for (SchemeObject* c = cdr(expr); !is_nil(c); c = cdr(c)) {
+        if (!is_pair(c) || !is_pair(car(c))) {
+            return expr;
+        }
+    }
+
+    SchemeObject* clauses = SCHEME_NIL_OBJECT;
+    SchemeObject* last = NULL;
+    for (SchemeObject* c = cdr(expr); is_pair(c); c = cdr(c)) {
+        SchemeObject* clause = car(c);
+        SchemeObject* test = car(clause);
+        if (test != SYMBOL_ELSE) {
+            test = resolve(test, scope);
+        }
+
+        SchemeObject* cell = cons(cons(test, resolve_list(cdr(clause), scope)), SCHEME_NIL_OBJECT);
+        if (last) {
+            set_cdr(last, cell);
+        } else {
+            clauses = cell;
+        }
+        last = cell;
+    }
+
+    return cons(SYMBOL_COND, clauses);
+}
+
+// (guard (var clause...) body...) becomes
+//
+//     (%guard (lambda () body...)
+//             (lambda (var reraise) (cond clause... (else (reraise)))))
+//
+// where reraise is a name no clause can refer to. %guard (see control.c)
+// runs the body with a handler that escapes to the guard and there calls
+// the clauses on what was raised. NULL if the form is malformed.
+static SchemeObject* expand_guard(SchemeObject* expr) {
+    SchemeObject* args = cdr(expr);
+    if (!is_pair(args) || !is_pair(car(args)) || !is_symbol(car(car(args)))) {
+        return NULL;
+    }
+
+    SchemeObject* reraise = make_uninterned_symbol("reraise");
+    SchemeObject* clauses = cons(SYMBOL_COND, SCHEME_NIL_OBJECT);
+    SchemeObject* last = clauses;
+    for (SchemeObject* c = cdr(car(args)); !is_nil(c); c = cdr(c)) {
+        if (!is_pair(c)) {
+            return NULL;
+        }
+        SchemeObject* cell = cons(car(c), SCHEME_NIL_OBJECT);
+        set_cdr(last, cell);
+        last = cell;
+    }
+    if (!is_pair(car(last)) || car(car(last)) != SYMBOL_ELSE) {
+        SchemeObject* otherwise = cons(SYMBOL_ELSE, cons(cons(reraise, SCHEME_NIL_OBJECT), SCHEME_NIL_OBJECT));
+        set_cdr(last, cons(otherwise, SCHEME_NIL_OBJECT));
+    }
+
+    SchemeObject* handler = cons(SYMBOL_LAMBDA,
+                                 cons(cons(car(car(args)), cons(reraise, SCHEME_NIL_OBJECT)),
+                                      cons(clauses, SCHEME_NIL_OBJECT)));
+    SchemeObject* body = cons(SYMBOL_LAMBDA, cons(SCHEME_NIL_OBJECT, cdr(args)));
+    return cons(make_symbol("%guard"), cons(body, cons(handler, SCHEME_NIL_OBJECT)));
+}
+
+static SchemeObject* resolve(SchemeObject* expr, Scope* scope) {
+    check_stack_depth();
+    if (is_symbol(expr)) {
+        return resolve_variable(expr, scope);
+    }
+    if (!is_pair(expr)) {
+        return expr;
+    }
+
+    SchemeObject* head = car(expr);
+
+    if (head == SYMBOL_QUOTE) {
+        return expr;
+    } else if (head == SYMBOL_LAMBDA) {
+        SchemeObject* args = cdr(expr);
+        SchemeObject* lambda = is_pair(args) ? resolve_lambda(car(args), cdr(args), scope) : NULL;
+        return lambda ? lambda : expr;
+    } else if (head == SYMBOL_DEFINE) {
+        return resolve_define(expr, scope);
+    } else if (head == SYMBOL_SET) {
+        return resolve_set(expr, scope);
+    } else if (head == SYMBOL_LET || head == SYMBOL_LET_STAR || head == SYMBOL_LETREC) {
+        return resolve_let(expr, scope);
+    } else if (head == SYMBOL_LET_VALUES || head == SYMBOL_RECEIVE) {
+        return resolve_let_values(expr, scope);
+    } else if (head == SYMBOL_COND) {
+        return resolve_cond(expr, scope);
+    } else if (head == SYMBOL_GUARD) {
+        SchemeObject* expansion = expand_guard(expr);
+        return expansion ? resolve(expansion, scope) : expr;
+    } else if (head == SYMBOL_IF || head == SYMBOL_BEGIN || head == SYMBOL_AND || head == SYMBOL_OR) {
+        // The evaluator dispatches on the keyword whatever it is bound to
+        return cons(head, resolve_list(cdr(expr), scope));
+    }
+
+    // Application
+    return resolve_list(expr, scope);
+}
+
+SchemeObject* resolve_expression(SchemeObject* expr) {
+    return resolve(expr, NULL);
+}
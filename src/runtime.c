@@ -6,11 +6,6 @@ static struct {
     bool initialized;
     bool debug_mode;
     size_t allocated_memory;
-    size_t object_count;
-    bool gc_enabled;
-    SchemeObject*** gc_roots;
-    size_t gc_root_count;
-    size_t gc_root_capacity;
 } runtime_state = {0};
 
 void init_runtime(void) {
@@ -21,13 +16,12 @@ void init_runtime(void) {
     runtime_state.initialized = true;
     runtime_state.debug_mode = false;
     runtime_state.allocated_memory = 0;
-    runtime_state.object_count = 0;
-    runtime_state.gc_enabled = true;
-    runtime_state.gc_roots = NULL;
-    runtime_state.gc_root_count = 0;
-    runtime_state.gc_root_capacity = 0;
     
+#ifndef RSCHEME_SYSTEM_MALLOC
+    slab_init();
+#endif
     gc_init();
+    init_symbol_table();
 }
 
 void cleanup_runtime(void) {
@@ -36,16 +30,28 @@ void cleanup_runtime(void) {
     }
     
     gc_cleanup();
-    
-    if (runtime_state.gc_roots) {
-        free(runtime_state.gc_roots);
-        runtime_state.gc_roots = NULL;
-    }
+    cleanup_argument_stack();
+    print_vm_profile(stderr);
+    cleanup_vm();
+    cleanup_jit();
+    cleanup_feedback();
+    cleanup_symbol_table();
+#ifndef RSCHEME_SYSTEM_MALLOC
+    slab_cleanup();
+#endif
     
     runtime_state.initialized = false;
 }
 
+// Small requests come from the slab allocator's size classes unless the
+// build selects the system allocator (RSCHEME_SYSTEM_MALLOC) for comparison
 void* scheme_malloc(size_t size) {
+#ifndef RSCHEME_SYSTEM_MALLOC
+    if (size <= SLAB_MAX_SIZE) {
+        runtime_state.allocated_memory += size;
+        return slab_alloc(size);
+    }
+#endif
     void* ptr = malloc(size);
     if (!ptr) {
         runtime_error("Out of memory: failed to allocate %zu bytes", size);
@@ -56,6 +62,21 @@ void* scheme_malloc(size_t size) {
 }
 
 void* scheme_realloc(void* ptr, size_t size) {
+#ifndef RSCHEME_SYSTEM_MALLOC
+    if (!ptr) {
+        return scheme_malloc(size);
+    }
+    if (slab_owns(ptr)) {
+        size_t old_size = slab_size_of(ptr);
+        if (size <= old_size) {
+            return ptr;
+        }
+        void* new_ptr = scheme_malloc(size);
+        memcpy(new_ptr, ptr, old_size);
+        slab_free(ptr);
+        return new_ptr;
+    }
+#endif
     void* new_ptr = realloc(ptr, size);
     if (!new_ptr && size > 0) {
         runtime_error("Out of memory: failed to reallocate %zu bytes", size);
@@ -66,9 +87,16 @@ void* scheme_realloc(void* ptr, size_t size) {
 }
 
 void scheme_free(void* ptr) {
-    if (ptr) {
-        free(ptr);
+    if (!ptr) {
+        return;
+    }
+#ifndef RSCHEME_SYSTEM_MALLOC
+    if (slab_owns(ptr)) {
+        slab_free(ptr);
+        return;
     }
+#endif
+    free(ptr);
 }
 
 char* scheme_strdup(const char* str) {
@@ -86,87 +114,22 @@ size_t get_allocated_memory(void) {
 }
 
 size_t get_object_count(void) {
-    return runtime_state.object_count;
+    return gc_get_stats()->live_cells;
 }
 
 void print_memory_stats(FILE* out) {
     fprintf(out, "Memory Statistics:\n");
     fprintf(out, "  Allocated memory: %zu bytes\n", runtime_state.allocated_memory);
-    fprintf(out, "  Object count: %zu\n", runtime_state.object_count);
-    fprintf(out, "  GC enabled: %s\n", runtime_state.gc_enabled ? "yes" : "no");
-    fprintf(out, "  GC roots: %zu\n", runtime_state.gc_root_count);
-}
-
-void gc_init(void) {
-    runtime_state.gc_root_capacity = 16;
-    runtime_state.gc_roots = (SchemeObject***)scheme_malloc(
-        runtime_state.gc_root_capacity * sizeof(SchemeObject**));
-    runtime_state.gc_root_count = 0;
-}
-
-void gc_cleanup(void) {
-    if (runtime_state.gc_roots) {
-        scheme_free(runtime_state.gc_roots);
-        runtime_state.gc_roots = NULL;
-    }
-    runtime_state.gc_root_count = 0;
-    runtime_state.gc_root_capacity = 0;
-}
-
-void gc_add_root(SchemeObject** root) {
-    if (runtime_state.gc_root_count >= runtime_state.gc_root_capacity) {
-        runtime_state.gc_root_capacity *= 2;
-        runtime_state.gc_roots = (SchemeObject***)scheme_realloc(
-            runtime_state.gc_roots,
-            runtime_state.gc_root_capacity * sizeof(SchemeObject**));
-    }
-    runtime_state.gc_roots[runtime_state.gc_root_count++] = root;
-}
-
-void gc_remove_root(SchemeObject** root) {
-    for (size_t i = 0; i < runtime_state.gc_root_count; i++) {
-        if (runtime_state.gc_roots[i] == root) {
-            // Move last element to this position
-            runtime_state.gc_roots[i] = 
-                runtime_state.gc_roots[runtime_state.gc_root_count - 1];
-            runtime_state.gc_root_count--;
-            break;
-        }
-    }
-}
-
-void gc_run(void) {
-    if (!runtime_state.gc_enabled) {
-        return;
-    }
-    
-    // debug_print("Running garbage collection...\n");
-    
-    // Mark phase - simplified for now
-    /* 
-    for (size_t i = 0; i < runtime_state.gc_root_count; i++) {
-        if (runtime_state.gc_roots[i] && *runtime_state.gc_roots[i]) {
-            mark_object(*runtime_state.gc_roots[i]);
-        }
-    }
-    */
-    
-    // Sweep phase
-    sweep_objects();
-    
-    // debug_print("Garbage collection completed\n");
-}
-
-void gc_enable(void) {
-    runtime_state.gc_enabled = true;
-}
-
-void gc_disable(void) {
-    runtime_state.gc_enabled = false;
-}
-
-bool gc_is_enabled(void) {
-    return runtime_state.gc_enabled;
+    fprintf(out, "  Object count: %zu\n", get_object_count());
+    fprintf(out, "  Interned symbols: %zu\n", symbol_table_count());
+    fprintf(out, "  GC enabled: %s\n", gc_is_enabled() ? "yes" : "no");
+    print_interpreter_stats(out);
+    gc_print_stats(out);
+#ifndef RSCHEME_SYSTEM_MALLOC
+    slab_print_stats(out);
+#else
+    fprintf(out, "  Allocator: system malloc\n");
+#endif
 }
 
 void runtime_error(const char* format, ...) {
@@ -211,6 +174,6 @@ SchemeObject* make_compiled_procedure(SchemeObject* (*func)(SchemeObject**, int)
     SchemeObject* proc = make_procedure(NULL, NULL, NULL);  // Use existing constructor
     proc->value.procedure.func = func;
     proc->value.procedure.arity = arity;
-    proc->value.procedure.name = strdup(name);
+    proc->value.procedure.name = scheme_strdup(name);
     return proc;
 }
\ No newline at end of file
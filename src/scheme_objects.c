@@ -1,62 +1,20 @@
 #include "rscheme.h"
 #include <stdarg.h>
-
-// Global objects
-SchemeObject* SCHEME_NIL_OBJECT = NULL;
-SchemeObject* SCHEME_TRUE_OBJECT = NULL;
-SchemeObject* SCHEME_FALSE_OBJECT = NULL;
-
-// Object allocation tracking
-static SchemeObject* all_objects __attribute__((unused)) = NULL;
-static size_t object_count = 0;
+#include <math.h>
 
 static SchemeObject* allocate_object(SchemeType type) {
-    SchemeObject* obj = (SchemeObject*)scheme_malloc(sizeof(SchemeObject));
+    SchemeObject* obj = gc_allocate_object();
     obj->type = type;
     obj->ref_count = 1;
     obj->marked = false;
-    
-    // Add to global object list for GC (using a simple linked list)
-    // We'll store the next pointer separately to avoid corrupting the union
-    static SchemeObject** object_list = NULL;
-    static size_t object_list_capacity = 0;
-    
-    if (object_count >= object_list_capacity) {
-        object_list_capacity = object_list_capacity ? object_list_capacity * 2 : 16;
-        object_list = (SchemeObject**)scheme_realloc(object_list, 
-            object_list_capacity * sizeof(SchemeObject*));
-    }
-    
-    object_list[object_count] = obj;
-    object_count++;
-    
     return obj;
 }
 
 void init_scheme_objects(void) {
-    if (SCHEME_NIL_OBJECT) {
-        return; // Already initialized
-    }
-    
-    SCHEME_NIL_OBJECT = allocate_object(SCHEME_NIL);
-    SCHEME_NIL_OBJECT->ref_count = 1000; // Never collect these
-    
-    SCHEME_TRUE_OBJECT = allocate_object(SCHEME_BOOLEAN);
-    SCHEME_TRUE_OBJECT->value.boolean_value = true;
-    SCHEME_TRUE_OBJECT->ref_count = 1000;
-    
-    SCHEME_FALSE_OBJECT = allocate_object(SCHEME_BOOLEAN);
-    SCHEME_FALSE_OBJECT->value.boolean_value = false;
-    SCHEME_FALSE_OBJECT->ref_count = 1000;
+    // The constants are immediates; there is nothing to allocate
 }
 
 void cleanup_scheme_objects(void) {
-    // For now, we'll skip the complex cleanup since we have a simpler allocation system
-    object_count = 0;
-    
-    SCHEME_NIL_OBJECT = NULL;
-    SCHEME_TRUE_OBJECT = NULL;
-    SCHEME_FALSE_OBJECT = NULL;
 }
 
 SchemeObject* make_nil(void) {
@@ -67,6 +25,9 @@ SchemeObject* make_boolean(bool value) {
     return value ? SCHEME_TRUE_OBJECT : SCHEME_FALSE_OBJECT;
 }
 
+// Always a flonum, whatever the value: whether a number is exact depends on
+// how it was computed, never on what it came to. Exact integers are made by
+// make_fixnum and make_integer (see bignum.h).
 SchemeObject* make_number(double value) {
     SchemeObject* obj = allocate_object(SCHEME_NUMBER);
     obj->value.number_value = value;
@@ -74,14 +35,34 @@ SchemeObject* make_number(double value) {
 }
 
 SchemeObject* make_char(char value) {
-    SchemeObject* obj = allocate_object(SCHEME_CHAR);
-    obj->value.char_value = value;
-    return obj;
+    return SCHEME_MAKE_IMMEDIATE(SCHEME_CHAR, (unsigned char)value);
 }
 
+// Symbols are interned, so this returns the existing symbol when there is one
 SchemeObject* make_symbol(const char* name) {
+    uint32_t hash = hash_string(name);
+    SchemeObject* obj = find_symbol(name, hash);
+    if (obj) {
+        gc_read_weak(obj);
+        return obj;
+    }
+    
+    // Copy the name first: allocating the cell may collect the symbol that
+    // owns it
+    char* copy = scheme_strdup(name);
+    obj = allocate_object(SCHEME_SYMBOL);
+    obj->value.symbol_name = copy;
+    obj->value.symbol_hash = hash;
+    add_symbol(obj);
+    return obj;
+}
+
+// A symbol outside the table: no name the reader produces is eq to it
+SchemeObject* make_uninterned_symbol(const char* name) {
+    char* copy = scheme_strdup(name);
     SchemeObject* obj = allocate_object(SCHEME_SYMBOL);
-    obj->value.symbol_name = scheme_strdup(name);
+    obj->value.symbol_name = copy;
+    obj->value.symbol_hash = hash_string(name);
     return obj;
 }
 
@@ -92,12 +73,10 @@ SchemeObject* make_string(const char* str) {
 }
 
 SchemeObject* make_pair(SchemeObject* car, SchemeObject* cdr) {
-    SchemeObject* obj = allocate_object(SCHEME_PAIR);
-    obj->value.pair.car = car;
-    obj->value.pair.cdr = cdr;
-    if (car) retain_object(car);
-    if (cdr) retain_object(cdr);
-    return obj;
+    SchemePair* pair = gc_allocate_pair();
+    pair->car = car;
+    pair->cdr = cdr;
+    return pair_value(pair);
 }
 
 SchemeObject* make_procedure(SchemeObject* params, SchemeObject* body, Environment* env) {
@@ -111,6 +90,61 @@ SchemeObject* make_procedure(SchemeObject* params, SchemeObject* body, Environme
     return obj;
 }
 
+SchemeObject* make_local_ref(int depth, int slot) {
+    SchemeObject* obj = allocate_object(SCHEME_LOCAL);
+    obj->value.local_depth = depth;
+    obj->value.local_slot = slot;
+    return obj;
+}
+
+SchemeObject* make_global_ref(SchemeObject* symbol) {
+    SchemeObject* obj = allocate_object(SCHEME_GLOBAL);
+    obj->value.global_symbol = symbol;
+    return obj;
+}
+
+SchemeObject* make_code(SchemeObject* source) {
+    SchemeObject* obj = allocate_object(SCHEME_CODE);
+    obj->value.code.source = source;
+    return obj;
+}
+
+SchemeObject* make_bytecode(SchemeObject* source) {
+    Bytecode* bc = (Bytecode*)scheme_malloc(sizeof(Bytecode));
+    memset(bc, 0, sizeof(Bytecode));
+    bc->source = source;
+    
+    SchemeObject* obj = allocate_object(SCHEME_BYTECODE);
+    obj->value.bytecode = bc;
+    return obj;
+}
+
+SchemeObject* make_continuation(StackSegment* segment) {
+    SchemeObject* obj = allocate_object(SCHEME_CONTINUATION);
+    obj->value.continuation.segment = segment;
+    obj->value.continuation.winders = SCHEME_NIL_OBJECT;
+    obj->value.continuation.handlers = SCHEME_NIL_OBJECT;
+    obj->value.continuation.active = false;
+    return obj;
+}
+
+// Takes the digits, which bignum.c has already normalized
+SchemeObject* make_bignum(uint32_t* digits, uint32_t length, bool negative) {
+    gc_note_external(length * sizeof(uint32_t));
+    SchemeObject* obj = allocate_object(SCHEME_BIGNUM);
+    obj->value.bignum.digits = digits;
+    obj->value.bignum.length = length;
+    obj->value.bignum.negative = negative;
+    return obj;
+}
+
+SchemeObject* make_error_object(SchemeObject* message, SchemeObject* irritants) {
+    SchemeObject* obj = allocate_object(SCHEME_ERROR);
+    obj->value.error.message = message;
+    obj->value.error.irritants = irritants;
+    return obj;
+}
+
 SchemeObject* make_primitive(PrimitiveFn fn) {
     SchemeObject* obj = allocate_object(SCHEME_PRIMITIVE);
     obj->value.primitive = fn;
@@ -141,86 +175,82 @@ SchemeObject* cons(SchemeObject* car, SchemeObject* cdr) {
 }
 
 SchemeObject* car(SchemeObject* pair) {
-    if (!pair || pair->type != SCHEME_PAIR) {
+    if (!is_pair(pair)) {
         return SCHEME_NIL_OBJECT;
     }
-    return pair->value.pair.car;
+    return pair_cell(pair)->car;
 }
 
 SchemeObject* cdr(SchemeObject* pair) {
-    if (!pair || pair->type != SCHEME_PAIR) {
+    if (!is_pair(pair)) {
         return SCHEME_NIL_OBJECT;
     }
-    return pair->value.pair.cdr;
+    return pair_cell(pair)->cdr;
 }
 
 void set_car(SchemeObject* pair, SchemeObject* value) {
-    if (pair && pair->type == SCHEME_PAIR) {
-        if (pair->value.pair.car) {
-            release_object(pair->value.pair.car);
-        }
-        pair->value.pair.car = value;
-        if (value) {
-            retain_object(value);
-        }
+    if (is_pair(pair)) {
+        SchemePair* cell = pair_cell(pair);
+        gc_snapshot_barrier(cell->car);
+        gc_write_barrier_pair(cell, value);
+        cell->car = value;
     }
 }
 
 void set_cdr(SchemeObject* pair, SchemeObject* value) {
-    if (pair && pair->type == SCHEME_PAIR) {
-        if (pair->value.pair.cdr) {
-            release_object(pair->value.pair.cdr);
-        }
-        pair->value.pair.cdr = value;
-        if (value) {
-            retain_object(value);
-        }
+    if (is_pair(pair)) {
+        SchemePair* cell = pair_cell(pair);
+        gc_snapshot_barrier(cell->cdr);
+        gc_write_barrier_pair(cell, value);
+        cell->cdr = value;
     }
 }
 
-// Type checking functions
+// Type checking functions. Immediates are recognized from their tag bits
+// alone; only heap cells are dereferenced.
+static inline bool is_cell_of_type(SchemeObject* obj, SchemeType type) {
+    return is_heap_object(obj) && obj->type == type;
+}
+
 bool is_nil(SchemeObject* obj) {
-    return obj == SCHEME_NIL_OBJECT || (obj && obj->type == SCHEME_NIL);
+    return obj == SCHEME_NIL_OBJECT;
 }
 
 bool is_boolean(SchemeObject* obj) {
-    return obj && obj->type == SCHEME_BOOLEAN;
+    return obj == SCHEME_TRUE_OBJECT || obj == SCHEME_FALSE_OBJECT;
 }
 
 bool is_number(SchemeObject* obj) {
-    return obj && obj->type == SCHEME_NUMBER;
+    return is_fixnum(obj) || is_cell_of_type(obj, SCHEME_NUMBER) ||
+           is_cell_of_type(obj, SCHEME_BIGNUM);
 }
 
 bool is_char(SchemeObject* obj) {
-    return obj && obj->type == SCHEME_CHAR;
+    return ((uintptr_t)obj & 0xFF) == ((SCHEME_CHAR << 3) | SCHEME_IMMEDIATE_TAG);
 }
 
 bool is_symbol(SchemeObject* obj) {
-    return obj && obj->type == SCHEME_SYMBOL;
+    return is_cell_of_type(obj, SCHEME_SYMBOL);
 }
 
 bool is_string(SchemeObject* obj) {
-    return obj && obj->type == SCHEME_STRING;
-}
-
-bool is_pair(SchemeObject* obj) {
-    return obj && obj->type == SCHEME_PAIR;
+    return is_cell_of_type(obj, SCHEME_STRING);
 }
 
 bool is_procedure(SchemeObject* obj) {
-    return obj && obj->type == SCHEME_PROCEDURE;
+    return is_cell_of_type(obj, SCHEME_PROCEDURE);
 }
 
 bool is_primitive(SchemeObject* obj) {
-    return obj && obj->type == SCHEME_PRIMITIVE;
+    return is_cell_of_type(obj, SCHEME_PRIMITIVE);
 }
 
 bool is_vector(SchemeObject* obj) {
-    return obj && obj->type == SCHEME_VECTOR;
+    return is_cell_of_type(obj, SCHEME_VECTOR);
 }
 
 bool is_port(SchemeObject* obj) {
-    return obj && obj->type == SCHEME_PORT;
+    return is_cell_of_type(obj, SCHEME_PORT);
 }
 
 bool is_list(SchemeObject* obj) {
@@ -236,9 +266,9 @@ bool is_null(SchemeObject* obj) {
 
 size_t list_length(SchemeObject* list) {
     size_t length = 0;
-    while (list && is_pair(list)) {
+    while (is_pair(list)) {
         length++;
-        list = cdr(list);
+        list = pair_cell(list)->cdr;
     }
     return length;
 }
@@ -252,19 +282,21 @@ SchemeObject* list_ref(SchemeObject* list, size_t index) {
 
 bool scheme_equal(SchemeObject* a, SchemeObject* b) {
     if (a == b) return true;
-    if (!a || !b || a->type != b->type) return false;
+    if (!a || !b || object_type(a) != object_type(b)) return false;
     
-    switch (a->type) {
+    switch (object_type(a)) {
         case SCHEME_NIL:
-            return true;
         case SCHEME_BOOLEAN:
-            return a->value.boolean_value == b->value.boolean_value;
-        case SCHEME_NUMBER:
-            return a->value.number_value == b->value.number_value;
         case SCHEME_CHAR:
-            return a->value.char_value == b->value.char_value;
+            return false; // Immediates are equal only when identical
+        case SCHEME_NUMBER:
+            // Distinct fixnums differ; an exact number never equals an
+            // inexact one
+            return is_flonum(a) && is_flonum(b) && number_value(a) == number_value(b);
+        case SCHEME_BIGNUM:
+            return integer_compare(a, b) == 0;
         case SCHEME_SYMBOL:
-            return strcmp(a->value.symbol_name, b->value.symbol_name) == 0;
+            return false; // Interned, so equal only when identical
         case SCHEME_STRING:
             return strcmp(a->value.string_value, b->value.string_value) == 0;
         case SCHEME_PAIR:
@@ -276,12 +308,13 @@ bool scheme_equal(SchemeObject* a, SchemeObject* b) {
 
 bool scheme_eqv(SchemeObject* a, SchemeObject* b) {
     if (a == b) return true;
-    if (!a || !b || a->type != b->type) return false;
+    if (!a || !b || object_type(a) != object_type(b)) return false;
     
-    switch (a->type) {
+    switch (object_type(a)) {
         case SCHEME_NIL:
         case SCHEME_BOOLEAN:
         case SCHEME_NUMBER:
+        case SCHEME_BIGNUM:
         case SCHEME_CHAR:
         case SCHEME_SYMBOL:
             return scheme_equal(a, b);
@@ -295,48 +328,172 @@ bool scheme_eq(SchemeObject* a, SchemeObject* b) {
 }
 
 void retain_object(SchemeObject* obj) {
-    if (obj) {
+    if (is_heap_object(obj)) {
         obj->ref_count++;
     }
 }
 
 void release_object(SchemeObject* obj) {
-    if (obj && --obj->ref_count <= 0) {
-        // Object can be collected
-        obj->marked = false;
+    // Reachability is decided by the collector; the count is informational.
+    // Clearing the mark here would break an incremental cycle in progress.
+    if (is_heap_object(obj)) {
+        obj->ref_count--;
     }
 }
 
+// Marking never recurses: a newly marked cell with pointers in it goes on
+// the collector's mark stack, and the collector traces it from there.
+
 void mark_object(SchemeObject* obj) {
-    if (!obj || obj->marked) {
+    if (is_pair(obj)) {
+        mark_pair(pair_cell(obj));
         return;
     }
     
-    obj->marked = true;
+    if (!is_heap_object(obj) || obj->marked || !gc_is_traced(obj->generation)) {
+        return;
+    }
     
+    obj->marked = true;
+    if (obj->type == SCHEME_PROCEDURE || obj->type == SCHEME_VECTOR ||
+        obj->type == SCHEME_GLOBAL || obj->type == SCHEME_CODE ||
+        obj->type == SCHEME_BYTECODE || obj->type == SCHEME_CONTINUATION ||
+        obj->type == SCHEME_ERROR) {
+        gc_push_gray_object(obj);
+    }
+}
+
+static bool set_pair_mark(SchemePair* pair) {
+    uint8_t* flags = gc_pair_flags(pair);
+    if ((*flags & GC_PAIR_MARKED) || !gc_is_traced((*flags & GC_PAIR_OLD) ? GC_OLD : GC_YOUNG)) {
+        return false;
+    }
+    *flags |= GC_PAIR_MARKED;
+    return true;
+}
+
+void mark_pair(SchemePair* pair) {
+    if (set_pair_mark(pair)) {
+        gc_push_gray_object(pair_value(pair));
+    }
+}
+
+// Lists are traced cdr-first in a loop, pushing only their cars. The walk
+// hands the rest of a long list back to the mark stack now and then so an
+// incremental step cannot get stuck in it.
+#define MARK_LIST_BATCH 256
+
+void mark_pair_children(SchemePair* pair) {
+    for (size_t walked = 0; ; walked++) {
+        mark_object(pair->car);
+        
+        SchemeObject* next = pair->cdr;
+        if (!is_pair(next)) {
+            mark_object(next);
+            return;
+        }
+        if (walked >= MARK_LIST_BATCH) {
+            mark_pair(pair_cell(next));
+            return;
+        }
+        pair = pair_cell(next);
+        if (!set_pair_mark(pair)) {
+            return;
+        }
+    }
+}
+
+void mark_object_children(SchemeObject* obj) {
     switch (obj->type) {
-        case SCHEME_PAIR:
-            mark_object(obj->value.pair.car);
-            mark_object(obj->value.pair.cdr);
-            break;
         case SCHEME_PROCEDURE:
             mark_object(obj->value.procedure.parameters);
             mark_object(obj->value.procedure.body);
+            mark_object(obj->value.procedure.layout);
+            mark_object(obj->value.procedure.code);
+            mark_environment(obj->value.procedure.closure);
             break;
         case SCHEME_VECTOR:
             for (size_t i = 0; i < obj->value.vector.length; i++) {
                 mark_object(obj->value.vector.elements[i]);
             }
             break;
+        case SCHEME_GLOBAL:
+            mark_object(obj->value.global_symbol);
+            break;
+        case SCHEME_CODE:
+            mark_object(obj->value.code.source);
+            mark_object(obj->value.code.name);
+            for (size_t i = 0; i < obj->value.code.child_count; i++) {
+                mark_object(obj->value.code.children[i]);
+            }
+            break;
+        case SCHEME_BYTECODE:
+            mark_bytecode_children(obj->value.bytecode);
+            break;
+        case SCHEME_CONTINUATION:
+            if (obj->value.continuation.segment) {
+                mark_stack_segment(obj->value.continuation.segment);
+            }
+            mark_object(obj->value.continuation.winders);
+            mark_object(obj->value.continuation.handlers);
+            break;
+        case SCHEME_ERROR:
+            mark_object(obj->value.error.message);
+            mark_object(obj->value.error.irritants);
+            break;
         default:
             break;
     }
 }
 
-void sweep_objects(void) {
-    // Simplified sweep - in a full implementation this would 
-    // actually free unreferenced objects
-    // debug_print("Sweep phase - simplified implementation\n");
+size_t finalize_object(SchemeObject* obj) {
+    size_t freed = 0;
+    
+    switch (obj->type) {
+        case SCHEME_SYMBOL:
+            remove_symbol(obj);
+            freed = strlen(obj->value.symbol_name) + 1;
+            scheme_free(obj->value.symbol_name);
+            break;
+        case SCHEME_STRING:
+            freed = strlen(obj->value.string_value) + 1;
+            scheme_free(obj->value.string_value);
+            break;
+        case SCHEME_PROCEDURE:
+            if (obj->value.procedure.name) {
+                freed = strlen(obj->value.procedure.name) + 1;
+                scheme_free(obj->value.procedure.name);
+            }
+            break;
+        case SCHEME_VECTOR:
+            freed = obj->value.vector.length * sizeof(SchemeObject*);
+            scheme_free(obj->value.vector.elements);
+            break;
+        case SCHEME_PORT:
+            if (obj->value.port.filename) {
+                freed = strlen(obj->value.port.filename) + 1;
+                scheme_free(obj->value.port.filename);
+            }
+            break;
+        case SCHEME_CODE:
+            freed = free_code(&obj->value.code);
+            break;
+        case SCHEME_BYTECODE:
+            freed = free_bytecode(obj->value.bytecode);
+            break;
+        case SCHEME_CONTINUATION:
+            if (obj->value.continuation.segment) {
+                freed = free_stack_segment(obj->value.continuation.segment);
+            }
+            break;
+        case SCHEME_BIGNUM:
+            freed = free_bignum(&obj->value.bignum);
+            break;
+        default:
+            break;
+    }
+    
+    return freed;
 }
 
 void gc_collect(void) {
@@ -347,21 +504,34 @@ char* object_to_string(SchemeObject* obj) {
     if (!obj) {
         return scheme_strdup("null");
     }
+    if (is_bignum(obj)) {
+        // Digits without limit, so not in the buffer
+        return integer_to_string(obj);
+    }
     
     char* buffer = (char*)scheme_malloc(1024);
     
-    switch (obj->type) {
+    switch (object_type(obj)) {
         case SCHEME_NIL:
             strcpy(buffer, "()");
             break;
         case SCHEME_BOOLEAN:
-            strcpy(buffer, obj->value.boolean_value ? "#t" : "#f");
+            strcpy(buffer, boolean_value(obj) ? "#t" : "#f");
             break;
         case SCHEME_NUMBER:
-            snprintf(buffer, 1024, "%.6g", obj->value.number_value);
+            // Exact integers print all their digits; a flonum with no
+            // fraction to show prints a .0 to mark it inexact
+            if (is_fixnum(obj)) {
+                snprintf(buffer, 1024, "%lld", (long long)fixnum_value(obj));
+            } else {
+                snprintf(buffer, 1024, "%.6g", number_value(obj));
+                if (isfinite(number_value(obj)) && !strpbrk(buffer, ".e")) {
+                    strcat(buffer, ".0");
+                }
+            }
             break;
         case SCHEME_CHAR:
-            snprintf(buffer, 1024, "#\\%c", obj->value.char_value);
+            snprintf(buffer, 1024, "#\\%c", char_value(obj));
             break;
         case SCHEME_SYMBOL:
             snprintf(buffer, 1024, "%s", obj->value.symbol_name);
@@ -386,6 +556,27 @@ char* object_to_string(SchemeObject* obj) {
         case SCHEME_PORT:
             strcpy(buffer, "#<port>");
             break;
+        case SCHEME_LOCAL:
+            snprintf(buffer, 1024, "#<local %d:%d>", obj->value.local_depth, obj->value.local_slot);
+            break;
+        case SCHEME_GLOBAL:
+            snprintf(buffer, 1024, "%s", obj->value.global_symbol->value.symbol_name);
+            break;
+        case SCHEME_CODE:
+            strcpy(buffer, "#<code>");
+            break;
+        case SCHEME_BYTECODE:
+            strcpy(buffer, "#<bytecode>");
+            break;
+        case SCHEME_CONTINUATION:
+            strcpy(buffer, "#<continuation>");
+            break;
+        case SCHEME_ERROR:
+            snprintf(buffer, 1024, "#<error %s>", obj->value.error.message->value.string_value);
+            break;
+        case SCHEME_VALUES:
+            strcpy(buffer, "#<values>");
+            break;
         default:
             strcpy(buffer, "#<unknown>");
             break;
@@ -0,0 +1,196 @@
+#include "rscheme.h"
+
+// Pages are aligned to their size so a block's page header is found by
+// masking its address. Pages are carved out of larger arenas obtained from
+// the system allocator.
+#define SLAB_PAGE_SIZE ((size_t)64 * 1024)
+#define SLAB_PAGES_PER_ARENA 16
+#define SLAB_HEADER_SIZE 64
+#define SLAB_CLASS_COUNT 10
+
+static const size_t class_sizes[SLAB_CLASS_COUNT] = {
+    16, 32, 48, 64, 80, 96, 128, 160, 192, 256
+};
+
+// Free blocks are threaded through their first word
+typedef struct SlabBlock {
+    struct SlabBlock* next;
+} SlabBlock;
+
+typedef struct {
+    size_t size_class;
+    size_t block_size;
+} SlabPage;
+
+typedef struct {
+    SlabBlock* free_list;
+    char* bump;              // Unused tail of the newest page
+    char* bump_end;
+    size_t blocks_in_use;
+    size_t pages;
+} SlabClass;
+
+typedef struct {
+    char* raw;               // As returned by malloc
+    char* pages;             // First aligned page
+} SlabArena;
+
+static struct {
+    bool initialized;
+    SlabClass classes[SLAB_CLASS_COUNT];
+    uint8_t class_for_size[SLAB_MAX_SIZE / 16 + 1];
+
+    // Arenas sorted by page address
+    SlabArena* arenas;
+    size_t arena_count;
+    size_t arena_capacity;
+    char* next_page;
+    char* pages_end;
+} slab_state = {0};
+
+void slab_init(void) {
+    if (slab_state.initialized) {
+        return;
+    }
+
+    slab_state.initialized = true;
+    size_t class_index = 0;
+    for (size_t i = 0; i <= SLAB_MAX_SIZE / 16; i++) {
+        while (class_sizes[class_index] < i * 16) {
+            class_index++;
+        }
+        slab_state.class_for_size[i] = (uint8_t)class_index;
+    }
+}
+
+void slab_cleanup(void) {
+    for (size_t i = 0; i < slab_state.arena_count; i++) {
+        free(slab_state.arenas[i].raw);
+    }
+    free(slab_state.arenas);
+    memset(&slab_state, 0, sizeof(slab_state));
+}
+
+static void add_arena(void) {
+    char* raw = (char*)malloc((SLAB_PAGES_PER_ARENA + 1) * SLAB_PAGE_SIZE);
+    if (!raw) {
+        runtime_error("Out of memory: failed to allocate slab arena");
+        exit(EXIT_FAILURE);
+    }
+
+    char* pages = (char*)(((uintptr_t)raw + SLAB_PAGE_SIZE - 1) & ~(uintptr_t)(SLAB_PAGE_SIZE - 1));
+
+    if (slab_state.arena_count >= slab_state.arena_capacity) {
+        slab_state.arena_capacity = slab_state.arena_capacity ? slab_state.arena_capacity * 2 : 8;
+        slab_state.arenas = (SlabArena*)realloc(slab_state.arenas,
+            slab_state.arena_capacity * sizeof(SlabArena));
+        if (!slab_state.arenas) {
+            runtime_error("Out of memory: failed to grow slab arena table");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    size_t pos = slab_state.arena_count;
+    while (pos > 0 && slab_state.arenas[pos - 1].pages > pages) {
+        slab_state.arenas[pos] = slab_state.arenas[pos - 1];
+        pos--;
+    }
+    slab_state.arenas[pos].raw = raw;
+    slab_state.arenas[pos].pages = pages;
+    slab_state.arena_count++;
+
+    slab_state.next_page = pages;
+    slab_state.pages_end = pages + SLAB_PAGES_PER_ARENA * SLAB_PAGE_SIZE;
+}
+
+static void add_page(size_t class_index) {
+    if (slab_state.next_page >= slab_state.pages_end) {
+        add_arena();
+    }
+
+    char* page = slab_state.next_page;
+    slab_state.next_page += SLAB_PAGE_SIZE;
+
+    SlabPage* header = (SlabPage*)page;
+    header->size_class = class_index;
+    header->block_size = class_sizes[class_index];
+
+    SlabClass* cls = &slab_state.classes[class_index];
+    cls->bump = page + SLAB_HEADER_SIZE;
+    cls->bump_end = page + SLAB_PAGE_SIZE;
+    cls->pages++;
+}
+
+void* slab_alloc(size_t size) {
+    if (!slab_state.initialized) {
+        slab_init();
+    }
+
+    size_t class_index = slab_state.class_for_size[(size + 15) / 16];
+    SlabClass* cls = &slab_state.classes[class_index];
+    cls->blocks_in_use++;
+
+    SlabBlock* block = cls->free_list;
+    if (block) {
+        cls->free_list = block->next;
+        return block;
+    }
+
+    size_t block_size = class_sizes[class_index];
+    if (cls->bump + block_size > cls->bump_end) {
+        add_page(class_index);
+    }
+
+    void* ptr = cls->bump;
+    cls->bump += block_size;
+    return ptr;
+}
+
+static SlabPage* page_of(const void* ptr) {
+    return (SlabPage*)((uintptr_t)ptr & ~(uintptr_t)(SLAB_PAGE_SIZE - 1));
+}
+
+void slab_free(void* ptr) {
+    SlabClass* cls = &slab_state.classes[page_of(ptr)->size_class];
+    SlabBlock* block = (SlabBlock*)ptr;
+    block->next = cls->free_list;
+    cls->free_list = block;
+    cls->blocks_in_use--;
+}
+
+bool slab_owns(const void* ptr) {
+    const char* p = (const char*)ptr;
+    size_t low = 0;
+    size_t high = slab_state.arena_count;
+
+    while (low < high) {
+        size_t mid = (low + high) / 2;
+        const SlabArena* arena = &slab_state.arenas[mid];
+        if (p < arena->pages) {
+            high = mid;
+        } else if (p >= arena->pages + SLAB_PAGES_PER_ARENA * SLAB_PAGE_SIZE) {
+            low = mid + 1;
+        } else {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t slab_size_of(const void* ptr) {
+    return page_of(ptr)->block_size;
+}
+
+void slab_print_stats(FILE* out) {
+    fprintf(out, "  Slab arenas: %zu (%zu KB)\n", slab_state.arena_count,
+            slab_state.arena_count * SLAB_PAGES_PER_ARENA * SLAB_PAGE_SIZE / 1024);
+    for (size_t i = 0; i < SLAB_CLASS_COUNT; i++) {
+        const SlabClass* cls = &slab_state.classes[i];
+        if (cls->pages == 0) {
+            continue;
+        }
+        fprintf(out, "  Slab class %3zu bytes: %zu blocks in use, %zu pages\n",
+                class_sizes[i], cls->blocks_in_use, cls->pages);
+    }
+}
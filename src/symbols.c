@@ -0,0 +1,190 @@
+#include "rscheme.h"
+
+// Chained hash table of interned symbols. Chains are threaded through the
+// symbols themselves (value.symbol_next), so interning allocates nothing
+// beyond the symbol and its name.
+#define SYMBOL_TABLE_INITIAL_BUCKETS 512
+
+static struct {
+    SchemeObject** buckets;
+    size_t bucket_count;     // Power of two
+    size_t count;
+} symbol_table = {0};
+
+SchemeObject* SYMBOL_QUOTE = NULL;
+SchemeObject* SYMBOL_IF = NULL;
+SchemeObject* SYMBOL_DEFINE = NULL;
+SchemeObject* SYMBOL_SET = NULL;
+SchemeObject* SYMBOL_LAMBDA = NULL;
+SchemeObject* SYMBOL_BEGIN = NULL;
+SchemeObject* SYMBOL_AND = NULL;
+SchemeObject* SYMBOL_OR = NULL;
+SchemeObject* SYMBOL_COND = NULL;
+SchemeObject* SYMBOL_ELSE = NULL;
+SchemeObject* SYMBOL_LET = NULL;
+SchemeObject* SYMBOL_LET_STAR = NULL;
+SchemeObject* SYMBOL_LETREC = NULL;
+SchemeObject* SYMBOL_GUARD = NULL;
+SchemeObject* SYMBOL_LET_VALUES = NULL;
+SchemeObject* SYMBOL_RECEIVE = NULL;
+SchemeObject* SYMBOL_RESOLVED_LAMBDA = NULL;
+SchemeObject* SYMBOL_RESOLVED_LET = NULL;
+SchemeObject* SYMBOL_RESOLVED_LET_STAR = NULL;
+SchemeObject* SYMBOL_RESOLVED_LETREC = NULL;
+SchemeObject* SYMBOL_RESOLVED_LET_VALUES = NULL;
+
+static struct {
+    SchemeObject** symbol;
+    const char* name;
+} well_known_symbols[] = {
+    {&SYMBOL_QUOTE, "quote"},
+    {&SYMBOL_IF, "if"},
+    {&SYMBOL_DEFINE, "define"},
+    {&SYMBOL_SET, "set!"},
+    {&SYMBOL_LAMBDA, "lambda"},
+    {&SYMBOL_BEGIN, "begin"},
+    {&SYMBOL_AND, "and"},
+    {&SYMBOL_OR, "or"},
+    {&SYMBOL_COND, "cond"},
+    {&SYMBOL_ELSE, "else"},
+    {&SYMBOL_LET, "let"},
+    {&SYMBOL_LET_STAR, "let*"},
+    {&SYMBOL_LETREC, "letrec"},
+    {&SYMBOL_GUARD, "guard"},
+    {&SYMBOL_LET_VALUES, "let-values"},
+    {&SYMBOL_RECEIVE, "receive"},
+};
+
+#define WELL_KNOWN_SYMBOL_COUNT (sizeof(well_known_symbols) / sizeof(well_known_symbols[0]))
+
+static struct {
+    SchemeObject** symbol;
+    const char* name;
+} resolved_form_symbols[] = {
+    {&SYMBOL_RESOLVED_LAMBDA, "lambda"},
+    {&SYMBOL_RESOLVED_LET, "let"},
+    {&SYMBOL_RESOLVED_LET_STAR, "let*"},
+    {&SYMBOL_RESOLVED_LETREC, "letrec"},
+    {&SYMBOL_RESOLVED_LET_VALUES, "let-values"},
+};
+
+#define RESOLVED_FORM_SYMBOL_COUNT (sizeof(resolved_form_symbols) / sizeof(resolved_form_symbols[0]))
+
+void init_symbol_table(void) {
+    if (symbol_table.buckets) {
+        return;
+    }
+
+    symbol_table.bucket_count = SYMBOL_TABLE_INITIAL_BUCKETS;
+    symbol_table.buckets = (SchemeObject**)calloc(symbol_table.bucket_count, sizeof(SchemeObject*));
+    if (!symbol_table.buckets) {
+        runtime_error("Out of memory: failed to allocate symbol table");
+        exit(EXIT_FAILURE);
+    }
+    symbol_table.count = 0;
+
+    for (size_t i = 0; i < WELL_KNOWN_SYMBOL_COUNT; i++) {
+        *well_known_symbols[i].symbol = make_symbol(well_known_symbols[i].name);
+        gc_add_root(well_known_symbols[i].symbol);
+    }
+    for (size_t i = 0; i < RESOLVED_FORM_SYMBOL_COUNT; i++) {
+        *resolved_form_symbols[i].symbol = make_uninterned_symbol(resolved_form_symbols[i].name);
+        gc_add_root(resolved_form_symbols[i].symbol);
+    }
+}
+
+void cleanup_symbol_table(void) {
+    // Runs after gc_cleanup has reclaimed the symbols themselves
+    for (size_t i = 0; i < WELL_KNOWN_SYMBOL_COUNT; i++) {
+        *well_known_symbols[i].symbol = NULL;
+    }
+    for (size_t i = 0; i < RESOLVED_FORM_SYMBOL_COUNT; i++) {
+        *resolved_form_symbols[i].symbol = NULL;
+    }
+
+    free(symbol_table.buckets);
+    memset(&symbol_table, 0, sizeof(symbol_table));
+}
+
+// FNV-1a
+uint32_t hash_string(const char* str) {
+    uint32_t hash = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)str; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+SchemeObject* find_symbol(const char* name, uint32_t hash) {
+    if (!symbol_table.buckets) {
+        return NULL;
+    }
+
+    SchemeObject* symbol = symbol_table.buckets[hash & (symbol_table.bucket_count - 1)];
+    while (symbol) {
+        if (symbol->value.symbol_hash == hash && strcmp(symbol->value.symbol_name, name) == 0) {
+            return symbol;
+        }
+        symbol = symbol->value.symbol_next;
+    }
+    return NULL;
+}
+
+static void grow_symbol_table(void) {
+    size_t new_count = symbol_table.bucket_count * 2;
+    SchemeObject** new_buckets = (SchemeObject**)calloc(new_count, sizeof(SchemeObject*));
+    if (!new_buckets) {
+        return; // Keep the longer chains rather than fail
+    }
+
+    for (size_t i = 0; i < symbol_table.bucket_count; i++) {
+        SchemeObject* symbol = symbol_table.buckets[i];
+        while (symbol) {
+            SchemeObject* next = symbol->value.symbol_next;
+            size_t index = symbol->value.symbol_hash & (new_count - 1);
+            symbol->value.symbol_next = new_buckets[index];
+            new_buckets[index] = symbol;
+            symbol = next;
+        }
+    }
+
+    free(symbol_table.buckets);
+    symbol_table.buckets = new_buckets;
+    symbol_table.bucket_count = new_count;
+}
+
+void add_symbol(SchemeObject* symbol) {
+    if (!symbol_table.buckets) {
+        init_symbol_table();
+    }
+
+    if (symbol_table.count >= symbol_table.bucket_count) {
+        grow_symbol_table();
+    }
+
+    size_t index = symbol->value.symbol_hash & (symbol_table.bucket_count - 1);
+    symbol->value.symbol_next = symbol_table.buckets[index];
+    symbol_table.buckets[index] = symbol;
+    symbol_table.count++;
+}
+
+void remove_symbol(SchemeObject* symbol) {
+    if (!symbol_table.buckets) {
+        return;
+    }
+
+    SchemeObject** link = &symbol_table.buckets[symbol->value.symbol_hash & (symbol_table.bucket_count - 1)];
+    while (*link) {
+        if (*link == symbol) {
+            *link = symbol->value.symbol_next;
+            symbol_table.count--;
+            return;
+        }
+        link = &(*link)->value.symbol_next;
+    }
+}
+
+size_t symbol_table_count(void) {
+    return symbol_table.count;
+}
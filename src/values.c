@@ -0,0 +1,148 @@
+#include "rscheme.h"
+
+// Never allocated from the heap: old, so that storing it anywhere needs no
+// remembering, and without children to trace
+SchemeObject multiple_values = {.type = SCHEME_VALUES, .generation = GC_OLD};
+
+#define VALUE_REGISTER_SLOTS 16
+
+static SchemeObject** value_register = NULL;
+static int value_capacity = 0;
+static int value_count = 0;
+
+// Scheme, so that the evaluators see the call of the consumer (see
+// values.h)
+static const char* const values_prelude =
+    "(define (call-with-values producer consumer)"
+    "  (%apply-values consumer (producer)))";
+
+SchemeObject* return_values(int count, SchemeObject** values) {
+    if (count == 1) {
+        return values[0];
+    }
+    if (count > value_capacity) {
+        int capacity = value_capacity ? value_capacity : VALUE_REGISTER_SLOTS;
+        while (capacity < count) {
+            capacity *= 2;
+        }
+        value_register = (SchemeObject**)scheme_realloc(value_register, (size_t)capacity * sizeof(SchemeObject*));
+        value_capacity = capacity;
+    }
+    for (int i = 0; i < count; i++) {
+        value_register[i] = values[i];
+    }
+    value_count = count;
+    return MULTIPLE_VALUES;
+}
+
+SchemeObject** result_values(SchemeObject** result, int* count) {
+    if (is_multiple_values(*result)) {
+        *count = value_count;
+        return value_register;
+    }
+    *count = 1;
+    return result;
+}
+
+bool spread_values(SchemeObject* result, int required, bool rest, SchemeObject** out) {
+    int count;
+    SchemeObject** values = result_values(&result, &count);
+
+    if (count < required || (count > required && !rest)) {
+        char message[128];
+        snprintf(message, sizeof(message), "expected %s%d values, received %d",
+                 rest ? "at least " : "", required, count);
+        set_eval_error(EVAL_ERROR_WRONG_ARITY, message);
+        return false;
+    }
+
+    for (int i = 0; i < required; i++) {
+        out[i] = values[i];
+    }
+    if (rest) {
+        SchemeObject* list = SCHEME_NIL_OBJECT;
+        for (int i = count - 1; i >= required; i--) {
+            list = cons(values[i], list);
+        }
+        out[required] = list;
+    }
+    return true;
+}
+
+void bind_values(Environment* frame, SchemeObject* targets, SchemeObject* result) {
+    int required = 0;
+    SchemeObject* t = targets;
+    for (; is_pair(t); t = cdr(t)) {
+        required++;
+    }
+    bool rest = is_local_ref(t);
+
+    // The usual case, as many values as variables: straight into the slots
+    int produced;
+    SchemeObject** values = result_values(&result, &produced);
+    if (produced == required && !rest) {
+        int i = 0;
+        for (t = targets; is_pair(t); t = cdr(t)) {
+            set_frame_slot(frame, car(t)->value.local_slot, values[i++]);
+        }
+        return;
+    }
+
+    int count = required + (rest ? 1 : 0);
+
+    SchemeObject** spread = push_arguments(count);
+    if (spread_values(result, required, rest, spread)) {
+        int i = 0;
+        for (t = targets; is_pair(t); t = cdr(t)) {
+            set_frame_slot(frame, car(t)->value.local_slot, spread[i++]);
+        }
+        if (rest) {
+            set_frame_slot(frame, t->value.local_slot, spread[i]);
+        }
+    }
+    pop_arguments(count);
+}
+
+void mark_values_register(void) {
+    for (int i = 0; i < value_count; i++) {
+        mark_object(value_register[i]);
+    }
+}
+
+static SchemeObject* builtin_values(int argc, SchemeObject** argv, Environment* env) {
+    (void)env; // Unused
+    return return_values(argc, argv);
+}
+
+// The consumer's arguments are copied out of the register first, so the
+// consumer may return values of its own
+SchemeObject* builtin_apply_values(int argc, SchemeObject** argv, Environment* env) {
+    if (argc != 2) {
+        set_eval_error(EVAL_ERROR_WRONG_ARITY, "%apply-values expects 2 arguments");
+        return NULL;
+    }
+
+    SchemeObject* result = argv[1];
+    int count;
+    SchemeObject** values = result_values(&result, &count);
+    SchemeObject** frame = push_arguments(count);
+    for (int i = 0; i < count; i++) {
+        frame[i] = values[i];
+    }
+
+    result = apply_procedure_argv(argv[0], count, frame, env);
+    pop_arguments(count);
+    return result;
+}
+
+void init_values(Environment* env) {
+    define_variable(env, "values", make_primitive(builtin_values));
+    define_variable(env, "%apply-values", make_primitive(builtin_apply_values));
+
+    Parser* parser = create_parser(values_prelude);
+    SchemeObject* expr;
+    while ((expr = parse_expression(parser)) != NULL) {
+        eval_toplevel(expr, env);
+    }
+    destroy_parser(parser);
+}
@@ -0,0 +1,957 @@
+#include "rscheme.h"
+
+// Direct threading needs labels as values, a GNU extension. Profiling
+// builds dispatch with the switch so each opcode is known as it runs.
+#if defined(__GNUC__) && !defined(RSCHEME_VM_PROFILE)
+#define VM_THREADED 1
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+// An active invocation of a bytecode object. Its region of the stack
+// segment holds the stack-slot locals followed by the operand stack.
+typedef struct {
+    SchemeObject* bytecode;
+    ThreadedWord* pc;
+    SchemeObject** slots;
+    SchemeObject** sp;
+    Environment* env;
+    int region_size;
+} VMFrame;
+
+// The VM's control stack is a chain of segments. The running segment holds
+// frame records, and in an area of its own their regions. When it fills up
+// it is sealed into a continuation object and an empty segment is started
+// above it; returning past the bottom of a segment copies the frame
+// returned into out of the sealed one below. Recursion depth is bounded
+// only by memory, and sealed segments are heap objects that a minor
+// collection does not rescan once they are old.
+//
+// Each entry to the VM from C runs on a chain of its own, and returns to
+// its caller when that chain is exhausted.
+//
+// call/cc splits the running segment where it stands: the part in use is
+// sealed into the continuation, and the running segment goes on in the
+// rest of the same buffer. The continuation thus shares every frame below
+// the capture with the running code. Invoking it drops the running frames
+// and returns into the sealed ones.
+#define SEGMENT_FRAMES 512
+#define SEGMENT_VALUES 4096
+
+// Emptied default-sized buffers kept for reuse
+#define SPARE_BUFFERS 4
+
+// Sealed segments hold their buffers until the collector finds them dead,
+// which cell allocation alone may not prompt soon enough; allocating this
+// much buffer space asks for a minor collection
+#define BUFFER_COLLECT_BYTES (16 * 1024 * 1024)
+
+// The memory segments are carved from; freed with the last of them
+typedef struct StackBuffer {
+    struct StackBuffer* next_spare;
+    int segments;
+    size_t value_capacity;
+    VMFrame* frames;
+    SchemeObject** values;
+} StackBuffer;
+
+struct StackSegment {
+    StackBuffer* buffer;
+    StackSegment* outer;           // Running segment of the enclosing entry
+    size_t entry;                  // The entry from C the chain belongs to
+    SchemeObject* below;           // Continuation past the bottom, or NULL
+    int below_frames;              // Frames of below not yet returned into
+    int frame_count;
+    int frame_capacity;
+    size_t value_top;
+    size_t value_capacity;
+    VMFrame* frames;
+    SchemeObject** values;
+};
+
+#ifdef VM_THREADED
+static const void* const* handlers = NULL;
+#endif
+
+#ifdef RSCHEME_VM_PROFILE
+static uint64_t opcode_pairs[OPCODE_COUNT][OPCODE_COUNT];
+static int previous_opcode = OP_RETURN;
+#endif
+
+static StackSegment* stack = NULL;
+static StackBuffer* spare_buffers = NULL;
+static int spare_count = 0;
+static size_t buffer_bytes = 0;
+static size_t entry_count = 0;
+
+#define TOP_FRAME() (&stack->frames[stack->frame_count - 1])
+
+static size_t buffer_size(size_t values) {
+    return sizeof(StackBuffer) + SEGMENT_FRAMES * sizeof(VMFrame) + values * sizeof(SchemeObject*);
+}
+
+static StackBuffer* new_buffer(size_t values) {
+    if (values <= SEGMENT_VALUES && spare_buffers) {
+        StackBuffer* buffer = spare_buffers;
+        spare_buffers = buffer->next_spare;
+        spare_count--;
+        return buffer;
+    }
+
+    size_t capacity = values > SEGMENT_VALUES ? values : SEGMENT_VALUES;
+    buffer_bytes += buffer_size(capacity);
+    if (buffer_bytes >= BUFFER_COLLECT_BYTES) {
+        buffer_bytes = 0;
+        gc_run_minor();
+    }
+    StackBuffer* buffer = (StackBuffer*)scheme_malloc(buffer_size(capacity));
+    buffer->segments = 0;
+    buffer->value_capacity = capacity;
+    buffer->frames = (VMFrame*)(buffer + 1);
+    buffer->values = (SchemeObject**)(buffer->frames + SEGMENT_FRAMES);
+    return buffer;
+}
+
+static StackSegment* new_segment(size_t values) {
+    StackBuffer* buffer = new_buffer(values);
+    StackSegment* segment = (StackSegment*)scheme_malloc(sizeof(StackSegment));
+    segment->buffer = buffer;
+    segment->outer = NULL;
+    segment->entry = 0;
+    segment->below = NULL;
+    segment->below_frames = 0;
+    segment->frame_count = 0;
+    segment->frame_capacity = SEGMENT_FRAMES;
+    segment->value_top = 0;
+    segment->value_capacity = buffer->value_capacity;
+    segment->frames = buffer->frames;
+    segment->values = buffer->values;
+    buffer->segments++;
+    return segment;
+}
+
+size_t free_stack_segment(StackSegment* segment) {
+    StackBuffer* buffer = segment->buffer;
+    size_t freed = sizeof(StackSegment);
+    scheme_free(segment);
+    if (--buffer->segments > 0) {
+        return freed;
+    }
+
+    freed += buffer_size(buffer->value_capacity);
+    if (buffer->value_capacity == SEGMENT_VALUES && spare_count < SPARE_BUFFERS) {
+        buffer->next_spare = spare_buffers;
+        spare_buffers = buffer;
+        spare_count++;
+    } else {
+        scheme_free(buffer);
+    }
+    return freed;
+}
+
+void mark_stack_segment(StackSegment* segment) {
+    for (int i = 0; i < segment->frame_count; i++) {
+        mark_object(segment->frames[i].bytecode);
+        mark_environment(segment->frames[i].env);
+    }
+    for (size_t i = 0; i < segment->value_top; i++) {
+        mark_object(segment->values[i]);
+    }
+    mark_object(segment->below);
+}
+
+void mark_vm_frames(void) {
+    for (StackSegment* segment = stack; segment; segment = segment->outer) {
+        mark_stack_segment(segment);
+    }
+}
+
+void print_vm_profile(FILE* out) {
+#ifdef RSCHEME_VM_PROFILE
+    enum { SHOWN = 30 };
+    uint64_t total = 0;
+    for (int i = 0; i < OPCODE_COUNT; i++) {
+        for (int j = 0; j < OPCODE_COUNT; j++) {
+            total += opcode_pairs[i][j];
+        }
+    }
+    if (total == 0) {
+        return;
+    }
+    fprintf(out, "VM opcode pairs (%llu dispatches):\n", (unsigned long long)total);
+
+    // Repeatedly pick the most frequent pair not yet shown
+    static bool shown[OPCODE_COUNT][OPCODE_COUNT];
+    for (int n = 0; n < SHOWN; n++) {
+        int best_i = -1;
+        int best_j = -1;
+        for (int i = 0; i < OPCODE_COUNT; i++) {
+            for (int j = 0; j < OPCODE_COUNT; j++) {
+                if (!shown[i][j] && opcode_pairs[i][j] &&
+                    (best_i < 0 || opcode_pairs[i][j] > opcode_pairs[best_i][best_j])) {
+                    best_i = i;
+                    best_j = j;
+                }
+            }
+        }
+        if (best_i < 0) {
+            break;
+        }
+        shown[best_i][best_j] = true;
+        fprintf(out, "  %-24s %-24s %12llu  %5.1f%%\n", opcode_names[best_i], opcode_names[best_j],
+                (unsigned long long)opcode_pairs[best_i][best_j],
+                100.0 * (double)opcode_pairs[best_i][best_j] / (double)total);
+    }
+#else
+    (void)out;
+#endif
+}
+
+void cleanup_vm(void) {
+    while (spare_buffers) {
+        StackBuffer* next = spare_buffers->next_spare;
+        scheme_free(spare_buffers);
+        spare_buffers = next;
+    }
+    spare_count = 0;
+}
+
+// Make room for a frame with a region of the given size. A segment with
+// frames is sealed; an empty one is only too small, and is replaced.
+static void grow_stack(size_t values) {
+    StackSegment* full = stack;
+    if (full->frame_count == 0) {
+        stack = new_segment(values);
+        stack->outer = full->outer;
+        stack->entry = full->entry;
+        stack->below = full->below;
+        stack->below_frames = full->below_frames;
+        free_stack_segment(full);
+        return;
+    }
+
+    // The full segment stays the running one, and so reachable, until the
+    // continuation holding it exists
+    SchemeObject* sealed = make_continuation(full);
+    stack = new_segment(values);
+    stack->outer = full->outer;
+    stack->entry = full->entry;
+    stack->below = sealed;
+    stack->below_frames = full->frame_count;
+    full->outer = NULL;
+}
+
+// Split the running segment: what is in use is sealed into a continuation,
+// and the running segment carries on in the rest of its buffer
+static SchemeObject* capture_continuation(void) {
+    StackSegment* sealed_part = stack;
+    SchemeObject* sealed = make_continuation(sealed_part);
+    capture_extent(sealed);
+
+    StackSegment* rest = (StackSegment*)scheme_malloc(sizeof(StackSegment));
+    *rest = *sealed_part;
+    rest->frames += sealed_part->frame_count;
+    rest->frame_capacity -= sealed_part->frame_count;
+    rest->frame_count = 0;
+    rest->values += sealed_part->value_top;
+    rest->value_capacity -= sealed_part->value_top;
+    rest->value_top = 0;
+    rest->below = sealed;
+    rest->below_frames = sealed_part->frame_count;
+    rest->buffer->segments++;
+
+    sealed_part->frame_capacity = sealed_part->frame_count;
+    sealed_part->value_capacity = sealed_part->value_top;
+    sealed_part->outer = NULL;
+    stack = rest;
+    return sealed;
+}
+
+static VMFrame* push_frame(SchemeObject* bytecode, Environment* env) {
+    Bytecode* bc = bytecode->value.bytecode;
+    int region_size = bc->local_count + bc->max_stack;
+    if (stack->frame_count == stack->frame_capacity ||
+        stack->value_top + (size_t)region_size > stack->value_capacity) {
+        grow_stack((size_t)region_size);
+    }
+
+    VMFrame* frame = &stack->frames[stack->frame_count++];
+    frame->bytecode = bytecode;
+    frame->pc = bc->threaded;
+    frame->env = env;
+    frame->region_size = region_size;
+    frame->slots = stack->values + stack->value_top;
+    frame->sp = frame->slots + bc->local_count;
+    stack->value_top += (size_t)region_size;
+
+    // Slots the collector may see before they are filled must not hold
+    // stale pointers
+    for (int i = 0; i < region_size; i++) {
+        frame->slots[i] = NULL;
+    }
+    return frame;
+}
+
+// The running segment is empty and its frames are exhausted: copy the
+// frame being returned into out of the sealed segment below
+static void underflow(void) {
+    StackSegment* from = stack->below->value.continuation.segment;
+    VMFrame* source = &from->frames[--stack->below_frames];
+    if (stack->frame_count == stack->frame_capacity ||
+        stack->value_top + (size_t)source->region_size > stack->value_capacity) {
+        grow_stack((size_t)source->region_size);
+    }
+
+    VMFrame* frame = &stack->frames[stack->frame_count++];
+    *frame = *source;
+    frame->slots = stack->values + stack->value_top;
+    frame->sp = frame->slots + (source->sp - source->slots);
+    memcpy(frame->slots, source->slots, (size_t)source->region_size * sizeof(SchemeObject*));
+    stack->value_top += (size_t)source->region_size;
+
+    if (stack->below_frames == 0) {
+        stack->below = from->below;
+        stack->below_frames = from->below_frames;
+    }
+}
+
+// Binds arguments as extend_environment_argv does: missing ones stay
+// unbound, extra ones are dropped unless there is a rest parameter
+static void enter_procedure(SchemeObject* proc, int argc, SchemeObject** argv) {
+    SchemeObject* bytecode = proc->value.procedure.code;
+    Bytecode* bc = bytecode->value.bytecode;
+    Environment* closure = proc->value.procedure.closure;
+
+    if (bc->heap_frames) {
+        push_frame(bytecode, extend_environment_argv(closure, bc->params, bc->layout, argc, argv));
+        return;
+    }
+
+    VMFrame* frame = push_frame(bytecode, closure);
+    int bound = argc < bc->param_count ? argc : bc->param_count;
+    for (int i = 0; i < bound; i++) {
+        frame->slots[i] = argv[i];
+    }
+    if (bc->has_rest && argc >= bc->param_count) {
+        SchemeObject* rest = SCHEME_NIL_OBJECT;
+        for (int i = argc - 1; i >= bound; i--) {
+            rest = cons(argv[i], rest);
+        }
+        frame->slots[bound] = rest;
+    }
+}
+
+// An escape to a continuation is taken by the entry that captured it, or,
+// once that entry has returned, by the innermost one
+static bool lands_here(SchemeObject* k) {
+    size_t entry = k->value.continuation.segment->entry;
+    if (entry == stack->entry) {
+        return true;
+    }
+    for (StackSegment* segment = stack->outer; segment; segment = segment->outer) {
+        if (segment->entry == entry) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static SchemeObject* run(bool publish, SchemeObject* resume, SchemeObject* value);
+
+void thread_bytecode(Bytecode* bc) {
+#ifdef VM_THREADED
+    if (!handlers) {
+        run(true, NULL, NULL);
+    }
+#endif
+    ThreadedWord* threaded = (ThreadedWord*)scheme_realloc(bc->threaded,
+                                                           (size_t)bc->code_length * sizeof(ThreadedWord));
+    for (int i = 0; i < bc->code_length; i += 1 + opcode_operands[bc->code[i]]) {
+        int op = bc->code[i];
+#ifdef VM_THREADED
+        threaded[i].handler = handlers[op];
+#else
+        threaded[i].operand = op;
+#endif
+        for (int j = 1; j <= opcode_operands[op]; j++) {
+            threaded[i + j].operand = bc->code[i + j];
+        }
+    }
+    bc->threaded = threaded;
+}
+
+#ifdef VM_THREADED
+#define CASE(op) label_##op
+#define NEXT() goto *(pc++)->handler
+#define AT_RETURN(pc) ((pc)->handler == &&label_OP_RETURN)
+#else
+#define CASE(op) case op
+#define NEXT() goto dispatch
+#define AT_RETURN(pc) ((pc)->operand == OP_RETURN)
+#endif
+
+// Tail calls copy their arguments aside while the caller's frame is
+// replaced; calls with more arguments than this are made normally
+#define TAIL_CALL_MAX_ARGS 64
+
+// Runs until the running segment chain is exhausted, starting, if resume
+// is set, by returning value to that continuation. run(true, ...) only
+// publishes the handler addresses for thread_bytecode.
+static SchemeObject* run(bool publish, SchemeObject* resume, SchemeObject* value) {
+#ifdef VM_THREADED
+#define HANDLER(op, operands) [op] = &&label_##op,
+    static const void* const labels[OPCODE_COUNT] = {
+        BYTECODE_OPCODES(HANDLER)
+    };
+#undef HANDLER
+    if (publish) {
+        handlers = labels;
+        return NULL;
+    }
+#else
+    (void)publish; // Only the threaded dispatch has handlers to publish
+#endif
+
+    VMFrame* frame;
+    ThreadedWord* code;
+    ThreadedWord* pc;
+    SchemeObject** constants;
+    SchemeObject** slots;
+    SchemeObject** sp;
+    Environment* env;
+
+    // Operands of the superinstructions and calls
+    SchemeObject* procedure = NULL;
+    SchemeObject* first = NULL;
+    SchemeObject* second = NULL;
+    SchemeObject* result;
+    int argc;
+    bool branch = false;
+    bool is_car;
+
+#define LOAD_FRAME() do { \
+        frame = TOP_FRAME(); \
+        Bytecode* bc_ = frame->bytecode->value.bytecode; \
+        code = bc_->threaded; \
+        constants = bc_->constants; \
+        pc = frame->pc; \
+        slots = frame->slots; \
+        sp = frame->sp; \
+        env = frame->env; \
+    } while (0)
+
+#define LOAD_GLOBAL(target, index) do { \
+        target = eval_global_ref(constants[index], env); \
+    } while (0)
+
+#define LOAD_SLOT(target, slot) do { \
+        target = slots[slot]; \
+        if (!target) { \
+            target = unassigned_variable(env, frame->bytecode->value.bytecode->local_names[slot]); \
+            if (!target) { \
+                return NULL; \
+            } \
+        } \
+    } while (0)
+
+    if (resume) {
+        procedure = resume;
+        result = value;
+        goto reinstate;
+    }
+    LOAD_FRAME();
+#ifdef VM_THREADED
+    NEXT();
+#else
+dispatch:
+#ifdef RSCHEME_VM_PROFILE
+    opcode_pairs[previous_opcode][pc->operand]++;
+    previous_opcode = (int)pc->operand;
+#endif
+    switch ((pc++)->operand) {
+#endif
+        CASE(OP_CONST):
+            *sp++ = constants[(pc++)->operand];
+            NEXT();
+
+        CASE(OP_LOCAL):
+            LOAD_SLOT(*sp, pc->operand);
+            sp++;
+            pc++;
+            NEXT();
+
+        CASE(OP_STORE_LOCAL):
+            slots[(pc++)->operand] = *--sp;
+            NEXT();
+
+        CASE(OP_ENV): {
+            Environment* target = frame_at_depth(env, (int)pc[0].operand);
+            SchemeObject* value = target->slots[pc[1].operand];
+            if (!value) {
+                value = unbound_local(target, (int)pc[1].operand);
+                if (!value) {
+                    return NULL;
+                }
+            }
+            *sp++ = value;
+            pc += 2;
+            NEXT();
+        }
+
+        CASE(OP_STORE_ENV):
+            set_frame_slot(frame_at_depth(env, (int)pc[0].operand), (int)pc[1].operand, *--sp);
+            pc += 2;
+            NEXT();
+
+        CASE(OP_GLOBAL):
+            LOAD_GLOBAL(*sp, (pc++)->operand);
+            sp++;
+            NEXT();
+
+        CASE(OP_DEFINE_GLOBAL):
+            define_symbol(env, constants[(pc++)->operand], *--sp);
+            NEXT();
+
+        CASE(OP_SET_GLOBAL):
+            if (!set_symbol_if_exists(env, constants[(pc++)->operand], *--sp)) {
+                set_eval_error(EVAL_ERROR_RUNTIME, "set! variable not defined");
+                return NULL;
+            }
+            NEXT();
+
+        CASE(OP_POP):
+            sp--;
+            NEXT();
+
+        CASE(OP_JUMP):
+            pc = code + pc->operand;
+            NEXT();
+
+        CASE(OP_JUMP_IF_FALSE):
+            if (*--sp == SCHEME_FALSE_OBJECT) {
+                pc = code + pc->operand;
+            } else {
+                pc++;
+            }
+            NEXT();
+
+        CASE(OP_JUMP_IF_FALSE_OR_POP):
+            if (sp[-1] == SCHEME_FALSE_OBJECT) {
+                pc = code + pc->operand;
+            } else {
+                sp--;
+                pc++;
+            }
+            NEXT();
+
+        CASE(OP_JUMP_IF_TRUE_OR_POP):
+            if (sp[-1] != SCHEME_FALSE_OBJECT) {
+                pc = code + pc->operand;
+            } else {
+                sp--;
+                pc++;
+            }
+            NEXT();
+
+        CASE(OP_CLOSURE): {
+            SchemeObject* body = constants[(pc++)->operand];
+            Bytecode* bc = body->value.bytecode;
+            SchemeObject* closure = make_procedure(bc->params, bc->body, env);
+            closure->value.procedure.layout = bc->layout;
+            closure->value.procedure.code = body;
+            *sp++ = closure;
+            NEXT();
+        }
+
+        CASE(OP_ENTER_FRAME):
+            env = make_frame(env, constants[(pc++)->operand]);
+            frame->env = env;
+            NEXT();
+
+        CASE(OP_LEAVE_FRAME):
+            env = env->parent;
+            frame->env = env;
+            NEXT();
+
+        CASE(OP_CALL):
+            argc = (int)(pc++)->operand;
+            branch = false;
+            goto call;
+
+        CASE(OP_CALL_JUMP_IF_FALSE):
+            argc = (int)(pc++)->operand;
+            branch = true;
+            goto call;
+
+        CASE(OP_RETURN):
+            result = sp[-1];
+            stack->value_top = (size_t)(frame->slots - stack->values);
+            if (--stack->frame_count == 0) {
+                if (!stack->below) {
+                    return result;
+                }
+                underflow();
+            }
+            LOAD_FRAME();
+            *sp++ = result;
+            NEXT();
+
+        CASE(OP_EVAL):
+            result = eval_expression(constants[(pc++)->operand], env);
+            *sp++ = result;
+            NEXT();
+
+        CASE(OP_SPREAD_VALUES):
+            if (!spread_values(sp[-1], (int)pc[0].operand, pc[1].operand != 0, sp - 1)) {
+                return NULL;
+            }
+            sp += pc[0].operand + pc[1].operand - 1;
+            pc += 2;
+            NEXT();
+
+        CASE(OP_CALL_LOCAL_CONST):
+            branch = false;
+            goto local_const;
+
+        CASE(OP_BRANCH_LOCAL_CONST):
+            branch = true;
+        local_const:
+            LOAD_GLOBAL(procedure, pc[0].operand);
+            LOAD_SLOT(first, pc[1].operand);
+            second = constants[pc[2].operand];
+            pc += 3;
+            goto call_two;
+
+        CASE(OP_CALL_LOCAL_LOCAL):
+            branch = false;
+            goto local_local;
+
+        CASE(OP_BRANCH_LOCAL_LOCAL):
+            branch = true;
+        local_local:
+            LOAD_GLOBAL(procedure, pc[0].operand);
+            LOAD_SLOT(first, pc[1].operand);
+            LOAD_SLOT(second, pc[2].operand);
+            pc += 3;
+            goto call_two;
+
+        CASE(OP_LOCAL_CAR):
+            is_car = true;
+            goto local_cxr;
+
+        CASE(OP_LOCAL_CDR):
+            is_car = false;
+        local_cxr:
+            LOAD_SLOT(*sp, pc->operand);
+            sp++;
+            pc++;
+            goto cxr;
+
+        CASE(OP_LOCAL_LOCAL):
+            LOAD_SLOT(sp[0], pc[0].operand);
+            LOAD_SLOT(sp[1], pc[1].operand);
+            sp += 2;
+            pc += 2;
+            NEXT();
+
+        CASE(OP_LOCAL_CONST):
+            LOAD_SLOT(sp[0], pc[0].operand);
+            sp[1] = constants[pc[1].operand];
+            sp += 2;
+            pc += 2;
+            NEXT();
+
+        CASE(OP_CAR):
+            is_car = true;
+            goto cxr;
+
+        CASE(OP_CDR):
+            is_car = false;
+        cxr:
+            LOAD_GLOBAL(procedure, (pc++)->operand);
+            first = sp[-1];
+            if (is_pair(first) && is_primitive(procedure) &&
+                procedure->value.primitive == (is_car ? builtin_car : builtin_cdr)) {
+                sp[-1] = is_car ? pair_cell(first)->car : pair_cell(first)->cdr;
+                NEXT();
+            }
+            sp[-1] = procedure;
+            *sp++ = first;
+            argc = 1;
+            branch = false;
+            goto call;
+
+        // The numeric operators take their operands off the stack and leave
+        // the result, or test it, as call_two would
+#define NUMERIC(builtin, fast) do { \
+            LOAD_GLOBAL(procedure, (pc++)->operand); \
+            first = sp[-2]; \
+            second = sp[-1]; \
+            sp -= 2; \
+            if (is_builtin(procedure, builtin) && (result = fast(first, second))) { \
+                goto called; \
+            } \
+            goto call_two; \
+        } while (0)
+
+        CASE(OP_ADD):
+            branch = false;
+            NUMERIC(builtin_add, fast_add);
+
+        CASE(OP_SUBTRACT):
+            branch = false;
+            NUMERIC(builtin_subtract, fast_subtract);
+
+        CASE(OP_MULTIPLY):
+            branch = false;
+            NUMERIC(builtin_multiply, fast_multiply);
+
+        CASE(OP_DIVIDE):
+            branch = false;
+            NUMERIC(builtin_divide, fast_divide);
+
+        CASE(OP_NUM_EQ):
+            branch = false;
+            goto num_eq;
+
+        CASE(OP_BRANCH_NUM_EQ):
+            branch = true;
+        num_eq:
+            NUMERIC(builtin_num_eq, fast_num_eq);
+
+        CASE(OP_LT):
+            branch = false;
+            goto lt;
+
+        CASE(OP_BRANCH_LT):
+            branch = true;
+        lt:
+            NUMERIC(builtin_lt, fast_lt);
+
+        CASE(OP_GT):
+            branch = false;
+            goto gt;
+
+        CASE(OP_BRANCH_GT):
+            branch = true;
+        gt:
+            NUMERIC(builtin_gt, fast_gt);
+
+        CASE(OP_LE):
+            branch = false;
+            goto le;
+
+        CASE(OP_BRANCH_LE):
+            branch = true;
+        le:
+            NUMERIC(builtin_le, fast_le);
+
+        CASE(OP_GE):
+            branch = false;
+            goto ge;
+
+        CASE(OP_BRANCH_GE):
+            branch = true;
+        ge:
+            NUMERIC(builtin_ge, fast_ge);
+
+#undef NUMERIC
+
+        CASE(OP_NEGATE):
+            LOAD_GLOBAL(procedure, (pc++)->operand);
+            first = sp[-1];
+            if (is_builtin(procedure, builtin_subtract) && (result = fast_negate(first))) {
+                sp[-1] = result;
+                NEXT();
+            }
+            sp[-1] = procedure;
+            *sp++ = first;
+            argc = 1;
+            branch = false;
+            goto call;
+#ifndef VM_THREADED
+    }
+#endif
+
+    // A primitive is called on the two operands in place above the stack;
+    // anything else gets an ordinary call
+call_two:
+    if (is_primitive(procedure)) {
+        sp[0] = first;
+        sp[1] = second;
+        result = procedure->value.primitive(2, sp, env);
+        goto called;
+    }
+    sp[0] = procedure;
+    sp[1] = first;
+    sp[2] = second;
+    sp += 3;
+    argc = 2;
+
+call: {
+        SchemeObject** argv = sp - argc;
+        procedure = argv[-1];
+        sp = argv - 1;
+
+        if (is_procedure(procedure) && is_bytecode(procedure->value.procedure.code)) {
+            if (AT_RETURN(pc) && argc <= TAIL_CALL_MAX_ARGS) {
+                // A tail call: the callee's frame replaces this one
+                SchemeObject* arguments[TAIL_CALL_MAX_ARGS];
+                memcpy(arguments, argv, (size_t)argc * sizeof(SchemeObject*));
+                stack->value_top = (size_t)(frame->slots - stack->values);
+                stack->frame_count--;
+                enter_procedure(procedure, argc, arguments);
+                LOAD_FRAME();
+                NEXT();
+            }
+
+            // The result replaces the procedure when the callee returns, and
+            // a fused branch's OP_JUMP_IF_FALSE then tests it
+            frame->pc = pc;
+            frame->sp = sp;
+            enter_procedure(procedure, argc, argv);
+            LOAD_FRAME();
+            NEXT();
+        }
+
+        if (is_continuation(procedure) && procedure->value.continuation.segment) {
+            result = continuation_value(argc, argv);
+            if (!lands_here(procedure)) {
+                return throw_to_continuation(procedure, argc, argv);
+            }
+            goto reinstate;
+        }
+
+        if (argc == 1 && is_primitive(procedure) && procedure->value.primitive == builtin_call_cc) {
+            // Seal the running segment, this frame in it, then go on from a
+            // copy of the frame by calling the receiver on the continuation
+            frame->pc = pc;
+            frame->sp = sp;
+            first = argv[0];
+            second = capture_continuation();
+            underflow();
+            LOAD_FRAME();
+            sp[0] = first;
+            sp[1] = second;
+            sp += 2;
+            goto call;
+        }
+
+        if (argc == 2 && is_builtin(procedure, builtin_apply_values) &&
+            is_procedure(argv[0]) && is_bytecode(argv[0]->value.procedure.code)) {
+            // call-with-values calling its consumer (see values.h): the
+            // consumer is entered here, in place of the call, from a copy
+            // of the values on the argument stack
+            procedure = argv[0];
+            result = argv[1];
+            SchemeObject** values = result_values(&result, &argc);
+            SchemeObject** arguments = push_arguments(argc);
+            memcpy(arguments, values, (size_t)argc * sizeof(SchemeObject*));
+            if (AT_RETURN(pc)) {
+                stack->value_top = (size_t)(frame->slots - stack->values);
+                stack->frame_count--;
+            } else {
+                frame->pc = pc;
+                frame->sp = sp;
+            }
+            enter_procedure(procedure, argc, arguments);
+            pop_arguments(argc);
+            LOAD_FRAME();
+            NEXT();
+        }
+
+        // Primitives, and procedures the tree-walker runs. Either may
+        // re-enter the VM, on a segment chain of its own.
+        result = is_primitive(procedure)
+            ? procedure->value.primitive(argc, argv, env)
+            : apply_procedure_argv(procedure, argc, argv, env);
+    }
+
+called:
+    if (branch) {
+        // Take or skip the OP_JUMP_IF_FALSE that follows
+        pc = result == SCHEME_FALSE_OBJECT ? code + pc[1].operand : pc + 2;
+    } else {
+        *sp++ = result;
+    }
+    NEXT();
+
+    // Leave the running frames for those of the continuation in procedure,
+    // in its dynamic extent, and return result into the top one
+reinstate:
+    rewind_to(procedure);
+    stack->frame_count = 0;
+    stack->value_top = 0;
+    stack->below = procedure;
+    stack->below_frames = procedure->value.continuation.segment->frame_count;
+    underflow();
+    LOAD_FRAME();
+    *sp++ = result;
+    NEXT();
+
+#undef LOAD_FRAME
+#undef LOAD_GLOBAL
+#undef LOAD_SLOT
+}
+
+// Entries from C start a chain of their own, dropped when run returns or
+// when a non-local exit leaves the entry
+static void enter_vm(void) {
+    StackSegment* segment = new_segment(SEGMENT_VALUES);
+    segment->outer = stack;
+    segment->entry = ++entry_count;
+    stack = segment;
+}
+
+static SchemeObject* leave_vm(SchemeObject* result) {
+    StackSegment* segment = stack;
+    stack = segment->outer;
+    free_stack_segment(segment);
+    return result;
+}
+
+size_t current_vm_entry(void) {
+    return stack ? stack->entry : 0;
+}
+
+void unwind_vm_entries(size_t entry) {
+    while (stack && stack->entry > entry) {
+        leave_vm(NULL);
+    }
+}
+
+// Runs the entry just made. An escape to a continuation that lands here
+// unwinds to the catch frame, and the entry carries on from the
+// continuation; anything else is passed on.
+static SchemeObject* run_entry(void) {
+    SchemeObject* volatile resume = NULL;
+    SchemeObject* volatile value = NULL;
+    CatchFrame catcher;
+    push_catch(&catcher);
+    if (setjmp(catcher.jump)) {
+        SchemeObject* k = pending_escape();
+        if (!k || !k->value.continuation.segment || !lands_here(k)) {
+            throw_error();
+            return NULL;
+        }
+        resume = k;
+        value = take_escape();
+        push_catch(&catcher);
+    }
+
+    SchemeObject* result = run(false, resume, value);
+    pop_catch(&catcher);
+    return result;
+}
+
+SchemeObject* vm_execute(SchemeObject* bytecode, Environment* env) {
+    enter_vm();
+    push_frame(bytecode, env);
+    return leave_vm(run_entry());
+}
+
+SchemeObject* vm_apply(SchemeObject* proc, int argc, SchemeObject** argv) {
+    check_stack_depth();
+    enter_vm();
+    enter_procedure(proc, argc, argv);
+    return leave_vm(run_entry());
+}
@@ -0,0 +1,27 @@
+;; What every test here loads first. Run a test from the top of the source
+;; tree, as ctest does, so that (load "tests/check.scm") finds this:
+;;
+;;     ./rscheme tests/exactness.scm
+;;
+;; Each check that fails prints FAIL; report ends the test with
+;; "All checks passed" if none did.
+
+(define failures 0)
+
+(define (check name actual expected)
+  (if (not (equal? actual expected))
+      (begin
+        (set! failures (+ failures 1))
+        (display "FAIL ")
+        (display name)
+        (display ": got ")
+        (write actual)
+        (display ", expected ")
+        (write expected)
+        (newline))))
+
+(define (report)
+  (if (= failures 0)
+      (display "All checks passed")
+      (begin (display failures) (display " checks failed")))
+  (newline))
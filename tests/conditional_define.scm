@@ -0,0 +1,43 @@
+;; Internal defines that do not run. The resolver gives every internal
+;; define a slot in its body's frame; until the define runs, the name means
+;; what it would without it, here mostly the global x.
+
+(load "tests/check.scm")
+
+(define x 'global)
+
+(define (never) (if #f (define x 'local)) x)
+(check "define in a branch not taken" (never) 'global)
+
+(define (maybe flag) (if flag (define x 'local)) x)
+(check "define in a branch taken" (maybe #t) 'local)
+(check "define in a branch not taken, then taken" (list (maybe #f) (maybe #t)) '(global local))
+
+(define (capture flag) (if flag (define x 'local)) (lambda () x))
+(check "closure over a define not run" ((capture #f)) 'global)
+(check "closure over a define run" ((capture #t)) 'local)
+
+(define (inner y)
+  (define (shadow) (if #f (define y 'shadowed)) y)
+  (shadow))
+(check "falls back to an enclosing local" (inner 'outer) 'outer)
+
+(define (count-down n)
+  (if (= n 0)
+      x
+      (begin
+        (if #f (define x 'local))
+        (count-down (- n 1)))))
+(check "in a loop" (count-down 100) 'global)
+
+(define (cond-define n)
+  (cond ((> n 0) (define x 'positive) x)
+        (else x)))
+(check "define in a cond clause" (list (cond-define 1) (cond-define 0)) '(positive global))
+
+(define (unbound) (if #f (define not-defined-anywhere 1)) not-defined-anywhere)
+(check "still unbound without an outer binding"
+       (guard (e (#t 'unbound)) (unbound))
+       'unbound)
+
+(report)
@@ -0,0 +1,78 @@
+;; Exact and inexact numbers. Exactness follows the operands, never the
+;; value: a flonum anywhere makes the result inexact, even when it is a
+;; whole number, and exact operands give exact results.
+
+(load "tests/check.scm")
+
+(define (check-inexact name x value)
+  (check name (list (inexact? x) (= x value)) '(#t #t)))
+
+(define (check-exact name x value)
+  (check name (list (exact? x) (= x value)) '(#t #t)))
+
+;; Literals
+(check-inexact "1.0" 1.0 1)
+(check-inexact "-2.0" -2.0 -2)
+(check-inexact "1e20" 1e20 100000000000000000000)
+(check-exact "1" 1 1)
+(check-exact "a bignum literal" 100000000000000000000 (expt 10 20))
+
+;; A flonum operand makes the result inexact
+(check-inexact "(* 1.0 2)" (* 1.0 2) 2)
+(check-inexact "(+ 0.5 0.5)" (+ 0.5 0.5) 1)
+(check-inexact "(- 3.0 1)" (- 3.0 1) 2)
+(check-inexact "(/ 6.0 3)" (/ 6.0 3) 2)
+(check-inexact "(expt 2.0 100)" (expt 2.0 100) (expt 2 100))
+(check-inexact "(* 1.0 (expt 10 20))" (* 1.0 (expt 10 20)) (expt 10 20))
+(check-inexact "(quotient (expt 10 20) 3.0)" (quotient (expt 10 20) 3.0)
+               (exact->inexact (quotient (expt 10 20) 3)))
+(check-inexact "(remainder 7.0 2)" (remainder 7.0 2) 1)
+(check-inexact "(modulo -7 2.0)" (modulo -7 2.0) 1)
+(check-inexact "(max 1 2.0)" (max 1 2.0) 2)
+(check-inexact "(abs -2.0)" (abs -2.0) 2)
+
+(define (factorial n acc)
+  (if (= n 0)
+      acc
+      (factorial (- n 1) (* acc n))))
+(check-inexact "factorial from 1.0" (factorial 20 1.0) 2432902008176640000)
+(check-exact "factorial from 1" (factorial 30 1) 265252859812191058636308480000000)
+
+;; Exact operands give exact results
+(check-exact "(* 2 3)" (* 2 3) 6)
+(check-exact "(/ 6 3)" (/ 6 3) 2)
+(check-exact "(/ 0 -5)" (/ 0 -5) 0)
+(check-exact "(/ -1)" (/ -1) -1)
+(check-exact "(expt 2 100)" (expt 2 100) 1267650600228229401496703205376)
+(check-exact "(length '(1 2 3))" (length '(1 2 3)) 3)
+(check-exact "(string-length \"abc\")" (string-length "abc") 3)
+(check-exact "(char->integer #\\a)" (char->integer #\a) 97)
+(check-inexact "(/ 1 2)" (/ 1 2) 0.5)
+
+;; The same arithmetic meeting flonums and then fixnums, so that it has
+;; specialized for flonums and computes in doubles when it meets them
+(define (poly x) (+ (* x x) (- (* 2 x) 1)))
+(check-inexact "poly of 3.0" (poly 3.0) 14)
+(check-inexact "poly of 3.0 again" (poly 3.0) 14)
+(check-exact "poly of 3 after 3.0" (poly 3) 14)
+(check-exact "poly of a large fixnum" (poly 1000000000000) 1000000000001999999999999)
+(check-inexact "poly of 0.5 after 3" (poly 0.5) 0.25)
+
+(define (sum-halves n acc)
+  (if (= n 0)
+      acc
+      (sum-halves (- n 1) (+ acc (* n 0.5)))))
+(check-inexact "a flonum loop" (sum-halves 100 0) 2525)
+(check-exact "an exact loop" (sum-halves 0 0) 0)
+
+;; Exactness is part of equality, though not of =
+(check "(equal? 2 2.0)" (equal? 2 2.0) #f)
+(check "(equal? 2.0 2.0)" (equal? 2.0 2.0) #t)
+(check "(= 2 2.0)" (= 2 2.0) #t)
+
+;; Conversions
+(check-inexact "(exact->inexact 5)" (exact->inexact 5) 5)
+(check-exact "(inexact->exact 5.0)" (inexact->exact 5.0) 5)
+(check-exact "(inexact->exact 1e20)" (inexact->exact 1e20) 100000000000000000000)
+
+(report)
@@ -0,0 +1,56 @@
+;; Collections while very long and very deep structures are live. The
+;; collector marks through an explicit mark stack, so neither the length of
+;; a list nor the depth of a tree costs C stack; ctest runs this with the
+;; stack limited to 1 MB, where marking by recursion would overflow.
+
+(load "tests/check.scm")
+
+;; (0 1 ... n-1)
+(define (iota n)
+  (define (loop i acc)
+    (if (< i 0)
+        acc
+        (loop (- i 1) (cons i acc))))
+  (loop (- n 1) '()))
+
+;; A tree of depth n nested through its cars: (((... (0) ...) n-2) n-1)
+(define (left-nested n)
+  (define (loop i tree)
+    (if (= i n)
+        tree
+        (loop (+ i 1) (list tree i))))
+  (loop 1 (list '() 0)))
+
+(define (list-sum lst)
+  (define (loop lst sum)
+    (if (null? lst)
+        sum
+        (loop (cdr lst) (+ sum (car lst)))))
+  (loop lst 0))
+
+;; Depth and sum of the labels of a left-nested tree
+(define (tree-depth-and-sum tree)
+  (define (loop tree depth sum)
+    (if (null? tree)
+        (list depth sum)
+        (loop (car tree) (+ depth 1) (+ sum (car (cdr tree))))))
+  (loop tree 0 0))
+
+(define list-length 10000000)
+(define tree-depth 1000000)
+
+(define long-list (iota list-length))
+(define deep-tree (left-nested tree-depth))
+
+;; Enough surviving allocation to bring on full collections with both of
+;; them complete and live
+(define copy (reverse long-list))
+(set! copy (reverse copy))
+
+(check "list length" (length long-list) list-length)
+(check "list sum" (list-sum long-list) (quotient (* list-length (- list-length 1)) 2))
+(check "copy sum" (list-sum copy) (list-sum long-list))
+(check "tree" (tree-depth-and-sum deep-tree)
+       (list tree-depth (quotient (* tree-depth (- tree-depth 1)) 2)))
+
+(report)